@@ -0,0 +1,219 @@
+/*
+ * Forwarding pipeline benchmark.
+ *
+ * Synthetic RTP is generated into publisher transports, sent over loopback to an SFU endpoint
+ * (RTPBundleTransport -> RTPIncomingSourceGroup -> RTPStreamTransponderFacade -> RTPOutgoingSourceGroup)
+ * and forwarded to every subscriber transport, where the end to end latency of each packet is measured.
+ *
+ * Usage: npm run bench -- [--transports=1,4] [--streams=1,8] [--subscribers=1,10] [--rate=50] [--size=200] [--duration=10] [--json]
+ */
+const OS		= require("os");
+const {
+	MediaInfo,
+	CodecInfo,
+	DTLSInfo,
+	ICEInfo,
+	TrackInfo,
+	Setup,
+} = require("semantic-sdp");
+
+const MediaServer		= require("../index");
+const Native			= require("../lib/Native");
+const SharedPointer		= require("../lib/SharedPointer");
+const Utils			= require("../lib/Utils");
+const IncomingStreamTrack	= require("../lib/IncomingStreamTrack");
+
+//Server IP address
+const ip = "127.0.0.1";
+
+//Parse args
+const args = Object.fromEntries(process.argv.slice(2).map(arg => {
+	const [key, value] = arg.replace(/^--/, "").split("=");
+	return [key, value ?? "true"];
+}));
+const list = (/** @type {string} */ value, /** @type {string} */ def) => (value || def).split(",").map(Number);
+
+const params = {
+	transports	: list(args.transports, "1"),
+	streams		: list(args.streams, "1,4"),
+	subscribers	: list(args.subscribers, "1,10"),
+	rate		: Number(args.rate || 50),
+	size		: Number(args.size || 200),
+	duration	: Number(args.duration || 10),
+	warmup		: Number(args.warmup || 2),
+	json		: args.json === "true",
+};
+
+//Only opus, so packets are forwarded without parsing the payload
+const rtp = {
+	audio : new MediaInfo("audio","audio"),
+};
+rtp.audio.addCodec(new CodecInfo("opus",96));
+
+const sleep = (/** @type {number} */ ms) => new Promise(resolve => setTimeout(resolve, ms));
+
+/**
+ * Connect two endpoints over loopback
+ */
+function connect(
+	/** @type {import("../lib/Endpoint")} */ endpointA,
+	/** @type {import("../lib/Endpoint")} */ endpointB)
+{
+	const A = {
+		ice	: ICEInfo.generate(true),
+		dtls	: new DTLSInfo(Setup.ACTIVE, "sha-256", endpointA.getDTLSFingerprint())
+	};
+	const B = {
+		ice	: ICEInfo.generate(true),
+		dtls	: new DTLSInfo(Setup.PASSIVE, "sha-256", endpointB.getDTLSFingerprint()),
+	};
+	//Create transports
+	const transportA = endpointA.createTransport(B, A, {disableSTUNKeepAlive: true});
+	const transportB = endpointB.createTransport(A, B, {disableSTUNKeepAlive: true});
+	//Set local&remote properties
+	transportA.setLocalProperties(rtp);
+	transportA.setRemoteProperties(rtp);
+	transportB.setLocalProperties(rtp);
+	transportB.setRemoteProperties(rtp);
+	//Add remote candidates
+	transportA.addRemoteCandidates(transportB.getLocalCandidates());
+	transportB.addRemoteCandidates(transportA.getLocalCandidates());
+	return [transportA, transportB];
+}
+
+/**
+ * Get cpu times per core
+ */
+function getCPUTimes()
+{
+	return OS.cpus().map(cpu => {
+		const times = cpu.times;
+		return { busy: times.user + times.nice + times.sys + times.irq, total: times.user + times.nice + times.sys + times.irq + times.idle };
+	});
+}
+
+async function run(
+	/** @type {number} */ numTransports,
+	/** @type {number} */ numStreams,
+	/** @type {number} */ numSubscribers)
+{
+	//Endpoints for publishers, sfu and subscribers, each one has its own transport thread
+	const publisher  = MediaServer.createEndpoint(ip);
+	const sfu	 = MediaServer.createEndpoint(ip);
+	const subscriber = MediaServer.createEndpoint(ip);
+
+	//Synthetic generator
+	const generator = SharedPointer(new Native.SyntheticRTPSourceShared(params.rate, params.size));
+	//Latency probe on subscribers
+	const probe = new Native.RTPLatencyProbe();
+
+	const sfuStreams = [];
+	const transports = [];
+
+	//Create publishers
+	for (let i = 0; i < numTransports; ++i)
+	{
+		const [transportA, transportB] = connect(publisher, sfu);
+		transports.push(transportA, transportB);
+		//For each stream
+		for (let j = 0; j < numStreams; ++j)
+		{
+			const id = `stream-${i}-${j}`;
+			//Create native source fed by generator
+			const source = SharedPointer(new Native.RTPIncomingSourceGroupShared(Utils.mediaToFrameType("audio"), generator.GetTimeService()));
+			source.media.ssrc = (i << 16 | j) + 1;
+			generator.AddIncomingSourceGroup(source, "opus");
+			//Create incoming track for it
+			const track = new IncomingStreamTrack("audio", id, "audio", generator.GetTimeService(), SharedPointer(generator.toRTPReceiver()), {"": source});
+			//Send it over the publisher transport
+			const outgoingStream = transportA.createOutgoingStream({ id, audio: [{ id }] });
+			outgoingStream.getAudioTracks()[0].attachTo(track);
+			//Receive it on the sfu
+			sfuStreams.push(transportB.createIncomingStream(outgoingStream.getStreamInfo()));
+		}
+	}
+
+	//Create subscribers
+	for (let k = 0; k < numSubscribers; ++k)
+	{
+		const [transportS, transportC] = connect(sfu, subscriber);
+		transports.push(transportS, transportC);
+		//Forward all streams
+		for (const sfuStream of sfuStreams)
+		{
+			const outgoingStream = transportS.publish(sfuStream);
+			const incomingStream = transportC.createIncomingStream(outgoingStream.getStreamInfo());
+			//Measure latency on arrival
+			for (const track of incomingStream.getTracks())
+				probe.AddIncoming(SharedPointer.getPointer(track.getDefaultEncoding().source.toRTPIncomingMediaStream()));
+		}
+	}
+
+	//Start generating and wait for DTLS to settle
+	generator.Start();
+	await sleep(params.warmup * 1000);
+
+	//Start measuring
+	probe.Reset();
+	const generated = generator.GetGenerated();
+	const cpus = getCPUTimes();
+	const usage = process.cpuUsage();
+	const start = process.hrtime.bigint();
+
+	await sleep(params.duration * 1000);
+
+	//Collect
+	const elapsed = Number(process.hrtime.bigint() - start) / 1E9;
+	const stats = probe.GetStats();
+	const processUsage = process.cpuUsage(usage);
+	const pool = generator.GetPacketPoolStats();
+	const cores = getCPUTimes().map((times, i) => Math.round(100 * (times.busy - cpus[i].busy) / Math.max(times.total - cpus[i].total, 1)));
+
+	//Stop everything
+	generator.Stop();
+	for (const transport of transports)
+		transport.stop();
+	publisher.stop();
+	sfu.stop();
+	subscriber.stop();
+	generator.Clear();
+
+	return {
+		transports	: numTransports,
+		streams		: numStreams,
+		subscribers	: numSubscribers,
+		sentPps		: Math.round((generator.GetGenerated() - generated) / elapsed),
+		expectedPps	: numTransports * numStreams * numSubscribers * params.rate,
+		receivedPps	: Math.round(stats.packets / elapsed),
+		p50		: stats.p50,
+		p90		: stats.p90,
+		p99		: stats.p99,
+		p999		: stats.p999,
+		max		: stats.max,
+		poolHighWater	: pool.highWaterMark,
+		poolMisses	: pool.misses,
+		process		: Math.round(100 * (processUsage.user + processUsage.system) / 1E6 / elapsed),
+		cores		: cores.join(" "),
+	};
+}
+
+(async () => {
+	MediaServer.enableLog(false);
+	const results = [];
+	//Sweep configurations
+	for (const transports of params.transports)
+		for (const streams of params.streams)
+			for (const subscribers of params.subscribers)
+			{
+				const result = await run(transports, streams, subscribers);
+				results.push(result);
+				if (!params.json)
+					console.log(`transports:${transports} streams:${streams} subscribers:${subscribers} received:${result.receivedPps}pps p50:${result.p50}us p99:${result.p99}us cpu:${result.process}%`);
+			}
+	//Output
+	if (params.json)
+		console.log(JSON.stringify({ params, results }, null, 2));
+	else
+		console.table(results);
+	MediaServer.terminate();
+})();
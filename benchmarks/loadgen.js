@@ -0,0 +1,451 @@
+/*
+ * Load generator for sizing servers.
+ *
+ * Spins up N publishers and M subscribers as DTLS/ICE peers (server to server mode, without stun
+ * keep alives) against an SFU running on a child process, so the cpu usage of each server thread can
+ * be measured without the clients load. Each subscriber receives all the published streams.
+ *
+ * Media can be generated synthetically (audio only, latency is measured end to end), read from an mp4
+ * file with a Player, or replayed from an unencrypted transport dump with PCAPTransportEmulator.
+ * Video is sent simulcast when more than one layer is requested, with each layer as a ssrc of a SIM group.
+ *
+ * Usage: node benchmarks/loadgen.js [--publishers=10] [--subscribers=10] [--clients=4]
+ *	[--audio=opus] [--video=vp8] [--simulcast=3] [--mp4=file.mp4 | --pcap=dump.pcap --sdp=remote.sdp]
+ *	[--rate=50] [--size=200] [--duration=30] [--interval=5] [--json]
+ */
+const FS		= require("fs");
+const ChildProcess	= require("child_process");
+const {
+	SDPInfo,
+	MediaInfo,
+	CodecInfo,
+	DTLSInfo,
+	ICEInfo,
+	StreamInfo,
+	TrackInfo,
+	SourceGroupInfo,
+	Setup,
+} = require("semantic-sdp");
+
+const MediaServer		= require("../index");
+const Native			= require("../lib/Native");
+const SharedPointer		= require("../lib/SharedPointer");
+const Utils			= require("../lib/Utils");
+const IncomingStreamTrack	= require("../lib/IncomingStreamTrack");
+
+//Server IP address
+const ip = "127.0.0.1";
+
+//Parse args
+const args = Object.fromEntries(process.argv.slice(2).map(arg => {
+	const [key, value] = arg.replace(/^--/, "").split("=");
+	return [key, value ?? "true"];
+}));
+
+const params = {
+	publishers	: Number(args.publishers || 10),
+	subscribers	: Number(args.subscribers || 10),
+	clients		: Number(args.clients || 4),
+	audio		: args.audio === "none" ? null : (args.audio || "opus"),
+	video		: args.video === "none" ? null : (args.video || (args.mp4 || args.pcap ? "vp8" : null)),
+	simulcast	: Number(args.simulcast || 1),
+	mp4		: args.mp4,
+	pcap		: args.pcap,
+	sdp		: args.sdp,
+	rate		: Number(args.rate || 50),
+	size		: Number(args.size || 200),
+	duration	: Number(args.duration || 30),
+	interval	: Number(args.interval || 5),
+	json		: args.json === "true",
+};
+
+//Create RTP properties shared by clients and server
+const rtp = {};
+if (params.audio)
+{
+	rtp.audio = new MediaInfo("audio","audio");
+	rtp.audio.addCodec(new CodecInfo(params.audio, 96));
+}
+if (params.video)
+{
+	const codec = new CodecInfo(params.video, 97);
+	codec.setRTX(98);
+	rtp.video = new MediaInfo("video","video");
+	rtp.video.addCodec(codec);
+}
+
+const sleep = (/** @type {number} */ ms) => new Promise(resolve => setTimeout(resolve, ms));
+
+/**
+ * Get cpu time in ms of each thread of this process
+ * @returns {Map<number, {name: string, time: number}>}
+ */
+function getThreadTimes()
+{
+	const threads = new Map();
+	for (const tid of FS.readdirSync("/proc/self/task"))
+	{
+		try {
+			const stat = FS.readFileSync(`/proc/self/task/${tid}/stat`, "utf8");
+			//Name may contain spaces, so split after it
+			const name = stat.slice(stat.indexOf("(") + 1, stat.lastIndexOf(")"));
+			const fields = stat.slice(stat.lastIndexOf(")") + 2).split(" ");
+			//utime and stime are in clock ticks, usually 100 per second
+			threads.set(Number(tid), { name, time: (Number(fields[11]) + Number(fields[12])) * 10 });
+		} catch (e) {
+			//Thread ended
+		}
+	}
+	return threads;
+}
+
+/**
+ * Get local peer info for a transport on an endpoint
+ */
+function getLocalInfo(/** @type {import("../lib/Endpoint")} */ endpoint, /** @type {import("semantic-sdp").Setup} */ setup)
+{
+	return {
+		ice	: ICEInfo.generate(true),
+		dtls	: new DTLSInfo(setup, "sha-256", endpoint.getDTLSFingerprint()),
+	};
+}
+
+/**
+ * Create a transport on an endpoint and connect it to the remote peer
+ */
+function createTransport(/** @type {import("../lib/Endpoint")} */ endpoint, /** @type {any} */ remote, /** @type {any} */ local)
+{
+	//Create transport
+	const transport = endpoint.createTransport(remote, local, {disableSTUNKeepAlive: true});
+	//Set local&remote properties
+	transport.setLocalProperties(rtp);
+	transport.setRemoteProperties(rtp);
+	//Add remote candidates
+	transport.addRemoteCandidates(remote.candidates);
+	return transport;
+}
+
+/**
+ * Serialize local peer info so it can be sent to the other process
+ */
+function plainPeer(/** @type {import("../lib/Endpoint")} */ endpoint, /** @type {any} */ local)
+{
+	return {
+		ice		: local.ice.plain(),
+		dtls		: local.dtls.plain(),
+		candidates	: endpoint.getLocalCandidates().map(candidate => candidate.plain()),
+	};
+}
+
+/**
+ * SFU running on the child process
+ */
+function server()
+{
+	//Create UDP server endpoint
+	const endpoint = MediaServer.createEndpoint(ip);
+
+	/** @type {Map<string, import("../lib/IncomingStream")>} */
+	const incomingStreams = new Map();
+	/** @type {import("../lib/Transport")[]} */
+	const transports = [];
+	/** @type {import("../lib/OutgoingStream")[]} */
+	const outgoingStreams = [];
+
+	let connected = 0;
+	let threads = getThreadTimes();
+	let last = Date.now();
+
+	const onTransport = (/** @type {import("../lib/Transport")} */ transport) => {
+		transports.push(transport);
+		transport.on("dtlsstate", (state) => state === "connected" && connected++);
+	};
+
+	process.on("message", (/** @type {any} */ msg) => {
+		const reply = (/** @type {any} */ data) => process.send?.({ seq: msg.seq, ...data });
+		switch (msg.type)
+		{
+			case "publish":
+			{
+				const local = getLocalInfo(endpoint, Setup.PASSIVE);
+				const transport = createTransport(endpoint, msg.peer, local);
+				onTransport(transport);
+				//Receive stream
+				incomingStreams.set(msg.stream.id, transport.createIncomingStream(msg.stream));
+				reply({ peer: plainPeer(endpoint, local) });
+				break;
+			}
+			case "subscribe":
+			{
+				const local = getLocalInfo(endpoint, Setup.PASSIVE);
+				const transport = createTransport(endpoint, msg.peer, local);
+				onTransport(transport);
+				//Forward all published streams
+				const streams = [];
+				for (const incomingStream of incomingStreams.values())
+				{
+					const outgoingStream = transport.publish(incomingStream);
+					outgoingStreams.push(outgoingStream);
+					streams.push(outgoingStream.getStreamInfo().plain());
+				}
+				reply({ peer: plainPeer(endpoint, local), streams });
+				break;
+			}
+			case "stats":
+			{
+				//Get cpu usage per thread since last stats
+				const now = Date.now();
+				const current = getThreadTimes();
+				const cpu = [];
+				for (const [tid, thread] of current)
+					cpu.push({ tid, name: thread.name, cpu: Math.round(100 * (thread.time - (threads.get(tid)?.time ?? 0)) / (now - last)) });
+				threads = current;
+				last = now;
+				//Get rtt reported by subscribers
+				const rtts = [];
+				for (const outgoingStream of outgoingStreams)
+					for (const track of outgoingStream.getTracks())
+						rtts.push(track.getStats().rtt);
+				rtts.sort((a, b) => a - b);
+				reply({
+					connected,
+					transports	: transports.length,
+					threads		: cpu.sort((a, b) => b.cpu - a.cpu),
+					rtt		: {
+						avg : rtts.length ? Math.round(rtts.reduce((sum, rtt) => sum + rtt, 0) / rtts.length) : 0,
+						p99 : rtts.length ? rtts[Math.min(rtts.length - 1, Math.floor(rtts.length * 0.99))] : 0,
+						max : rtts.length ? rtts[rtts.length - 1] : 0,
+					}
+				});
+				break;
+			}
+			case "stop":
+			{
+				for (const transport of transports)
+					transport.stop();
+				endpoint.stop();
+				MediaServer.terminate();
+				process.exit(0);
+			}
+		}
+	});
+}
+
+/**
+ * Media sources for publishers
+ */
+function createSource()
+{
+	if (params.mp4)
+	{
+		//Read media from file
+		const player = MediaServer.createPlayer(params.mp4);
+		return {
+			audio	: player.getAudioTracks()[0],
+			video	: player.getVideoTracks()[0],
+			start	: () => player.play({ repeat: true }),
+			stop	: () => player.stop(),
+		};
+	}
+	if (params.pcap)
+	{
+		if (!params.sdp)
+			throw new Error("--sdp is required to replay a pcap");
+		//Replay capture
+		const remote = SDPInfo.parse(FS.readFileSync(params.sdp, "utf8"));
+		const transport = MediaServer.createEmulatedTransport(params.pcap);
+		transport.setRemoteProperties(remote);
+		const tracks = Array.from(remote.getStreams().values()).flatMap(streamInfo => transport.createIncomingStream(streamInfo).getTracks());
+		return {
+			audio	: tracks.find(track => track.getMedia() === "audio"),
+			video	: tracks.find(track => track.getMedia() === "video"),
+			start	: () => transport.play(),
+			stop	: () => transport.stop(),
+		};
+	}
+	if (params.video)
+		throw new Error("synthetic source only supports audio, use --mp4 or --pcap for video");
+	//Generate synthetic audio with timestamps
+	const generator = SharedPointer(new Native.SyntheticRTPSourceShared(params.rate, params.size));
+	return {
+		createAudioTrack : (/** @type {string} */ id, /** @type {number} */ ssrc) => {
+			const source = SharedPointer(new Native.RTPIncomingSourceGroupShared(Utils.mediaToFrameType("audio"), generator.GetTimeService()));
+			source.media.ssrc = ssrc;
+			generator.AddIncomingSourceGroup(source, params.audio);
+			return new IncomingStreamTrack("audio", id, "audio", generator.GetTimeService(), SharedPointer(generator.toRTPReceiver()), {"": source});
+		},
+		start	: () => generator.Start(),
+		stop	: () => { generator.Stop(); generator.Clear(); },
+	};
+}
+
+/**
+ * Publishers and subscribers on the parent process
+ */
+async function client()
+{
+	//Fork server
+	const child = ChildProcess.fork(__filename, [...process.argv.slice(2), "--role=server"]);
+
+	//Request/response over ipc
+	let seq = 0;
+	const pending = new Map();
+	child.on("message", (/** @type {any} */ msg) => {
+		pending.get(msg.seq)?.(msg);
+		pending.delete(msg.seq);
+	});
+	const request = (/** @type {any} */ msg) => new Promise(resolve => {
+		pending.set(++seq, resolve);
+		child.send({ seq, ...msg });
+	});
+
+	//Create client endpoints, transports are spread over them
+	const endpoints = Array.from({ length: params.clients }, () => MediaServer.createEndpoint(ip));
+	const getEndpoint = (/** @type {number} */ i) => endpoints[i % endpoints.length];
+
+	const source = createSource();
+	if ((params.audio && !source.createAudioTrack && !source.audio) || (params.video && !source.video))
+		throw new Error("media source has no track for the requested codecs");
+	//Latency probe on subscribers, only meaningful for synthetic media
+	const probe = new Native.RTPLatencyProbe();
+	/** @type {import("../lib/Transport")[]} */
+	const transports = [];
+
+	//Create publishers
+	for (let i = 0; i < params.publishers; ++i)
+	{
+		const id = "publisher-" + i;
+		//Unique ssrcs for each publisher
+		const base = (i + 1) << 8;
+		const endpoint = getEndpoint(i);
+		const local = getLocalInfo(endpoint, Setup.ACTIVE);
+		//Stream announced to the server, with one ssrc per simulcast layer on the video track
+		const streamInfo = new StreamInfo(id);
+		//Local tracks sending each layer
+		const audio = [];
+		const video = [];
+		if (params.audio)
+		{
+			const trackInfo = new TrackInfo("audio", id + "-audio");
+			const ssrc = base;
+			trackInfo.addSSRC(ssrc);
+			streamInfo.addTrack(trackInfo);
+			audio.push({ id: trackInfo.getId(), ssrcs: { media: ssrc } });
+		}
+		if (params.video)
+		{
+			const trackInfo = new TrackInfo("video", id + "-video");
+			const ssrcs = [];
+			for (let layer = 0; layer < params.simulcast; ++layer)
+			{
+				const media = base + 2 * layer + 1;
+				const rtx = media + 1;
+				trackInfo.addSSRC(media);
+				trackInfo.addSSRC(rtx);
+				trackInfo.addSourceGroup(new SourceGroupInfo("FID", [media, rtx]));
+				ssrcs.push(media);
+				video.push({ id: trackInfo.getId() + "-" + layer, ssrcs: { media, rtx } });
+			}
+			//Group layers as simulcast
+			if (ssrcs.length > 1)
+				trackInfo.addSourceGroup(new SourceGroupInfo("SIM", ssrcs));
+			streamInfo.addTrack(trackInfo);
+		}
+
+		//Negotiate with server
+		const reply = await request({ type: "publish", peer: plainPeer(endpoint, local), stream: streamInfo.plain() });
+		const transport = createTransport(endpoint, reply.peer, local);
+		transports.push(transport);
+
+		//Create outgoing tracks with the announced ssrcs and attach them to the source
+		const outgoingStream = transport.createOutgoingStream({ id, audio, video });
+		for (const track of outgoingStream.getAudioTracks())
+			track.attachTo(source.createAudioTrack ? source.createAudioTrack(track.getId(), track.getSSRCs().media) : source.audio);
+		//All simulcast layers carry the same media
+		for (const track of outgoingStream.getVideoTracks())
+			track.attachTo(source.video);
+	}
+
+	//Create subscribers
+	for (let k = 0; k < params.subscribers; ++k)
+	{
+		const endpoint = getEndpoint(params.publishers + k);
+		const local = getLocalInfo(endpoint, Setup.ACTIVE);
+		const reply = await request({ type: "subscribe", peer: plainPeer(endpoint, local) });
+		const transport = createTransport(endpoint, reply.peer, local);
+		transports.push(transport);
+		for (const stream of reply.streams)
+		{
+			const incomingStream = transport.createIncomingStream(stream);
+			//Measure latency on arrival
+			for (const track of incomingStream.getAudioTracks())
+				probe.AddIncoming(SharedPointer.getPointer(track.getDefaultEncoding().source.toRTPIncomingMediaStream()));
+		}
+	}
+
+	//Start media
+	source.start();
+
+	const results = [];
+	const start = Date.now();
+	let usage = process.cpuUsage();
+	let last = Date.now();
+	//Discard initial stats
+	await request({ type: "stats" });
+	probe.Reset();
+
+	while (Date.now() - start < params.duration * 1000)
+	{
+		await sleep(params.interval * 1000);
+		//Get server and client stats
+		const stats = await request({ type: "stats" });
+		const latency = probe.GetStats();
+		const now = Date.now();
+		const clientUsage = process.cpuUsage(usage);
+		const result = {
+			time		: Math.round((now - start) / 1000),
+			connected	: stats.connected,
+			transports	: stats.transports,
+			serverCpu	: stats.threads.reduce((sum, thread) => sum + thread.cpu, 0),
+			clientCpu	: Math.round(100 * (clientUsage.user + clientUsage.system) / 1000 / (now - last)),
+			rttAvg		: stats.rtt.avg,
+			rttMax		: stats.rtt.max,
+			p50		: latency.p50,
+			p99		: latency.p99,
+			max		: latency.max,
+			threads		: stats.threads.filter(thread => thread.cpu > 0),
+		};
+		usage = process.cpuUsage();
+		last = now;
+		probe.Reset();
+		results.push(result);
+
+		if (!params.json)
+		{
+			const { threads, ...summary } = result;
+			console.log(Object.entries(summary).map(([key, value]) => `${key}:${value}`).join(" "));
+			console.table(threads);
+		}
+	}
+
+	if (params.json)
+		console.log(JSON.stringify({ params, results }, null, 2));
+
+	//Stop everything
+	source.stop();
+	for (const transport of transports)
+		transport.stop();
+	for (const endpoint of endpoints)
+		endpoint.stop();
+	//Wait for server to exit
+	await new Promise(resolve => {
+		child.once("exit", resolve);
+		child.send({ type: "stop" });
+	});
+	MediaServer.terminate();
+}
+
+if (args.role === "server")
+	server();
+else
+	client();
@@ -0,0 +1,52 @@
+/*
+ * Timer container benchmark.
+ *
+ * Compares the timer wheel used by the virtual time service against an ordered multimap under rtcp/nack like
+ * churn: the timers are kept scheduled, and each ms a quarter of them are cancelled, half are rescheduled and
+ * the due ones are expired. Reports the cost per operation in ns.
+ *
+ * Usage: npm run bench:timers -- [--timers=1000,10000,100000] [--duration=5000] [--timeout=1000] [--json]
+ */
+const Native		= require("../lib/Native");
+
+//Parse args
+const args = Object.fromEntries(process.argv.slice(2).map(arg => {
+	const [key, value] = arg.replace(/^--/, "").split("=");
+	return [key, value ?? "true"];
+}));
+const list = (/** @type {string} */ value, /** @type {string} */ def) => (value || def).split(",").map(Number);
+
+const params = {
+	timers		: list(args.timers, "1000,10000,100000"),
+	duration	: Number(args.duration || 5000),
+	timeout		: Number(args.timeout || 1000),
+	json		: args.json === "true",
+};
+
+const round = (/** @type {number} */ value) => Math.round(value * 10) / 10;
+
+const results = [];
+//Sweep number of timers
+for (const timers of params.timers)
+{
+	for (const [container, run] of /** @type {const} */ ([["wheel", "RunWheel"], ["multimap", "RunMultimap"]]))
+	{
+		const result = Native.TimerBenchmark[run](timers, params.duration, params.timeout);
+		results.push({
+			container	: container,
+			timers		: result.timers,
+			operations	: result.operations,
+			expired		: result.expired,
+			scheduleNs	: round(result.scheduleNs),
+			cancelNs	: round(result.cancelNs),
+			expireNs	: round(result.expireNs),
+		});
+		if (!params.json)
+			console.log(`container:${container} timers:${timers} schedule:${round(result.scheduleNs)}ns cancel:${round(result.cancelNs)}ns expire:${round(result.expireNs)}ns`);
+	}
+}
+//Output
+if (params.json)
+	console.log(JSON.stringify({ params, results }, null, 2));
+else
+	console.table(results);
@@ -4,233 +4,306 @@
 		'external_libmediaserver%'		: '<!(echo $LIBMEDIASERVER)',
 		'external_libmediaserver_include_dirs%'	: '<!(echo $LIBMEDIASERVER_INCLUDE)',
 		'medooze_media_server_src' : "<!(node -e \"require('medooze-media-server-src')\")",
+		#Build options, i.e. node-gyp configure -- -Dperfetto=0 -Dlto=1
+		'perfetto%'		: 1,
+		'lto%'			: 0,
+		#PGO: build with pgo_generate=1, run examples/pgo-training.js and rebuild with pgo_use=1
+		'pgo_generate%'		: 0,
+		'pgo_use%'		: 0,
+		'pgo_dir%'		: '<!(pwd)/build/pgo',
+		#Instruction set level, use i.e. x86-64-v2 for binaries that must run on other hosts
+		'isa%'			: 'native',
+		#Also build x86-64-v3 and x86-64-v4 variants of the addon, selected at runtime
+		'multi_isa%'		: 0,
 	},
-	"targets": 
-	[
+	"target_defaults":
+	{
+		"cflags": 
+		[
+			"-fexceptions",
+			"-O3",
+			"-g",
+			"-Wno-unused-function -Wno-comment",
+			#"-O0",
+			#"-fsanitize=address,leak",
+			#"-fsanitize-address-use-after-scope",
+                                #"-fno-omit-frame-pointer"
+		],
+		"cflags_cc": 
+		[
+			"-fexceptions",
+			"-std=c++17",
+			"-O3",
+			"-g",
+			"-Wno-unused-function",
+			#"-O0",
+			#"-fsanitize=address,leak",
+			#"-fsanitize-address-use-after-scope",
+                                #"-fno-omit-frame-pointer"
+		],
+		"include_dirs" : 
+		[
+			"external/perfetto",
+			"<!(node -e \"require('nan')\")"
+		],
+		"ldflags" : [" -lpthread -lresolv"],
+		"link_settings": 
 		{
-			"target_name": "medooze-media-server",
-			"cflags": 
+        			'libraries': ["-lpthread -lresolv"]
+      			},
+		"defines":
+		[
+			#"MEDOOZE_TRACING",
+		],
+		"sources": 
+		[ 
+			"external/perfetto/perfetto.cc",
+			"src/media-server_wrap.cxx",
+		],
+		"conditions":
+		[
 			[
-				"-march=native",
-				"-fexceptions",
-				"-O3",
-				"-g",
-				"-Wno-unused-function -Wno-comment",
-				#"-O0",
-				#"-fsanitize=address,leak",
-				#"-fsanitize-address-use-after-scope",
-                                #"-fno-omit-frame-pointer"
+				"perfetto==0",
+				{
+					"defines"	: [ "MEDOOZE_NO_PERFETTO" ],
+					"sources!"	:
+					[
+						"external/perfetto/perfetto.cc",
+						"<(medooze_media_server_src)/src/MedoozeTracing.cpp",
+					],
+				}
 			],
-			"cflags_cc": 
 			[
-				"-fexceptions",
-				"-std=c++17",
-				"-O3",
-				"-g",
-				"-Wno-unused-function",
-				#"-O0",
-				#"-fsanitize=address,leak",
-				#"-fsanitize-address-use-after-scope",
-                                #"-fno-omit-frame-pointer"
+				"lto==1",
+				{
+					"cflags"	: [ "-flto=auto" ],
+					"cflags_cc"	: [ "-flto=auto" ],
+					"ldflags"	: [ "-flto=auto", "-O3" ],
+				}
 			],
-			"include_dirs" : 
 			[
-				"external/perfetto",
-				"<!(node -e \"require('nan')\")"
+				"pgo_generate==1",
+				{
+					"cflags"	: [ "-fprofile-generate=<(pgo_dir)", "-fprofile-update=atomic" ],
+					"cflags_cc"	: [ "-fprofile-generate=<(pgo_dir)", "-fprofile-update=atomic" ],
+					"ldflags"	: [ "-fprofile-generate=<(pgo_dir)" ],
+				}
 			],
-			"ldflags" : [" -lpthread -lresolv"],
-			"link_settings": 
-			{
-        			'libraries': ["-lpthread -lresolv"]
-      			},
-			"defines":
 			[
-				#"MEDOOZE_TRACING",
+				"pgo_use==1",
+				{
+					"cflags"	: [ "-fprofile-use=<(pgo_dir)", "-fprofile-partial-training", "-Wno-missing-profile" ],
+					"cflags_cc"	: [ "-fprofile-use=<(pgo_dir)", "-fprofile-partial-training", "-Wno-missing-profile" ],
+					"ldflags"	: [ "-fprofile-use=<(pgo_dir)" ],
+				}
 			],
-			"sources": 
-			[ 
-				"external/perfetto/perfetto.cc",
-				"src/media-server_wrap.cxx",
-			],
-			"conditions":
 			[
-				[
-					"external_libmediaserver == ''", 
-					{
-						"include_dirs" :
-						[
-							'<(medooze_media_server_src)/include',
-							'<(medooze_media_server_src)/src',
-							'<(medooze_media_server_src)/ext/crc32c/include',
-							'<(medooze_media_server_src)/ext/libdatachannels/src',
-							'<(medooze_media_server_src)/ext/libdatachannels/src/internal',
-							'external/mp4v2/lib/include',
-							'external/mp4v2/config/include',
-							'external/srtp/include',
-							'<(node_root_dir)/deps/openssl/openssl/include'
-						],
-						"sources": 
-						[
-							"<(medooze_media_server_src)/ext/crc32c/src/crc32c.cc",
-							"<(medooze_media_server_src)/ext/crc32c/src/crc32c_portable.cc",
-							"<(medooze_media_server_src)/ext/crc32c/src/crc32c_sse42.cc",
-							"<(medooze_media_server_src)/ext/crc32c/src/crc32c_arm64.cc",
-							"<(medooze_media_server_src)/ext/libdatachannels/src/Datachannels.cpp",
-							"<(medooze_media_server_src)/src/MedoozeTracing.cpp",
-							"<(medooze_media_server_src)/src/ActiveSpeakerDetector.cpp",
-							"<(medooze_media_server_src)/src/ActiveSpeakerMultiplexer.cpp",
-							"<(medooze_media_server_src)/src/EventLoop.cpp",
-							"<(medooze_media_server_src)/src/SystemPoll.cpp",
-							"<(medooze_media_server_src)/src/PollSignalling.cpp",
-							"<(medooze_media_server_src)/src/NetEventLoop.cpp",
-							"<(medooze_media_server_src)/src/log.cpp",
-							"<(medooze_media_server_src)/src/PacketHeader.cpp",
-							"<(medooze_media_server_src)/src/MacAddress.cpp",
-							"<(medooze_media_server_src)/src/RTPBundleTransport.cpp",
-							"<(medooze_media_server_src)/src/DTLSICETransport.cpp",
-							"<(medooze_media_server_src)/src/VideoLayerSelector.cpp",
-							"<(medooze_media_server_src)/src/opus/opusdepacketizer.cpp",
-							"<(medooze_media_server_src)/src/h264/h264depacketizer.cpp",
-							"<(medooze_media_server_src)/src/h265/h265.cpp",
-							"<(medooze_media_server_src)/src/h265/H265Depacketizer.cpp",
-							"<(medooze_media_server_src)/src/h265/HEVCDescriptor.cpp",
-							"<(medooze_media_server_src)/src/vp8/vp8depacketizer.cpp",
-							"<(medooze_media_server_src)/src/h264/H264LayerSelector.cpp",
-							"<(medooze_media_server_src)/src/vp8/VP8LayerSelector.cpp",
-							"<(medooze_media_server_src)/src/vp9/VP9PayloadDescription.cpp",
-							"<(medooze_media_server_src)/src/vp9/VP9LayerSelector.cpp",
-							"<(medooze_media_server_src)/src/vp9/VP9Depacketizer.cpp",
-							"<(medooze_media_server_src)/src/av1/AV1Depacketizer.cpp",
-							"<(medooze_media_server_src)/src/av1/AV1LayerSelector.cpp",
-							"<(medooze_media_server_src)/src/av1/Obu.cpp",
-							"<(medooze_media_server_src)/src/SRTPSession.cpp",
-							"<(medooze_media_server_src)/src/dtls.cpp",
-							"<(medooze_media_server_src)/src/CPUMonitor.cpp",
-							"<(medooze_media_server_src)/src/OpenSSL.cpp",
-							"<(medooze_media_server_src)/src/RTPTransport.cpp",
-							"<(medooze_media_server_src)/src/httpparser.cpp",
-							"<(medooze_media_server_src)/src/stunmessage.cpp",
-							"<(medooze_media_server_src)/src/crc32calc.cpp",
-							"<(medooze_media_server_src)/src/http.cpp",
-							"<(medooze_media_server_src)/src/avcdescriptor.cpp",
-							"<(medooze_media_server_src)/src/utf8.cpp",
-							"<(medooze_media_server_src)/src/DependencyDescriptorLayerSelector.cpp",
-							"<(medooze_media_server_src)/src/rtp/DependencyDescriptor.cpp",
-							"<(medooze_media_server_src)/src/rtp/LayerInfo.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTCPCommonHeader.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPHeader.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPHeaderExtension.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTCPApp.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTCPExtendedJitterReport.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTCPPacket.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTCPReport.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTCPSenderReport.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPMap.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTCPBye.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTCPFullIntraRequest.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTCPPayloadFeedback.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTCPRTPFeedback.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPDepacketizer.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPPacket.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPPayload.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTCPCompoundPacket.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTCPNACK.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTCPReceiverReport.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTCPSDES.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPPacketSched.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPStreamTransponder.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPLostPackets.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPSource.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPIncomingMediaStreamMultiplexer.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPIncomingMediaStreamDepacketizer.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPIncomingSource.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPIncomingSourceGroup.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPOutgoingSource.cpp",
-							"<(medooze_media_server_src)/src/rtp/RTPOutgoingSourceGroup.cpp",
-							"<(medooze_media_server_src)/src/mp4recorder.cpp",
-							"<(medooze_media_server_src)/src/mp4streamer.cpp",
-							"<(medooze_media_server_src)/src/rtpsession.cpp",
-							"<(medooze_media_server_src)/src/RTPTransport.cpp",
-							"<(medooze_media_server_src)/src/PCAPFile.cpp",
-							"<(medooze_media_server_src)/src/PCAPReader.cpp",
-							"<(medooze_media_server_src)/src/PCAPTransportEmulator.cpp",
-							"<(medooze_media_server_src)/src/remoteratecontrol.cpp",
-							"<(medooze_media_server_src)/src/remoterateestimator.cpp",
-							"<(medooze_media_server_src)/src/SendSideBandwidthEstimation.cpp",
-							"<(medooze_media_server_src)/src/SimulcastMediaFrameListener.cpp",
-							"<(medooze_media_server_src)/src/ForwardErrorCorrection.cpp",
-							"<(medooze_media_server_src)/src/FecProbeGenerator.cpp",
-							"<(medooze_media_server_src)/src/MediaFrameListenerBridge.cpp",
-							"<(medooze_media_server_src)/src/FrameDelayCalculator.cpp",
-							"<(medooze_media_server_src)/src/FrameDispatchCoordinator.cpp",
-						],
-						"dependencies":
-						[
-							"external/mp4v2/libmp4v2.gyp:mp4v2",
-							"external/srtp/libsrtp.gyp:libsrtp",
-						],
+				"external_libmediaserver == ''", 
+				{
+					"include_dirs" :
+					[
+						'<(medooze_media_server_src)/include',
+						'<(medooze_media_server_src)/src',
+						'<(medooze_media_server_src)/ext/crc32c/include',
+						'<(medooze_media_server_src)/ext/libdatachannels/src',
+						'<(medooze_media_server_src)/ext/libdatachannels/src/internal',
+						'external/mp4v2/lib/include',
+						'external/mp4v2/config/include',
+						'external/srtp/include',
+						'<(node_root_dir)/deps/openssl/openssl/include'
+					],
+					"sources": 
+					[
+						"<(medooze_media_server_src)/ext/crc32c/src/crc32c.cc",
+						"<(medooze_media_server_src)/ext/crc32c/src/crc32c_portable.cc",
+						"<(medooze_media_server_src)/ext/crc32c/src/crc32c_sse42.cc",
+						"<(medooze_media_server_src)/ext/crc32c/src/crc32c_arm64.cc",
+						"<(medooze_media_server_src)/ext/libdatachannels/src/Datachannels.cpp",
+						"<(medooze_media_server_src)/src/MedoozeTracing.cpp",
+						"<(medooze_media_server_src)/src/ActiveSpeakerDetector.cpp",
+						"<(medooze_media_server_src)/src/ActiveSpeakerMultiplexer.cpp",
+						"<(medooze_media_server_src)/src/EventLoop.cpp",
+						"<(medooze_media_server_src)/src/SystemPoll.cpp",
+						"<(medooze_media_server_src)/src/PollSignalling.cpp",
+						"<(medooze_media_server_src)/src/NetEventLoop.cpp",
+						"<(medooze_media_server_src)/src/log.cpp",
+						"<(medooze_media_server_src)/src/PacketHeader.cpp",
+						"<(medooze_media_server_src)/src/MacAddress.cpp",
+						"<(medooze_media_server_src)/src/RTPBundleTransport.cpp",
+						"<(medooze_media_server_src)/src/DTLSICETransport.cpp",
+						"<(medooze_media_server_src)/src/VideoLayerSelector.cpp",
+						"<(medooze_media_server_src)/src/opus/opusdepacketizer.cpp",
+						"<(medooze_media_server_src)/src/h264/h264depacketizer.cpp",
+						"<(medooze_media_server_src)/src/h265/h265.cpp",
+						"<(medooze_media_server_src)/src/h265/H265Depacketizer.cpp",
+						"<(medooze_media_server_src)/src/h265/HEVCDescriptor.cpp",
+						"<(medooze_media_server_src)/src/vp8/vp8depacketizer.cpp",
+						"<(medooze_media_server_src)/src/h264/H264LayerSelector.cpp",
+						"<(medooze_media_server_src)/src/vp8/VP8LayerSelector.cpp",
+						"<(medooze_media_server_src)/src/vp9/VP9PayloadDescription.cpp",
+						"<(medooze_media_server_src)/src/vp9/VP9LayerSelector.cpp",
+						"<(medooze_media_server_src)/src/vp9/VP9Depacketizer.cpp",
+						"<(medooze_media_server_src)/src/av1/AV1Depacketizer.cpp",
+						"<(medooze_media_server_src)/src/av1/AV1LayerSelector.cpp",
+						"<(medooze_media_server_src)/src/av1/Obu.cpp",
+						"<(medooze_media_server_src)/src/SRTPSession.cpp",
+						"<(medooze_media_server_src)/src/dtls.cpp",
+						"<(medooze_media_server_src)/src/CPUMonitor.cpp",
+						"<(medooze_media_server_src)/src/OpenSSL.cpp",
+						"<(medooze_media_server_src)/src/RTPTransport.cpp",
+						"<(medooze_media_server_src)/src/httpparser.cpp",
+						"<(medooze_media_server_src)/src/stunmessage.cpp",
+						"<(medooze_media_server_src)/src/crc32calc.cpp",
+						"<(medooze_media_server_src)/src/http.cpp",
+						"<(medooze_media_server_src)/src/avcdescriptor.cpp",
+						"<(medooze_media_server_src)/src/utf8.cpp",
+						"<(medooze_media_server_src)/src/DependencyDescriptorLayerSelector.cpp",
+						"<(medooze_media_server_src)/src/rtp/DependencyDescriptor.cpp",
+						"<(medooze_media_server_src)/src/rtp/LayerInfo.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTCPCommonHeader.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPHeader.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPHeaderExtension.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTCPApp.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTCPExtendedJitterReport.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTCPPacket.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTCPReport.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTCPSenderReport.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPMap.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTCPBye.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTCPFullIntraRequest.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTCPPayloadFeedback.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTCPRTPFeedback.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPDepacketizer.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPPacket.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPPayload.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTCPCompoundPacket.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTCPNACK.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTCPReceiverReport.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTCPSDES.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPPacketSched.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPStreamTransponder.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPLostPackets.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPSource.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPIncomingMediaStreamMultiplexer.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPIncomingMediaStreamDepacketizer.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPIncomingSource.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPIncomingSourceGroup.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPOutgoingSource.cpp",
+						"<(medooze_media_server_src)/src/rtp/RTPOutgoingSourceGroup.cpp",
+						"<(medooze_media_server_src)/src/mp4recorder.cpp",
+						"<(medooze_media_server_src)/src/mp4streamer.cpp",
+						"<(medooze_media_server_src)/src/rtpsession.cpp",
+						"<(medooze_media_server_src)/src/RTPTransport.cpp",
+						"<(medooze_media_server_src)/src/PCAPFile.cpp",
+						"<(medooze_media_server_src)/src/PCAPReader.cpp",
+						"<(medooze_media_server_src)/src/PCAPTransportEmulator.cpp",
+						"<(medooze_media_server_src)/src/remoteratecontrol.cpp",
+						"<(medooze_media_server_src)/src/remoterateestimator.cpp",
+						"<(medooze_media_server_src)/src/SendSideBandwidthEstimation.cpp",
+						"<(medooze_media_server_src)/src/SimulcastMediaFrameListener.cpp",
+						"<(medooze_media_server_src)/src/ForwardErrorCorrection.cpp",
+						"<(medooze_media_server_src)/src/FecProbeGenerator.cpp",
+						"<(medooze_media_server_src)/src/MediaFrameListenerBridge.cpp",
+						"<(medooze_media_server_src)/src/FrameDelayCalculator.cpp",
+						"<(medooze_media_server_src)/src/FrameDispatchCoordinator.cpp",
+					],
+					"dependencies":
+					[
+						"external/mp4v2/libmp4v2.gyp:mp4v2",
+						"external/srtp/libsrtp.gyp:libsrtp",
+					],
   					        "conditions" : [
-								["target_arch=='ia32'", {
-									"include_dirs": [ "<(node_root_dir)/deps/openssl/config/piii" ]
-								}],
-								["target_arch=='x64'", {
-									"include_dirs": [ "<(node_root_dir)/deps/openssl/config/k8" ]
-								}],
-								["target_arch=='arm'", {
-									"include_dirs": [ "<(node_root_dir)/deps/openssl/config/arm" ]
-								}],
-								['OS=="mac"', {
-									"xcode_settings": {
-										"CLANG_CXX_LIBRARY": "libc++",
-										"CLANG_CXX_LANGUAGE_STANDARD": "c++17",
-										"OTHER_CFLAGS": [ "-Wno-aligned-allocation-availability","-Wno-aligned-allocation-unavailable","-march=native"]
-									},
-									"include_dirs": [  "<(medooze_media_server_src)/ext/crc32c/config/Darwin-i386" ],
-								}],
-								['OS=="linux"',{
-									"variables": {
-										"sse42_support": "<!(cat /proc/cpuinfo | grep -c sse4_2 || true)"
-									},
-									"conditions" : [
-										["target_arch=='x64'",{
-											"conditions"  : [["sse42_support==0",{
-												"include_dirs": [  "<(medooze_media_server_src)/ext/crc32c/config/Linux-x86_64_nosse42" ]
-											},{
-												"include_dirs": [  "<(medooze_media_server_src)/ext/crc32c/config/Linux-x86_64" ]
-											}]],
-											"include_dirs": [  "<(medooze_media_server_src)/ext/crc32c/config/Linux-arm64" ]
-										}],
-										["target_arch=='arm64'",{
-											"include_dirs": [  "<(medooze_media_server_src)/ext/crc32c/config/Linux-aarch64" ]
-										}]
-									],
-									"cflags_cc":  [
-										"-faligned-new",
-										"-DHAVE_STD_ALIGNED_ALLOCC",
-									]
-								}]
-						]
-					},
-					{
-						"libraries"	: [ "<(external_libmediaserver)" ],
-						"include_dirs"	: [ "<@(external_libmediaserver_include_dirs)" ],
-						'conditions':
-						[
-							['OS=="linux"', {
-								"ldflags" : [" -Wl,-Bsymbolic "],
+							["target_arch=='ia32'", {
+								"include_dirs": [ "<(node_root_dir)/deps/openssl/config/piii" ]
+							}],
+							["target_arch=='x64'", {
+								"include_dirs": [ "<(node_root_dir)/deps/openssl/config/k8" ]
+							}],
+							["target_arch=='arm'", {
+								"include_dirs": [ "<(node_root_dir)/deps/openssl/config/arm" ]
 							}],
 							['OS=="mac"', {
-									"xcode_settings": {
-										"CLANG_CXX_LIBRARY": "libc++",
-										"CLANG_CXX_LANGUAGE_STANDARD": "c++17",
-										"OTHER_CFLAGS": [ "-Wno-aligned-allocation-unavailable","-march=native"]
-									},
+								"xcode_settings": {
+									"CLANG_CXX_LIBRARY": "libc++",
+									"CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+									"OTHER_CFLAGS": [ "-Wno-aligned-allocation-availability","-Wno-aligned-allocation-unavailable","-march=<(isa)"]
+								},
+								"include_dirs": [  "<(medooze_media_server_src)/ext/crc32c/config/Darwin-i386" ],
 							}],
-						]
-					}
-				]
+							['OS=="linux"',{
+								"variables": {
+									#Check build host when targeting it, only x86-64-v2 and above levels have sse4.2
+									"sse42_support": "<!(case <(isa) in (native) cat /proc/cpuinfo | grep -c sse4_2 || true;; (x86-64-v[234]) echo 1;; (*) echo 0;; esac)"
+								},
+								"conditions" : [
+									["target_arch=='x64'",{
+										"conditions"  : [["sse42_support==0",{
+											"include_dirs": [  "<(medooze_media_server_src)/ext/crc32c/config/Linux-x86_64_nosse42" ]
+										},{
+											"include_dirs": [  "<(medooze_media_server_src)/ext/crc32c/config/Linux-x86_64" ]
+										}]],
+										"include_dirs": [  "<(medooze_media_server_src)/ext/crc32c/config/Linux-arm64" ]
+									}],
+									["target_arch=='arm64'",{
+										"include_dirs": [  "<(medooze_media_server_src)/ext/crc32c/config/Linux-aarch64" ]
+									}]
+								],
+								"cflags_cc":  [
+									"-faligned-new",
+									"-DHAVE_STD_ALIGNED_ALLOCC",
+								]
+							}]
+					]
+				},
+				{
+					"libraries"	: [ "<(external_libmediaserver)" ],
+					"include_dirs"	: [ "<@(external_libmediaserver_include_dirs)" ],
+					'conditions':
+					[
+						['OS=="linux"', {
+							"ldflags" : [" -Wl,-Bsymbolic "],
+						}],
+						['OS=="mac"', {
+								"xcode_settings": {
+									"CLANG_CXX_LIBRARY": "libc++",
+									"CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+									"OTHER_CFLAGS": [ "-Wno-aligned-allocation-unavailable","-march=<(isa)"]
+								},
+						}],
+					]
+				}
 			]
-		}
+		]
+	},
+	"targets": 
+	[
+		{
+			#Baseline, -march=native unless a portable isa level is set
+			"target_name": "medooze-media-server",
+			"cflags"	: [ "-march=<(isa)" ],
+			"cflags_cc"	: [ "-march=<(isa)" ],
+		},
+	],
+	"conditions":
+	[
+		[
+			"multi_isa==1 and target_arch=='x64' and OS=='linux'",
+			{
+				#Variants loaded at runtime by lib/Native.js depending on the cpu features
+				"targets":
+				[
+					{
+						"target_name": "medooze-media-server-x86-64-v3",
+						"cflags"	: [ "-march=x86-64-v3", "-mtune=generic" ],
+						"cflags_cc"	: [ "-march=x86-64-v3", "-mtune=generic" ],
+					},
+					{
+						"target_name": "medooze-media-server-x86-64-v4",
+						"cflags"	: [ "-march=x86-64-v4", "-mtune=generic" ],
+						"cflags_cc"	: [ "-march=x86-64-v4", "-mtune=generic" ],
+					},
+				]
+			}
+		]
 	]
 }
-
@@ -0,0 +1,80 @@
+/*
+ * Training workload for profile guided optimization builds.
+ *
+ * Replays an unencrypted transport dump as fast as possible with the virtual clock and forwards
+ * every incoming track to a plain RTP session over loopback, so the profile covers rtp parsing,
+ * jitter buffers, layer selection and sending.
+ *
+ * Usage: node examples/pgo-training.js <dump.pcap> <remote.sdp> [iterations]
+ */
+const FS		= require("fs");
+const SemanticSDP	= require("semantic-sdp");
+const {
+	SDPInfo,
+} = require("semantic-sdp");
+
+//Get the Medooze Media Server interface
+const MediaServer = require("../index");
+
+//Get args
+const [pcap, sdp, iterations = "1"] = process.argv.slice(2);
+
+if (!pcap || !sdp)
+{
+	console.error("Usage: node examples/pgo-training.js <dump.pcap> <remote.sdp> [iterations]");
+	process.exit(1);
+}
+
+//Parse remote description of the captured peer
+const remote = SDPInfo.parse(FS.readFileSync(sdp, "utf8"));
+
+async function replay()
+{
+	//Create emulated transport replaying on its own thread
+	const transport = MediaServer.createEmulatedTransport(pcap, { virtualClock: true });
+	//Set remote codecs and extensions
+	transport.setRemoteProperties(remote);
+
+	//Create streamer to forward media over loopback
+	const streamer = MediaServer.createStreamer();
+
+	//For each stream on the capture
+	for (const streamInfo of remote.getStreams().values())
+	{
+		//Create incoming stream
+		const incoming = transport.createIncomingStream(streamInfo);
+		//For each track
+		for (const track of incoming.getTracks())
+		{
+			//Get media info for the track
+			const media = remote.getMedia(track.getMedia());
+			//Create plain rtp session sending to the discard port
+			const session = streamer.createSession(media, {
+				noRTCP	: true,
+				remote	: { ip: "127.0.0.1", port: 9 }
+			});
+			//Forward
+			session.getOutgoingStreamTrack().attachTo(track);
+		}
+	}
+
+	//Wait until capture is replayed
+	await new Promise((resolve) => {
+		transport.once("ended", (self, packets, time) => {
+			console.log(`replayed ${packets} packets in ${time} virtual ms`);
+			resolve(undefined);
+		});
+		transport.play();
+	});
+
+	//Clean up
+	transport.stop();
+	streamer.stop();
+}
+
+(async () => {
+	for (let i = 0; i < parseInt(iterations); ++i)
+		await replay();
+	//Exit so profile data is written
+	MediaServer.terminate();
+})();
@@ -34,9 +34,10 @@ export type {
 	ReceiverReport,
 } from "./build/types/OutgoingStreamTrack";
 
-export type { CreateTransportOptions, RawTxOptions, PeerInfo, ParsedPeerInfo } from "./build/types/Endpoint";
+export type { CreateTransportOptions, RawTxOptions, RawTxStats, PeerInfo, ParsedPeerInfo } from "./build/types/Endpoint";
 export type { Frame, FrameType } from "./build/types/IncomingStreamTrackReader";
-export type { RecorderParams } from "./build/types/Recorder";
+export type { RecorderParams, TimeShiftStats } from "./build/types/Recorder";
 export type { SDPState } from "./build/types/SDPManager";
 export type { LayerSelection, SetTargetBitrateOptions } from "./build/types/Transponder";
-export type { DTLSState, ICEStats, TransportStats, TransportDumpOptions, CreateStreamOptions, CreateStreamTrackOptions, SSRCs } from "./build/types/Transport";
+export type { TracingParams } from "./build/types/Tracing";
+export type { DTLSState, ICEStats, TransportStats, TransportDumpOptions, CreateStreamOptions, CreateStreamTrackOptions, SSRCs, CandidateRawTxStats } from "./build/types/Transport";
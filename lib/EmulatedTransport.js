@@ -19,10 +19,40 @@ const {
 } = require("semantic-sdp");
 
 const Utils		= require("./Utils");
+const SharedPointer	= require("./SharedPointer");
+const IncomingStreamTrack = require("./IncomingStreamTrack");
+
+/**
+ * @typedef {Object} EmulatedTransportParams
+ * @property {boolean} [virtualClock] Replay the capture as fast as possible on its own thread driving a virtual clock, so timers fire deterministically at capture time instead of wall clock time.
+ * Only RTP is replayed on this mode: RTCP on the capture is ignored (no sender reports nor RTT) and no feedback is sent. RTX packets are delivered as the original media packet, padding only ones are dropped.
+ * @property {number} [packetPoolSize] Number of packets preallocated for replay, only used on virtual clock mode (defaults to 0, grown on demand)
+ * @property {number} [maxPacketPoolSize] Maximum number of pooled packets, further ones are allocated from heap (defaults to 0, unbounded)
+ */
+
+/**
+ * @typedef {Object} PacketPoolStats
+ * @property {number} capacity Number of packets allocated by the pool
+ * @property {number} maxSize Maximum number of packets of the pool (0 if unbounded)
+ * @property {number} outstanding Number of packets in use
+ * @property {number} highWaterMark Maximum number of packets in use at the same time
+ * @property {number} hits Packets picked from the free list of the calling thread
+ * @property {number} misses Packets that required refilling the thread free list from the shared one, or growing the pool
+ * @property {number} grows Number of times the pool has grown
+ * @property {number} overflows Packets allocated from heap because the pool was at its maximum size
+ */
+
+/**
+ * @typedef {Object} EmulatedTransportEvents
+ * @property {(self: EmulatedTransport) => void} stopped
+ * @property {(self: EmulatedTransport, packets: number, time: number) => void} ended Virtual clock replay reached the end of the capture (`packets` is the number of RTP packets replayed and `time` the virtual clock time in ms)
+ */
 
 /**
  * An emulated transport reads data from a unencrypted pcap file (typically from a transport dump), and acts like if it was a live transport from a remote peer.
  * You must create the incoming streams as signaled on the remote SDP as any incoming RTP with an unknown ssrc will be ignored. The emulated transport does not allow creating outgoing streams.
+ * When using the virtual clock mode several emulated transports can replay in parallel, each one on its own thread.
+ * @extends {Emitter<EmulatedTransportEvents>}
  */
 class EmulatedTransport extends Emitter
 {
@@ -31,18 +61,35 @@ class EmulatedTransport extends Emitter
 	 * @hideconstructor
 	 * private constructor
 	 */
-	constructor(/** @type {string | Native.UDPReader} */ pcap)
+	constructor(
+		/** @type {string | Native.UDPReader} */ pcap,
+		/** @type {EmulatedTransportParams} */ params = {})
 	{
 		//Init emitter
 		super();
 
+		//Check replay mode
+		this.virtualClock = !!params.virtualClock;
+
 		//Create native emulator
-		this.transport = new Native.PCAPTransportEmulator();
+		/** @type {Native.PCAPTransportEmulator | SharedPointer.Proxy<Native.PCAPVirtualTransportEmulatorShared>} */
+		this.transport = this.virtualClock
+			? SharedPointer(new Native.PCAPVirtualTransportEmulatorShared(this))
+			: new Native.PCAPTransportEmulator();
 		
+		//Size packet pool
+		if (this.virtualClock && (params.packetPoolSize || params.maxPacketPoolSize))
+			/** @type {Native.PCAPVirtualTransportEmulator} */ (this.transport).SetPacketPoolSize(
+				Number.isInteger(params.packetPoolSize) ? Number(params.packetPoolSize) : 0,
+				Number.isInteger(params.maxPacketPoolSize) ? Number(params.maxPacketPoolSize) : 0
+			);
+
 		//Check if it is a path or a reader
 		if (typeof pcap === "string")
-			//Open file
-			this.transport.Open(pcap);
+			//Open memory mapped file, virtual emulator always maps it
+			this.virtualClock
+				? this.transport.Open(pcap)
+				: /** @type {Native.PCAPTransportEmulator} */ (this.transport).OpenMapped(pcap);
 		else
 			//Set reader
 			this.transport.SetReader(pcap);
@@ -52,8 +99,54 @@ class EmulatedTransport extends Emitter
 		
 		//Create new sequence generator
 		this.lfsr = new LFSR();
+
+		//Listener for virtual clock replay end
+		this.onended = (/** @type {number} */ packets, /** @type {number} */ time) => {
+			this.emit("ended",this,packets,time);
+		};
+	}
+
+	/**
+	 * Set cpu affinity of the replay thread, only available on virtual clock mode
+	 * @param {Number} cpu - CPU core or -1 to reset affinity.
+	 * @returns {boolean} 
+	 */
+	setAffinity(cpu)
+	{
+		return this.virtualClock && /** @type {Native.PCAPVirtualTransportEmulator} */ (this.transport).SetAffinity(cpu);
+	}
+
+	/**
+	 * Set name of the replay thread, only available on virtual clock mode
+	 * @param {String} name
+	 * @returns {boolean} 
+	 */
+	setThreadName(name)
+	{
+		return this.virtualClock && /** @type {Native.PCAPVirtualTransportEmulator} */ (this.transport).SetThreadName(name);
 	}
 	
+	/**
+	 * Get packet pool stats, only available on virtual clock mode
+	 * @returns {PacketPoolStats | undefined}
+	 */
+	getPacketPoolStats()
+	{
+		if (!this.virtualClock)
+			return undefined;
+		const stats = /** @type {Native.PCAPVirtualTransportEmulator} */ (this.transport).GetPacketPoolStats();
+		return {
+			capacity	: stats.capacity,
+			maxSize		: stats.maxSize,
+			outstanding	: stats.outstanding,
+			highWaterMark	: stats.highWaterMark,
+			hits		: stats.hits,
+			misses		: stats.misses,
+			grows		: stats.grows,
+			overflows	: stats.overflows,
+		};
+	}
+
 	/**
 	 * Set remote RTP properties 
 	 * @param {Utils.RTPProperties | SDPInfo} rtp
@@ -73,6 +166,26 @@ class EmulatedTransport extends Emitter
 	 */
 	createIncomingStream(info)
 	{
+		//If using virtual clock
+		if (this.virtualClock)
+		{
+			//Create stream
+			const incomingStream = new IncomingStream(info.getId(), /** @type {any} */ (this));
+			//Add to list
+			this.incomingStreams.set(incomingStream.getId(),incomingStream);
+			//Add listener
+			incomingStream.once("stopped",() => {
+				//Remove it
+				this.incomingStreams.delete(incomingStream.getId());
+			});
+			//For each tracks
+			for (let trackInfo of info.getTracks().values())
+				//Create new track from info
+				incomingStream.createTrack(trackInfo.getMedia(), trackInfo);
+			//Return it
+			return incomingStream;
+		}
+
 		//We have to add the incmoing source for this stream
 		let incomingStream = new IncomingStream(this.transport,new Native.RTPReceiverFacade(this.transport),info);
 		
@@ -89,6 +202,64 @@ class EmulatedTransport extends Emitter
 		return incomingStream;
 	}
 	
+	/**
+	 * Create new incoming stream track, only available on virtual clock mode
+	 * @param {SemanticSDP.TrackType} media Track media type
+	 * @param {TrackInfo} trackInfo Track info
+	 * @param {IncomingStream} [incomingStream] Stream to add the track to, if any
+	 * @returns {IncomingStreamTrack} The new incoming stream track
+	 */
+	createIncomingStreamTrack(media, trackInfo, incomingStream)
+	{
+		//Get virtual emulator
+		const transport = /** @type {SharedPointer.Proxy<Native.PCAPVirtualTransportEmulatorShared>} */ (this.transport);
+		
+		//Create source map
+		/** @type {IncomingStreamTrack.NativeSourceMap} */
+		const sources = {};
+
+		//For each encoding source found on track info
+		for (const encodingSource of trackInfo.getEncodingSources())
+		{
+			//Create native source
+			const source = SharedPointer(new Native.RTPIncomingSourceGroupShared(
+				Utils.mediaToFrameType(media),
+				transport.GetTimeService())
+			);
+			//Set source ssrcs
+			source.media.ssrc	= encodingSource.media ?? this.lfsr.seq(31);
+			source.rtx.ssrc		= encodingSource.rtx ?? 0;
+			//Add it
+			transport.AddIncomingSourceGroup(source);
+			//Add to sources
+			sources[encodingSource.id] = source;
+		}
+
+		//Create new track
+		const incomingStreamTrack = new IncomingStreamTrack(
+			media,
+			trackInfo.getId(),
+			trackInfo.getMediaId(),
+			transport.GetTimeService(),
+			SharedPointer(transport.toRTPReceiver()),
+			sources
+		);
+
+		//Add listener
+		incomingStreamTrack.once("stopped",()=>{
+			//For each source
+			for (const id of Object.keys(sources))
+				//Remove source group
+				transport.RemoveIncomingSourceGroup(sources[id]);
+		});
+
+		//Add it to the stream
+		if (incomingStream) incomingStream.addTrack(incomingStreamTrack);
+
+		//Return it
+		return incomingStreamTrack;
+	}
+
 	/**
 	 * Starts playback
 	 * @param {Object} params	
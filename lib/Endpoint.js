@@ -1,5 +1,6 @@
 const NetworkUtils			= require("./NetworkUtils");
 const Native				= require("./Native");
+const SharedPointer			= require("./SharedPointer");
 const Emitter			= require("medooze-event-emitter");
 const Transport				= require("./Transport");
 const PeerConnectionServer		= require("./PeerConnectionServer");
@@ -100,7 +101,70 @@ function parsePeerInfo(/** @type {PeerInfo | SemanticSDP.SDPInfo} */ info)
  * @property {number} [sndBuf]    AF_PACKET socket send queue
  */
 
-/** @typedef {Native.RTPBundleTransport & { rawTxInterface?: number }} NativeBundle */
+/**
+ * @typedef {Object} RawTxStats Raw TX ring stats of an endpoint shard
+ * @property {boolean} enabled If raw TX is enabled on the shard
+ * @property {number} frames Number of frames of the ring
+ * @property {number} pending Number of frames queued and not flushed yet
+ * @property {number} maxBatch Max number of frames flushed at once
+ * @property {number} queued Number of packets queued on the ring
+ * @property {number} flushes Number of times the ring has been flushed to the kernel
+ * @property {number} ringFull Number of times a frame was not available because the kernel had not sent it yet
+ * @property {number} sendErrors Number of failed flushes
+ * @property {number} wrongFormat Number of frames rejected by the kernel
+ */
+
+/** @typedef {Native.RTPBundleTransportFacade & { rawTxInterface?: number, handshakeMonitor?: SharedPointer.Proxy<Native.DTLSHandshakeMonitorShared> }} NativeBundle */
+
+/** @typedef {import("./EmulatedTransport").PacketPoolStats} PacketPoolStats */
+
+/**
+ * @typedef {Object} LoadStats Load of the thread of an endpoint shard, times in microseconds
+ * @property {number} period Sampling period in ms
+ * @property {number} samples Number of samples taken
+ * @property {number} elapsed Time since sampling started
+ * @property {number} busy Cpu time used by the thread since sampling started
+ * @property {number} idle Time the thread was not using the cpu since sampling started
+ * @property {number} load Ratio of cpu time used by the thread on the last sampling period, from 0 to 1
+ * @property {number} wakeups Times the thread was woken up after waiting for events
+ * @property {number} preemptions Times the thread was preempted by other threads
+ * @property {number} timerLagAvg Average delay of the timers
+ * @property {number} timerLagMax Max delay of the timers
+ * @property {{ bound: number, count: number }[]} timerLag Histogram of timer delays, last bucket has no bound
+ * @property {number} asyncDelay Last time an async task waited on the loop queue
+ * @property {number} asyncDelayMax Max time an async task waited on the loop queue
+ * @property {number} asyncPending Async tasks waiting on the loop queue for more than a period
+ */
+
+/**
+ * @typedef {Object} DTLSHandshakeStats DTLS handshakes of the transports of an endpoint shard, times in microseconds
+ * @property {number} started Number of handshakes started
+ * @property {number} connected Number of handshakes finished successfully
+ * @property {number} failed Number of failed handshakes
+ * @property {number} aborted Number of handshakes not finished because the transport was closed
+ * @property {number} pending Number of handshakes in progress
+ * @property {number} maxPending Max number of handshakes in progress at the same time
+ * @property {number} latencyLast Duration of the last successful handshake
+ * @property {number} latencyAvg Average duration of the successful handshakes
+ * @property {number} latencyMax Max duration of the successful handshakes
+ * @property {{ bound: number, count: number }[]} latency Histogram of handshake durations, last bucket has no bound
+ */
+
+//Default load sampling period in ms
+const LoadMonitorPeriod = 100;
+
+/**
+ * Get the shard serving an ICE username, so the same local ICE info always maps to the same shard
+ * @returns {number}
+ */
+function getShardIndex(/** @type {string} */ username, /** @type {number} */ shards)
+{
+	//FNV-1a
+	let hash = 0x811c9dc5;
+	for (let i = 0; i < username.length; ++i)
+		hash = Math.imul(hash ^ username.charCodeAt(i), 0x01000193);
+	return (hash >>> 0) % shards;
+}
 
 /**
  * @typedef {Object} EndpointEvents
@@ -111,6 +175,8 @@ function parsePeerInfo(/** @type {PeerInfo | SemanticSDP.SDPInfo} */ info)
  * An endpoint represent an UDP server socket.
  * The endpoint will process STUN requests in order to be able to associate the remote ip:port with the registered transport and forward any further data comming from that transport.
  * Being a server it is ICE-lite.
+ * An endpoint can be sharded across several UDP sockets, each one serviced by its own thread, so a single endpoint
+ * scales across cores. Transports are assigned to a shard based on their local ICE username and announce the candidates of its socket.
  * @extends {Emitter<EndpointEvents>}
  */
 class Endpoint extends Emitter
@@ -122,37 +188,61 @@ class Endpoint extends Emitter
 	 */
 	constructor(
 		/** @type {string | string[]} */ ip,
-		packetPoolSize = 0)
+		packetPoolSize = 0,
+		shards = 1,
+		maxPacketPoolSize = 0)
 	{
 		//Init emitter
 		super();
 
 		//Store ip address of the endpoint
 		this.ips = Array.isArray(ip) ? ip : [ip];
-		//Create native endpoint
+		//Create native endpoint, one per shard
+		/** @type {NativeBundle[]} */
+		this.bundles = [];
+		for (let i=0; i<Math.max(shards, 1); ++i)
+		{
+			const bundle = new Native.RTPBundleTransportFacade(packetPoolSize, maxPacketPoolSize);
+			//Start it
+			if (!bundle.Init())
+			{
+				//End already started ones
+				for (const started of this.bundles)
+					started.End();
+				//Throw errror
+				throw new Error("Could not initialize bundle for endpoint");
+			}
+			//Account handshakes of its transports
+			bundle.handshakeMonitor = SharedPointer(new Native.DTLSHandshakeMonitorShared());
+			this.bundles.push(bundle);
+		}
+		//Main bundle
 		/** @type {NativeBundle} */
-		this.bundle = new Native.RTPBundleTransport(packetPoolSize);
-		//Start it
-		if (!this.bundle.Init())
-			//Throw errror
-			throw new Error("Could not initialize bundle for endpoint");
+		this.bundle = this.bundles[0];
 		//Store all transports
 		this.transports = /** @type {Set<Transport>} */ (new Set());
-		//Create candidates 
-		this.candidates = /** @type {CandidateInfo[]} */ ([]);
 		//Default
 		this.defaultSRTPProtectionProfiles = "";
-		//Create candidates
-		for (let i=0; i<this.ips.length; i++) 
-		{
-			//Calculate priority in descending order
-			let priority = Math.pow(2,24)*126 + Math.pow(2,8)*(65535-i) + 255;
-			//Add new RTP UPD local candidate
-			this.candidates.push(new CandidateInfo("1", 1, "UDP", priority, this.ips[i], this.bundle.GetLocalPort(), "host"));
-		}
+		//Create candidates for each shard
+		this.shardCandidates = this.bundles.map((bundle) => {
+			const candidates = /** @type {CandidateInfo[]} */ ([]);
+			for (let i=0; i<this.ips.length; i++) 
+			{
+				//Calculate priority in descending order
+				let priority = Math.pow(2,24)*126 + Math.pow(2,8)*(65535-i) + 255;
+				//Add new RTP UPD local candidate
+				candidates.push(new CandidateInfo("1", 1, "UDP", priority, this.ips[i], bundle.GetLocalPort(), "host"));
+			}
+			return candidates;
+		});
+		//Candidates of main bundle
+		this.candidates = this.shardCandidates[0];
 		//Get fingerprint (global at media server level currently)
 		this.fingerprint = Native.MediaServer.GetFingerprint().toString();
 
+		//Load monitors of each shard, created on demand
+		this.loadMonitors = /** @type {SharedPointer.Proxy<Native.EventLoopMonitorShared>[]} */ ([]);
+
 		//Mirrored streams and tracks
 		this.mirrored = {
 			streams : /** @type {WeakMap<IncomingStream, IncomingStream>} */ (new WeakMap()),
@@ -163,13 +253,90 @@ class Endpoint extends Emitter
 	
 	/**
 	 * Set cpu affinity for udp send/recv thread.
-	 * @param {Number}  cpu - CPU core or -1 to reset affinity.
+	 * On sharded endpoints, each shard thread is pinned to the consecutive cores starting at cpu, or to the core on the same position if an array is passed.
+	 * @param {Number | Number[]}  cpu - CPU core or -1 to reset affinity.
 	 * @returns {boolean} true if operation was successful
 	 */
 	setAffinity(cpu)
 	{
-		//Set cpu affinity
-		return this.bundle.SetAffinity(parseInt(cpu));
+		//Set cpu affinity on each shard
+		return this.bundles.every((bundle, i) => {
+			const core = Array.isArray(cpu) ? cpu[i % cpu.length] : (cpu < 0 ? cpu : cpu + i);
+			return bundle.SetAffinity(parseInt(core));
+		});
+	}
+
+	/**
+	 * Get number of shards of the endpoint
+	 * @returns {number}
+	 */
+	getShards()
+	{
+		return this.bundles.length;
+	}
+
+	/**
+	 * Get the load of the thread of each shard, in order to balance transports by measured load.
+	 * Load is sampled periodically on each thread, starting on the first call.
+	 * @param {number} [period] Sampling period in ms, only used on first call
+	 * @returns {LoadStats[]}
+	 */
+	getLoadStats(period = LoadMonitorPeriod)
+	{
+		//Start sampling
+		if (!this.loadMonitors.length)
+			this.loadMonitors = this.bundles.map((bundle) => SharedPointer(new Native.EventLoopMonitorShared(bundle.GetTimeService(), period)));
+
+		return this.loadMonitors.map((monitor) => {
+			const stats = monitor.GetStats();
+			const timerLag = [];
+			for (let i = 0; i < monitor.GetTimerLagBuckets(); ++i)
+				timerLag.push({ bound: monitor.GetTimerLagBound(i), count: monitor.GetTimerLagCount(i) });
+			return {
+				period		: stats.period,
+				samples		: stats.samples,
+				elapsed		: stats.elapsed,
+				busy		: stats.busy,
+				idle		: stats.idle,
+				load		: stats.load,
+				wakeups		: stats.wakeups,
+				preemptions	: stats.preemptions,
+				timerLagAvg	: stats.timerLagAvg,
+				timerLagMax	: stats.timerLagMax,
+				timerLag	: timerLag,
+				asyncDelay	: stats.asyncDelay,
+				asyncDelayMax	: stats.asyncDelayMax,
+				asyncPending	: stats.asyncPending,
+			};
+		});
+	}
+
+	/**
+	 * Get the DTLS handshakes stats of the transports of each shard, in order to detect handshake storms
+	 * stalling the shard thread.
+	 * @returns {DTLSHandshakeStats[]}
+	 */
+	getDTLSHandshakeStats()
+	{
+		return this.bundles.map((bundle) => {
+			const monitor = /** @type {SharedPointer.Proxy<Native.DTLSHandshakeMonitorShared>} */ (bundle.handshakeMonitor);
+			const stats = monitor.GetStats();
+			const latency = [];
+			for (let i = 0; i < monitor.GetLatencyBuckets(); ++i)
+				latency.push({ bound: monitor.GetLatencyBound(i), count: monitor.GetLatencyCount(i) });
+			return {
+				started		: stats.started,
+				connected	: stats.connected,
+				failed		: stats.failed,
+				aborted		: stats.aborted,
+				pending		: stats.pending,
+				maxPending	: stats.maxPending,
+				latencyLast	: stats.latencyLast,
+				latencyAvg	: stats.latencyAvg,
+				latencyMax	: stats.latencyMax,
+				latency		: latency,
+			};
+		});
 	}
 
 	/** 
@@ -190,18 +357,66 @@ class Endpoint extends Emitter
 	{
 		// if false was passed, disable raw TX sending
 		if (options === false) {
-			this.bundle.ClearRawTx();
-			delete this.bundle.rawTxInterface;
+			for (const bundle of this.bundles)
+			{
+				bundle.ClearRawTx();
+				delete bundle.rawTxInterface;
+			}
 			return;
 		}
 		// gather necessary information and pass it to the bundle
 		const config = await NetworkUtils.getInterfaceRawConfig(options.interfaceName);
-		const port = this.getLocalPort();
-		this.bundle.SetRawTx(
-			config.index, options.sndBuf || 0, !!options.skipQdisc,
-			config.lladdr, ...config.defaultRoute, port,
-		);
-		this.bundle.rawTxInterface = config.index;
+		for (const bundle of this.bundles)
+		{
+			bundle.SetRawTx(
+				config.index, options.sndBuf || 0, !!options.skipQdisc,
+				config.lladdr, ...config.defaultRoute, bundle.GetLocalPort(),
+			);
+			bundle.rawTxInterface = config.index;
+		}
+	}
+
+	/**
+	 * Get stats of the pool of the packets created by the bindings on each endpoint shard
+	 * @returns {PacketPoolStats[]}
+	 */
+	getPacketPoolStats()
+	{
+		return this.bundles.map((bundle) => {
+			const stats = bundle.GetPacketPoolStats();
+			return {
+				capacity	: stats.capacity,
+				maxSize		: stats.maxSize,
+				outstanding	: stats.outstanding,
+				highWaterMark	: stats.highWaterMark,
+				hits		: stats.hits,
+				misses		: stats.misses,
+				grows		: stats.grows,
+				overflows	: stats.overflows,
+			};
+		});
+	}
+
+	/**
+	 * Get raw TX ring stats of each endpoint shard. Per candidate counters are available on each transport.
+	 * @returns {RawTxStats[]}
+	 */
+	getRawTxStats()
+	{
+		return this.bundles.map((bundle) => {
+			const stats = bundle.GetRawTxStats();
+			return {
+				enabled		: stats.enabled,
+				frames		: stats.ring.frames,
+				pending		: stats.ring.pending,
+				maxBatch	: stats.ring.maxBatch,
+				queued		: stats.ring.queued,
+				flushes		: stats.ring.flushes,
+				ringFull	: stats.ring.ringFull,
+				sendErrors	: stats.ring.sendErrors,
+				wrongFormat	: stats.ring.wrongFormat,
+			};
+		});
 	}
 
 	/**
@@ -209,13 +424,20 @@ class Endpoint extends Emitter
 	 *
 	 * Useful for debugging or tracing. Currently only supported
 	 * on Linux, fails on other platforms.
-	 * Length is limited to 16 bytes.
+	 * Length is limited to 16 bytes. On sharded endpoints the shard index is appended to the name.
 	 * @param {String}  name - thread name to set
 	 * @returns {boolean} true if operation was successful
 	 */
 	setThreadName(name)
 	{
-		return this.bundle.SetThreadName(name);
+		//Single shard
+		if (this.bundles.length == 1)
+			return this.bundle.SetThreadName(name);
+		//Append index keeping it within limits
+		return this.bundles.every((bundle, i) => {
+			const suffix = "-" + i;
+			return bundle.SetThreadName(name.substring(0, 15 - suffix.length) + suffix);
+		});
 	}
 
 	/**
@@ -226,8 +448,8 @@ class Endpoint extends Emitter
 	 */
 	setPriority(priority)
 	{
-		//Set cpu affinity
-		return this.bundle.SetPriority(parseInt(priority));
+		//Set priority on each shard
+		return this.bundles.every((bundle) => bundle.SetPriority(parseInt(priority)));
 	}
 	
 	/**
@@ -236,17 +458,28 @@ class Endpoint extends Emitter
 	 */
 	setIceTimeout(timeout)
 	{
-		//Set it
-		return this.bundle.SetIceTimeout(timeout);
+		//Set it on each shard
+		const results = this.bundles.map((bundle) => bundle.SetIceTimeout(timeout));
+		//Return same result as the main bundle
+		return results[0];
 	}
 
 	/**
-	 * Get port at which UDP socket is bound
+	 * Get port at which UDP socket is bound, for sharded endpoints the one of the first shard
 	 */
 	getLocalPort()
 	{
 		return this.bundle.GetLocalPort()
 	}
+
+	/**
+	 * Get ports at which the UDP socket of each shard is bound
+	 * @returns {number[]}
+	 */
+	getLocalPorts()
+	{
+		return this.bundles.map((bundle) => bundle.GetLocalPort());
+	}
 	
 	/**
 	 * Create a new transport object and register it with the remote ICE username and password
@@ -268,15 +501,20 @@ class Endpoint extends Emitter
 		const local = parsePeerInfo(localInfo || {
 			ice		: ICEInfo.generate(true),
 			dtls		: new DTLSInfo(Setup.reverse(remote.dtls.getSetup(),  options?.prefferDTLSSetupActive), "sha-256", this.fingerprint),
-			candidates	: this.candidates
 		});
 		
+		//Get shard for the local username
+		const shard = getShardIndex(local.ice.getUfrag(), this.bundles.length);
+		//Announce its candidates if not provided, or if sharded as they must match the shard socket
+		if (!local.candidates.length || this.bundles.length > 1)
+			local.candidates = this.shardCandidates[shard];
+
 		//Set lite nd end of candidates to ICE info
 		local.ice.setLite(true);
 		local.ice.setEndOfCandidates(true);
 
 		//Create native tranport and return wrapper
-		const transport = new Transport(this.bundle, remote, local, Object.assign({
+		const transport = new Transport(this.bundles[shard], remote, local, Object.assign({
 				 disableSTUNKeepAlive	: false,
 				 srtpProtectionProfiles : this.defaultSRTPProtectionProfiles
 			}, options)
@@ -296,12 +534,16 @@ class Endpoint extends Emitter
 	}
 	/**
 	 * Get local ICE candidates for this endpoint. It will be shared by all the transport associated to this endpoint.
+	 * On sharded endpoints, pass the local ICE info to get the candidates of the shard the transport will be created on.
+	 * @param {SemanticSDP.ICEInfo} [ice] Local ICE info
 	 * @returns {Array<CandidateInfo>}
 	 */
-	getLocalCandidates() 
+	getLocalCandidates(ice) 
 	{
 		//Return local host candiadate as array
-		return this.candidates;
+		return ice
+			? this.shardCandidates[getShardIndex(ice.getUfrag(), this.bundles.length)]
+			: this.candidates;
 	}
 	
 	
@@ -323,11 +565,13 @@ class Endpoint extends Emitter
 	 */
 	createOffer(capabilities, params)
 	{
+		//Generate local ICE info
+		const ice = ICEInfo.generate(true);
 		//Create offer
 		return SDPInfo.create({
 			dtls		: new DTLSInfo(Setup.ACTPASS,"sha-256",this.fingerprint),
-			ice		: ICEInfo.generate(true),
-			candidates	: this.getLocalCandidates(),
+			ice		: ice,
+			candidates	: this.getLocalCandidates(ice),
 			capabilities	: capabilities,
 			unified		: !!params?.unified,
 			streams         : params?.streams,
@@ -509,9 +753,15 @@ class Endpoint extends Emitter
 			mirror.stop();
 		
 		this.emit("stopped",this);
+
+		//Stop sampling load
+		for (const monitor of this.loadMonitors)
+			monitor.Stop();
+		this.loadMonitors = [];
 		
-		//End bundle
-		this.bundle.End();
+		//End bundles
+		for (const bundle of this.bundles)
+			bundle.End();
 		
 		//Stop emitter
 		super.stop();
@@ -519,6 +769,7 @@ class Endpoint extends Emitter
 		//Remove bundle reference, so destructor is called on GC
 		//@ts-expect-error
 		this.bundle = null;
+		this.bundles = [];
 	}
 }
 
@@ -113,6 +113,18 @@ const {
  * @property {SharedPointer.Proxy<Native.RTPIncomingSourceGroupShared>} source
  * @property {SharedPointer.Proxy<Native.RTPReceiverShared>} receiver
  * @property {SharedPointer.Proxy<Native.RTPIncomingMediaStreamDepacketizerShared>} depacketizer
+ * @property {SharedPointer.Proxy<Native.RTPLayerFanoutShared>} [fanout] Layer fanout shared by the transponders, if enabled
+ * @property {SharedPointer.Proxy<Native.MediaFrameHubShared>} [frames] Hub sharing the depacketized frames with the mirrored tracks, if mirrored
+ */
+
+/**
+ * @typedef {Object} LayerFanoutStats Stats of the layer fanout of an encoding
+ * @property {number} groups Number of layer groups
+ * @property {number} listeners Number of transponders listening to any group
+ * @property {number} packets Incoming packets
+ * @property {number} forwarded Packets forwarded by all groups
+ * @property {number} dropped Packets dropped by all groups by layer selection
+ * @property {number} rewritten Packets cloned to renumber them or change its marker bit
  */
 
 /**
@@ -138,6 +150,7 @@ const {
  * @property {ActiveEncodingInfo[]} active
  * @property {Array<LayerStats & { encodingId: string }>} layers
  * @property {{ id: string }[]} inactive
+ * @property {number} [version] Stats version the table was built from, only set on the table shared by the transponders of the track
  */
 
 /** @returns {EncodingStats} */
@@ -390,6 +403,27 @@ function updateStatsSimulcastIndexAndCodec(/** @type {TrackStats} */ stats)
 }
 
 
+/**
+ * Freeze a shared active layers table, so callers can't modify it by mistake
+ * @param {ActiveLayersInfo} info
+ * @returns {Readonly<ActiveLayersInfo>}
+ */
+function freezeActiveLayers(info)
+{
+	for (const encoding of info.active)
+	{
+		encoding.layers.forEach(Object.freeze);
+		Object.freeze(encoding.layers);
+	}
+	info.active.forEach(Object.freeze);
+	info.inactive.forEach(Object.freeze);
+	info.layers.forEach(Object.freeze);
+	Object.freeze(info.active);
+	Object.freeze(info.inactive);
+	Object.freeze(info.layers);
+	return Object.freeze(info);
+}
+
 /** @returns {ActiveLayersInfo} */
 function getActiveLayersFromStats(/** @type {TrackStats} */ stats)
 {
@@ -509,12 +543,38 @@ function getActiveLayersFromStats(/** @type {TrackStats} */ stats)
 	};
 }
 
+/** @returns {Native.LayerSelector} */
+function loadLayerSelector(/** @type {Native.LayerSelector} */ selector, /** @type {ActiveLayersInfo} */ info)
+{
+	//Remove previous layers and orderings
+	selector.Clear();
+	//Add layers in table order
+	for (const layer of info.layers)
+	{
+		//Get actual or target dimensions
+		const width  = layer.width || layer.targetWidth;
+		const height = layer.height || layer.targetHeight;
+		//Add it, layers without bitrate are never selected
+		selector.AddLayer(
+			layer.bitrate ?? NaN,
+			layer.targetBitrate || 0,
+			layer.spatialLayerId ?? LayerInfo.MaxLayerId,
+			layer.temporalLayerId ?? LayerInfo.MaxLayerId,
+			layer.simulcastIdx ?? -1,
+			width ?? -1,
+			height ?? -1
+		);
+	}
+	return selector;
+}
+
 /**
  * @template Self
  * @template Encoding
  * @typedef {Object} IncomingStreamTrackEvents
  * @property {(self: Self, encoding: Encoding) => void} encoding New encoding (right now, this is only used by {@link IncomingStreamTrackMirrored} and {@link IncomingStreamTrackSimulcastAdapter})
  * @property {(self: Self, encoding: Encoding) => void} encodingremoved The encoding has been removed
+ * @property {(self: Self, enabled: boolean) => void} layerfanout The layer fanout has been enabled or disabled
  * @property {(self: Self) => void} attached
  * @property {(self: Self) => void} detached
  * @property {(muted: boolean) => void} muted
@@ -557,6 +617,17 @@ class IncomingStreamTrack extends Emitter
 
 		//Cached stats
 		this.stats = /** @type {TrackStats} */ ({});
+		//If transponders are grouped by layers
+		this.layerFanout = false;
+		//Pool for the packets rewritten by the layer fanout, set by the transport
+		this.packetPool = /** @type {SharedPointer.Proxy<Native.PacketPoolShared> | undefined} */ (undefined);
+		//Incremented each time the cached stats are refreshed
+		this.statsVersion = 0;
+		//Active layers table shared by all callers, rebuilt only when stats version changes
+		this.activeLayers = /** @type {Readonly<ActiveLayersInfo> | null} */ (null);
+		//Native layer selector and the table it has been loaded with
+		this.layerSelector = /** @type {Native.LayerSelector | null} */ (null);
+		this.layerSelectorInfo = /** @type {ActiveLayersInfo | null} */ (null);
 	
 		//Create info
 		this.trackInfo = new TrackInfo(media, id);
@@ -631,8 +702,14 @@ class IncomingStreamTrack extends Emitter
 			this.trackInfo.addEncoding(encodingInfo);
 		}
 
+		//If using layer fanout
+		if (this.layerFanout)
+			//Create it for the new encoding too
+			encoding.fanout = SharedPointer(new Native.RTPLayerFanoutShared(source.toRTPIncomingMediaStream(), this.packetPool));
+
 		//Init stats
 		this.stats[encoding.id] = getEncodingStats(encoding);
+		this.statsVersion++;
 
 		//Emit encoding event, nobody will be listening when called from constructor
 		this.emit("encoding", this, encoding);
@@ -646,6 +723,8 @@ class IncomingStreamTrack extends Emitter
 	{
 		//Get current timestamp
 		const ts = Date.now();
+		//If any stat has been refreshed
+		let refreshed = false;
 		//For each encoding
 		for (let encoding of this.encodings.values())
 		{
@@ -658,11 +737,19 @@ class IncomingStreamTrack extends Emitter
 					await new Promise(resolve=>encoding.source.UpdateAsync({resolve}));
 				//If not stopped while waiting
 				if (encoding.source)
+				{
 					//Push new encoding
 					this.stats[encoding.id] = getEncodingStats(encoding);
+					refreshed = true;
+				}
 			}
 		}
 		
+		//If stats have changed
+		if (refreshed)
+			//New version
+			this.statsVersion++;
+		
 		//Update silmulcast index for layers
 		updateStatsSimulcastIndexAndCodec(this.stats);
 
@@ -678,6 +765,8 @@ class IncomingStreamTrack extends Emitter
 	{
 		//Get current timestamp
 		const ts = Date.now();
+		//If any stat has been refreshed
+		let refreshed = false;
 		//For each encoding
 		for (let encoding of this.encodings.values())
 		{
@@ -690,9 +779,15 @@ class IncomingStreamTrack extends Emitter
 					encoding.source.Update();
 				//Push new encoding
 				this.stats[encoding.id] = getEncodingStats(encoding);
+				refreshed = true;
 			}
 		}
 		
+		//If stats have changed
+		if (refreshed)
+			//New version
+			this.statsVersion++;
+		
 		//Update silmulcast index for layers
 		updateStatsSimulcastIndexAndCodec(this.stats);
 		
@@ -700,6 +795,15 @@ class IncomingStreamTrack extends Emitter
 		return this.stats;
 	}
 	
+	/**
+	 * Get the version of the cached stats, it is incremented each time they are refreshed
+	 * @returns {number}
+	 */
+	getStatsVersion()
+	{
+		return this.statsVersion;
+	}
+
 	/**
 	 * Get active encodings and layers ordered by bitrate
 	 * @returns {ActiveLayersInfo} Active layers object containing an array of active and inactive encodings and an array of all available layer info
@@ -726,6 +830,63 @@ class IncomingStreamTrack extends Emitter
 		return getActiveLayersFromStats(stats);
 	}
 
+	/**
+	 * Get the active layers table shared by all the transponders of the track, only rebuilt when stats are refreshed.
+	 * It is deeply frozen, as it is the same object for all the callers.
+	 * @ignore
+	 * @returns {Readonly<ActiveLayersInfo>}
+	 */
+	getSharedActiveLayers()
+	{
+		return this.getActiveLayersForVersion(this.getStats());
+	}
+
+	/**
+	 * Get the active layers table shared by all the transponders of the track, only rebuilt when stats are refreshed.
+	 * @ignore
+	 * @returns {Promise<Readonly<ActiveLayersInfo>>}
+	 */
+	async getSharedActiveLayersAsync()
+	{
+		return this.getActiveLayersForVersion(await this.getStatsAsync());
+	}
+
+	/**
+	 * @ignore
+	 * @param {TrackStats} stats
+	 * @returns {Readonly<ActiveLayersInfo>}
+	 */
+	getActiveLayersForVersion(stats)
+	{
+		//If stats have been refreshed since the table was built
+		if (!this.activeLayers || this.activeLayers.version !== this.statsVersion)
+			//Rebuild it
+			this.activeLayers = freezeActiveLayers(Object.assign(getActiveLayersFromStats(stats), { version: this.statsVersion }));
+		//Shared table
+		return this.activeLayers;
+	}
+
+	/**
+	 * Get the native layer selector loaded with the active layers table, so the layer orderings are computed once for all transponders
+	 * @ignore
+	 * @param {Readonly<ActiveLayersInfo>} info Active layers table returned by getSharedActiveLayers()
+	 * @returns {Native.LayerSelector | null} null if the table is not the current one anymore
+	 */
+	getLayerSelector(info)
+	{
+		//Only for current table
+		if (info !== this.activeLayers)
+			return null;
+		//If not loaded yet
+		if (this.layerSelectorInfo !== info)
+		{
+			//Load it, previous orderings are discarded
+			this.layerSelector = loadLayerSelector(this.layerSelector || new Native.LayerSelector(), info);
+			this.layerSelectorInfo = info;
+		}
+		return this.layerSelector;
+	}
+
 	/**
 	* Get track id as signaled on the SDP
 	*/
@@ -808,6 +969,62 @@ class IncomingStreamTrack extends Emitter
 		return [...this.encodings.values()][0];
 	}
 
+	/**
+	 * Enable or disable the layer fanout. When enabled, transponders attached to this track are grouped by
+	 * selected encoding and layers, and the layer selection is done once per group instead of once per transponder.
+	 * Useful for tracks with a large number of viewers. Attached transponders are moved to or from the fanout
+	 * waiting for the next intra frame.
+	 * @param {boolean} enabled
+	 */
+	setLayerFanout(enabled)
+	{
+		//If not changed
+		if (this.layerFanout === !!enabled)
+			return;
+		//Store it
+		this.layerFanout = !!enabled;
+		//For each encoding
+		for (const encoding of this.encodings.values())
+		{
+			if (this.layerFanout)
+			{
+				//Create fanout
+				encoding.fanout = SharedPointer(new Native.RTPLayerFanoutShared(encoding.source.toRTPIncomingMediaStream(), this.packetPool));
+			} else if (encoding.fanout) {
+				//Stop it, transponders attached to any of its groups will stop receiving
+				encoding.fanout.Stop();
+				delete encoding.fanout;
+			}
+		}
+		//Let transponders reattach
+		this.emit("layerfanout", this, this.layerFanout);
+	}
+
+	/**
+	 * Get layer fanout stats for each encoding
+	 * @returns {{ [encodingId: string]: LayerFanoutStats }}
+	 */
+	getLayerFanoutStats()
+	{
+		const stats = /** @type {{ [encodingId: string]: LayerFanoutStats }} */ ({});
+		//For each encoding with fanout
+		for (const encoding of this.encodings.values())
+		{
+			if (!encoding.fanout)
+				continue;
+			const fanout = encoding.fanout.GetStats();
+			stats[encoding.id] = {
+				groups		: fanout.groups,
+				listeners	: fanout.listeners,
+				packets		: fanout.packets,
+				forwarded	: fanout.forwarded,
+				dropped		: fanout.dropped,
+				rewritten	: fanout.rewritten,
+			};
+		}
+		return stats;
+	}
+
 	/**
 	 * Signal that this track has been attached.
 	 * Internal use, you'd beter know what you are doing before calling this method
@@ -970,11 +1187,14 @@ class IncomingStreamTrack extends Emitter
 				this.simulcastDepacketizer.Detach(encoding.depacketizer.toMediaFrameProducer());
 			//Stop the depacketizer
 			encoding.depacketizer.Stop();
+			//Stop fanout
+			if (encoding.fanout) encoding.fanout.Stop();
 			//Stop source
 			encoding.source.Stop();
 			//Get last stats
 			this.stats[encoding.id] = getEncodingStats(encoding);
 		}
+		this.statsVersion++;
 
 		//Stop global depacketizer
 		if (this.depacketizer) this.depacketizer.Stop();
@@ -997,6 +1217,8 @@ class IncomingStreamTrack extends Emitter
 
 IncomingStreamTrack.sortByBitrateReverse = sortByBitrateReverse;
 IncomingStreamTrack.getActiveLayersFromStats = getActiveLayersFromStats;
+IncomingStreamTrack.freezeActiveLayers = freezeActiveLayers;
+IncomingStreamTrack.loadLayerSelector = loadLayerSelector;
 IncomingStreamTrack.updateStatsSimulcastIndexAndCodec = updateStatsSimulcastIndexAndCodec;
 
 module.exports = IncomingStreamTrack;
@@ -20,15 +20,65 @@ const {
 /**
  * @typedef {Object} Encoding
  * this type is like {@link IncomingStreamTrack.Encoding} except that `source` is renamed to a new `mirror`
- * property, and then the `source` property is instead backed by a `RTPIncomingMediaStreamMultiplexer`.
+ * property, and then the `source` property is instead backed by a `RTPIncomingMediaStreamBridge`.
  *
  * @property {string} id
  * @property {SharedPointer.Proxy<Native.RTPIncomingSourceGroupShared>} mirror
- * @property {SharedPointer.Proxy<Native.RTPIncomingMediaStreamMultiplexerShared>} source
+ * @property {SharedPointer.Proxy<Native.RTPIncomingMediaStreamBridgeShared>} source
  * @property {SharedPointer.Proxy<Native.RTPReceiverShared>} receiver
- * @property {SharedPointer.Proxy<Native.RTPIncomingMediaStreamDepacketizerShared>} depacketizer
+ * @property {SharedPointer.Proxy<Native.MediaFrameMirrorShared>} depacketizer Frames of the original encoding depacketizer, delivered on this track loop
  */
 
+/**
+ * @typedef {Object} MirrorStats Stats of the frames handed from the original track loop to the mirror loop
+ * @property {number} capacity Max number of queued frames
+ * @property {number} depth Currently queued frames
+ * @property {number} maxDepth Max number of queued frames seen
+ * @property {number} backlog Frames currently waiting on the original track loop for room in the queue
+ * @property {number} pushed Frames queued by the original track loop
+ * @property {number} delivered Frames delivered on the mirror loop
+ * @property {number} deferred Frames that had to wait on the original track loop because the queue was full
+ * @property {number} dropped Frames dropped because both the queue and the backlog were full, or because they were not decodable after a lost one
+ * @property {number} wakeups Times the mirror loop was woken up to deliver queued frames
+ */
+
+/**
+ * @typedef {Object} BridgeStats Stats of the channel handing packets from the original track loop to the mirror loop, shared by all the streams mirrored between both loops
+ * @property {number} bridges Number of streams mirrored between both loops
+ * @property {number} capacity Max number of queued packets
+ * @property {number} depth Currently queued packets
+ * @property {number} maxDepth Max number of queued packets seen
+ * @property {number} backlog Packets currently waiting on the original track loop for room in the queue
+ * @property {number} pushed Packets queued by the original track loop
+ * @property {number} delivered Packets delivered on the mirror loop
+ * @property {number} deferred Packets that had to wait on the original track loop because the queue was full
+ * @property {number} dropped Packets dropped because both the queue and the backlog were full
+ * @property {number} wakeups Times the mirror loop was woken up to deliver queued packets
+ */
+
+/**
+ * Max number of packets queued between two loops, used when the first stream is mirrored between them
+ */
+const BridgeQueueSize = 4096;
+
+/**
+ * Max number of frames queued between the original track loop and the mirror loop
+ */
+const MirrorQueueSize = 256;
+
+/**
+ * Get the hub sharing the depacketized frames of an encoding with all its mirrors
+ * @param {IncomingStreamTrack.Encoding} encoding
+ */
+function getFrameHub(encoding)
+{
+	//Create it on first mirror
+	if (!encoding.frames)
+		//Frames are delivered on the loop of the original source
+		encoding.frames = SharedPointer(new Native.MediaFrameHubShared(encoding.depacketizer.toMediaFrameProducer(), encoding.source.GetTimeService()));
+	return encoding.frames;
+}
+
 /**
  * Mirror incoming stream from another endpoint. Used to avoid inter-thread synchronization when attaching multiple output streams.
  * @extends {Emitter<IncomingStreamTrack.IncomingStreamTrackEvents<IncomingStreamTrackMirrored, Encoding>>}
@@ -66,14 +116,14 @@ class IncomingStreamTrackMirrored extends Emitter
 			//If we had it
 			if (old)
 			{
-				//Stop multiplexer source
+				//Stop bridged source
 				old.source.Stop();
 				//Stop the depacketizer
 				old.depacketizer.Stop();
 			}
 
 			//Create mirrored source
-			const source = SharedPointer(new Native.RTPIncomingMediaStreamMultiplexerShared(encoding.source.toRTPIncomingMediaStream(), timeService));
+			const source = SharedPointer(new Native.RTPIncomingMediaStreamBridgeShared(encoding.source.toRTPIncomingMediaStream(), timeService, BridgeQueueSize));
 
 			//Get mirror encoding
 			const mirrored = {
@@ -81,7 +131,8 @@ class IncomingStreamTrackMirrored extends Emitter
 				source		: source,
 				mirror		: encoding.source,
 				receiver	: encoding.receiver,
-				depacketizer	: SharedPointer(new Native.RTPIncomingMediaStreamDepacketizerShared(source.toRTPIncomingMediaStream()))
+				//Don't depacketize again, get the frames already depacketized by the original encoding
+				depacketizer	: SharedPointer(new Native.MediaFrameMirrorShared(getFrameHub(encoding), timeService, MirrorQueueSize))
 			};
 
 			//Push new encoding
@@ -108,7 +159,7 @@ class IncomingStreamTrackMirrored extends Emitter
 			//If found
 			if (mirrored)
 			{
-				//Stop multiplexer source
+				//Stop bridged source
 				mirrored.source.Stop();
 				//Stop the depacketizer
 				mirrored.depacketizer.Stop();				
@@ -127,6 +178,59 @@ class IncomingStreamTrackMirrored extends Emitter
 		});
 	}
 	
+	/**
+	 * Get the stats of the frames handed to this mirror for each encoding
+	 * @returns {{ [encodingId: string]: MirrorStats }}
+	 */
+	getMirrorStats()
+	{
+		/** @type {{ [encodingId: string]: MirrorStats }} */
+		const stats = {};
+		for (const [id, encoding] of this.encodings)
+		{
+			const mirror = encoding.depacketizer.GetStats();
+			stats[id] = {
+				capacity	: mirror.capacity,
+				depth		: mirror.depth,
+				maxDepth	: mirror.maxDepth,
+				backlog		: mirror.backlog,
+				pushed		: mirror.pushed,
+				delivered	: mirror.delivered,
+				deferred	: mirror.deferred,
+				dropped		: mirror.dropped,
+				wakeups		: mirror.wakeups,
+			};
+		}
+		return stats;
+	}
+
+	/**
+	 * Get the stats of the channel handing the packets to this mirror for each encoding
+	 * @returns {{ [encodingId: string]: BridgeStats }}
+	 */
+	getBridgeStats()
+	{
+		/** @type {{ [encodingId: string]: BridgeStats }} */
+		const stats = {};
+		for (const [id, encoding] of this.encodings)
+		{
+			const channel = encoding.source.GetChannelStats();
+			stats[id] = {
+				bridges		: channel.bridges,
+				capacity	: channel.capacity,
+				depth		: channel.depth,
+				maxDepth	: channel.maxDepth,
+				backlog		: channel.backlog,
+				pushed		: channel.pushed,
+				delivered	: channel.delivered,
+				deferred	: channel.deferred,
+				dropped		: channel.dropped,
+				wakeups		: channel.wakeups,
+			};
+		}
+		return stats;
+	}
+
 	/**
 	 * Get stats for all encodings from the original track
 	 */
@@ -143,6 +247,24 @@ class IncomingStreamTrackMirrored extends Emitter
 		return this.track.getStatsAsync();
 	}
 
+	/**
+	 * Get the stats version of the original track
+	 */
+	getStatsVersion()
+	{
+		return this.track.getStatsVersion();
+	}
+
+	/**
+	 * Get the native layer selector of the original track
+	 * @ignore
+	 * @param {IncomingStreamTrack.ActiveLayersInfo} info
+	 */
+	getLayerSelector(info)
+	{
+		return this.track.getLayerSelector(info);
+	}
+
 	/**
 	 * Get active encodings and layers ordered by bitrate of the original track
 	 */
@@ -159,6 +281,24 @@ class IncomingStreamTrackMirrored extends Emitter
 		return this.track.getActiveLayersAsync();
 	}
 
+	/**
+	 * Get the active layers table of the original track shared by all its transponders
+	 * @ignore
+	 */
+	getSharedActiveLayers()
+	{
+		return this.track.getSharedActiveLayers();
+	}
+
+	/**
+	 * Get the active layers table of the original track shared by all its transponders
+	 * @ignore
+	 */
+	async getSharedActiveLayersAsync()
+	{
+		return this.track.getSharedActiveLayersAsync();
+	}
+
 	/**
 	* Get track id as signaled on the SDP
 	*/
@@ -340,7 +480,7 @@ class IncomingStreamTrackMirrored extends Emitter
 		//for each mirrored encoding
 		for (let encoding of this.encodings.values())
 		{
-			//Stop multiplexer source
+			//Stop bridged source
 			encoding.source.Stop();
 			//Stop the depacketizer
 			encoding.depacketizer.Stop();
@@ -55,6 +55,11 @@ class IncomingStreamTrackSimulcastAdapter extends Emitter
 		//Create source maps
 		this.encodings = /** @type {Map<string, Encoding>} */ (new Map());
 		this.encodingPerTrack = /** @type {Map<IncomingStreamTrack, Map<string, Encoding>>} */ (new Map());
+		//Active layers table shared by all callers, rebuilt only when tracks or its stats change
+		this.activeLayers = /** @type {Readonly<IncomingStreamTrack.ActiveLayersInfo> | null} */ (null);
+		//Native layer selector and the table it has been loaded with
+		this.layerSelector = /** @type {Native.LayerSelector | null} */ (null);
+		this.layerSelectorInfo = /** @type {IncomingStreamTrack.ActiveLayersInfo | null} */ (null);
 
 		//Create a simulcast frame listerner
 		this.depacketizer = SharedPointer(new Native.SimulcastMediaFrameListenerShared(timeService, 1, 0));
@@ -135,6 +140,8 @@ class IncomingStreamTrackSimulcastAdapter extends Emitter
 
 		//Add encodings to map
 		this.encodingPerTrack.set(incomingStreamTrack,encodings);
+		//Rebuild active layers
+		this.activeLayers = null;
 
 		//Emit pending encoding events (it is important to defer this until now,
 		//when the track is fully added and the new encodings we're emitting
@@ -169,6 +176,8 @@ class IncomingStreamTrackSimulcastAdapter extends Emitter
 		this.depacketizer.SetNumLayers(this.encodings.size);
 		//Remove from map
 		this.encodingPerTrack.delete(incomingStreamTrack);
+		//Rebuild active layers
+		this.activeLayers = null;
 
 		//Remove stop listeners
 		incomingStreamTrack.off("stopped",this.onstopped);
@@ -247,6 +256,19 @@ class IncomingStreamTrackSimulcastAdapter extends Emitter
 		return stats;
 	}
 	
+	/**
+	 * Get the stats version, it changes each time the stats of any of the tracks are refreshed
+	 * @returns {number}
+	 */
+	getStatsVersion()
+	{
+		let version = 0;
+		//Versions only grow, so the sum changes if any of them does
+		for (const track of this.encodingPerTrack.keys())
+			version += track.getStatsVersion();
+		return version;
+	}
+
 	/**
 	 * Get active encodings and layers ordered by bitrate of the original track
 	 */
@@ -271,6 +293,64 @@ class IncomingStreamTrackSimulcastAdapter extends Emitter
 		return IncomingStreamTrack.getActiveLayersFromStats(stats);
 	}
 
+	/**
+	 * Get the active layers table shared by all the transponders of the track, only rebuilt when stats are refreshed
+	 * @ignore
+	 * @returns {Readonly<IncomingStreamTrack.ActiveLayersInfo>}
+	 */
+	getSharedActiveLayers()
+	{
+		return this.getActiveLayersForVersion(this.getStats());
+	}
+
+	/**
+	 * Get the active layers table shared by all the transponders of the track, only rebuilt when stats are refreshed
+	 * @ignore
+	 * @returns {Promise<Readonly<IncomingStreamTrack.ActiveLayersInfo>>}
+	 */
+	async getSharedActiveLayersAsync()
+	{
+		return this.getActiveLayersForVersion(await this.getStatsAsync());
+	}
+
+	/**
+	 * @ignore
+	 * @param {IncomingStreamTrack.TrackStats} stats
+	 * @returns {Readonly<IncomingStreamTrack.ActiveLayersInfo>}
+	 */
+	getActiveLayersForVersion(stats)
+	{
+		//Get current version
+		const version = this.getStatsVersion();
+		//If tracks or stats have changed since the table was built
+		if (!this.activeLayers || this.activeLayers.version !== version)
+			//Rebuild it
+			this.activeLayers = IncomingStreamTrack.freezeActiveLayers(Object.assign(IncomingStreamTrack.getActiveLayersFromStats(stats), { version }));
+		//Shared table
+		return this.activeLayers;
+	}
+
+	/**
+	 * Get the native layer selector loaded with the active layers table
+	 * @ignore
+	 * @param {Readonly<IncomingStreamTrack.ActiveLayersInfo>} info Active layers table returned by getSharedActiveLayers()
+	 * @returns {Native.LayerSelector | null} null if the table is not the current one anymore
+	 */
+	getLayerSelector(info)
+	{
+		//Only for current table
+		if (info !== this.activeLayers)
+			return null;
+		//If not loaded yet
+		if (this.layerSelectorInfo !== info)
+		{
+			//Load it, previous orderings are discarded
+			this.layerSelector = IncomingStreamTrack.loadLayerSelector(this.layerSelector || new Native.LayerSelector(), info);
+			this.layerSelectorInfo = info;
+		}
+		return this.layerSelector;
+	}
+
 	/**
 	* Get track id as signaled on the SDP
 	*/
@@ -1,6 +1,7 @@
  /** @namespace */
 const MediaServer = {};
 
+const os					= require("os");
 const Native					= require("./Native.js");
 const Endpoint					= require("./Endpoint");
 const Streamer					= require("./Streamer");
@@ -12,6 +13,7 @@ const EmulatedTransport				= require("./EmulatedTransport");
 const IncomingStreamTrackSimulcastAdapter	= require("./IncomingStreamTrackSimulcastAdapter");
 const IncomingStreamTrackReader			= require("./IncomingStreamTrackReader");
 const SharedPointer				= require("./SharedPointer.js");
+const Tracing					= require("./Tracing");
 
 const SemanticSDP	= require("semantic-sdp");
 const {
@@ -35,6 +37,45 @@ const defaultSeed = new LFSR(8, 92914);
 
 const endpoints	  = new Set();
 
+/**
+ * @typedef {Object} EventLoopPoolParams
+ * @property {number} [size] Number of event loops, defaults to the number of cpus
+ * @property {number} [firstCore] Pin each event loop to a core starting on this one, not pinned if not set
+ * @property {string} [name] Thread name prefix of the event loops
+ */
+
+/**
+ * @typedef {Object} EventLoopPoolStats
+ * @property {number} size Number of event loops
+ * @property {number} borrowed Number of borrowed event loops
+ * @property {number} minLoad Borrowers of the least loaded event loop
+ * @property {number} maxLoad Borrowers of the most loaded event loop
+ * @property {number[]} loads Borrowers of each event loop
+ */
+
+/** @type {EventLoopPoolParams} */
+let eventLoopPoolParams = {};
+/** @type {Native.EventLoopPool | null} */
+let eventLoopPool = null;
+//Stopped pools kept alive until all their loops are returned
+/** @type {Set<Native.EventLoopPool>} */
+const stoppedEventLoopPools = new Set();
+//Tracks using a loop borrowed from the pool
+/** @type {Set<IncomingStreamTrackSimulcastAdapter>} */
+const eventLoopBorrowers = new Set();
+
+//Get shared event loop pool, creating it on first use
+function getEventLoopPool()
+{
+	if (!eventLoopPool)
+		eventLoopPool = new Native.EventLoopPool(
+			eventLoopPoolParams.size ?? os.cpus().length,
+			eventLoopPoolParams.firstCore ?? -1,
+			eventLoopPoolParams.name ?? "mediaserver-pool"
+		);
+	return eventLoopPool;
+}
+
 //Replace default seeed
 LFSR.prototype._defaultSeed = function(/** @type {number} */ n) {
 	if (!n) throw new Error('n is required');
@@ -64,6 +105,12 @@ MediaServer.getDTLSFingerprint = function()
 	return Native.MediaServer.GetFingerprint().toString();
 }
 
+/**
+ * In-process tracing control
+ * @memberof MediaServer
+ */
+MediaServer.tracing = Tracing;
+
 /**
  * Close async handlers so nodejs can exit nicely
  * Only call it once!
@@ -74,6 +121,21 @@ MediaServer.terminate = function()
 	//Stop all endpoints
 	for (const endpoint of endpoints)
 		endpoint.stop();
+
+	//Stop the tracks using the shared event loops first, so they return them
+	for (const track of eventLoopBorrowers)
+		track.stop();
+
+	//Stop shared event loops
+	if (eventLoopPool)
+	{
+		//Borrowed loops are stopped when returned
+		eventLoopPool.Stop();
+		//Keep the pool while any loop is still borrowed
+		if (eventLoopPool.GetStats().borrowed)
+			stoppedEventLoopPools.add(eventLoopPool);
+		eventLoopPool = null;
+	}
 	
 	//Set flag
 	Native.MediaServer.Terminate();
@@ -153,6 +215,85 @@ MediaServer.setThreadName = function(name)
 	return Native.MediaServer.SetThreadName(name);
 };
 
+/**
+ * Configure the shared event loop pool used by the objects which need their own event loop, like the
+ * simulcast adapters, so the number of threads is bounded by the pool size. Must be called before the
+ * pool is used.
+ * @memberof MediaServer
+ * @param {EventLoopPoolParams} params
+ */
+MediaServer.setEventLoopPool = function(params)
+{
+	//Can't resize it once used
+	if (eventLoopPool)
+		throw new Error("Event loop pool already in use");
+	//Store params
+	eventLoopPoolParams = { ...params };
+};
+
+/**
+ * Borrow the least loaded event loop of the shared pool.
+ * It must be returned with {@link MediaServer.returnEventLoop} when not used anymore.
+ * @memberof MediaServer
+ * @returns {Native.TimeService}
+ */
+MediaServer.borrowEventLoop = function()
+{
+	return getEventLoopPool().Borrow();
+};
+
+/**
+ * Return an event loop borrowed from the shared pool
+ * @memberof MediaServer
+ * @param {Native.TimeService} loop
+ * @returns {boolean} true if the loop was borrowed from the pool
+ */
+MediaServer.returnEventLoop = function(loop)
+{
+	//Pool may have been terminated
+	for (const pool of [eventLoopPool, ...stoppedEventLoopPools])
+	{
+		if (!pool || !pool.Owns(loop))
+			continue;
+		const returned = pool.Return(loop);
+		//Release stopped pool once all its loops are returned
+		if (pool!==eventLoopPool && !pool.GetStats().borrowed)
+			stoppedEventLoopPools.delete(pool);
+		return returned;
+	}
+	return false;
+};
+
+/**
+ * Get the load of the shared event loop pool, all zero if it has not been started yet
+ * @memberof MediaServer
+ * @returns {EventLoopPoolStats}
+ */
+MediaServer.getEventLoopPoolStats = function()
+{
+	//Don't start the pool just to get its stats
+	if (!eventLoopPool)
+		return {
+			size		: 0,
+			borrowed	: 0,
+			minLoad		: 0,
+			maxLoad		: 0,
+			loads		: [],
+		};
+	const pool = eventLoopPool;
+	const stats = pool.GetStats();
+	const loads = [];
+	for (let i = 0; i < stats.size; ++i)
+		loads.push(pool.GetLoad(i));
+	return {
+		size		: stats.size,
+		borrowed	: stats.borrowed,
+		minLoad		: stats.minLoad,
+		maxLoad		: stats.maxLoad,
+		loads		: loads,
+	};
+};
+
 /**
  * Enable or disable ultra debug level traces
  * @memberof MediaServer
@@ -166,7 +307,9 @@ MediaServer.enableUltraDebug = function(flag)
 
 /**
  * @typedef {Object} EndpointParams Endpoint creation parameters
- * @property {number} packetPoolSize Packet pool size
+ * @property {number} [packetPoolSize] Packet pool size, also used to preallocate the pool of the packets created by the bindings for each shard
+ * @property {number} [maxPacketPoolSize] Maximum number of packets of the bindings pool of each shard, further ones are allocated from heap (defaults to 0, unbounded)
+ * @property {number} [shards] Number of UDP sockets and threads the endpoint is sharded on (defaults to 1)
  */
 
 /**
@@ -179,7 +322,11 @@ MediaServer.enableUltraDebug = function(flag)
 MediaServer.createEndpoint = function(ip, params)
 {
 	//Cretate new rtp endpoint
-	const endpoint = new Endpoint(ip, Number.isInteger(params?.packetPoolSize) ? params?.packetPoolSize : 0);
+	const endpoint = new Endpoint(ip,
+		Number.isInteger(params?.packetPoolSize) ? params?.packetPoolSize : 0,
+		Number.isInteger(params?.shards) ? params?.shards : 1,
+		Number.isInteger(params?.maxPacketPoolSize) ? params?.maxPacketPoolSize : 0
+	);
 	
 	//Add to endpoint set
 	endpoints.add(endpoint);
@@ -282,11 +429,12 @@ MediaServer.createIncomingStreamTrackReader = function(intraOnly, minPeriod)
 /**
  * Create a new emulated transport from pcap file
  * @param {String} pcap - PCAP filename and path
+ * @param {EmulatedTransport.EmulatedTransportParams} [params]
 */
-MediaServer.createEmulatedTransport = function(pcap)
+MediaServer.createEmulatedTransport = function(pcap, params)
 {
 	//Return emulated transport
-	const endpoint =  new EmulatedTransport(pcap);
+	const endpoint =  new EmulatedTransport(pcap, params);
 	
        	//Add to endpoint set
 	endpoints.add(endpoint);
@@ -307,25 +455,27 @@ MediaServer.createIncomingStreamTrackSimulcastAdapter = function(
 	/** @type {Native.TimeService | null} */ timeService = null)
 {
 	/**
-	 * @type {Native.EventLoop | null}
+	 * @type {Native.TimeService | null}
 	 */
 	let loop = null;
 	if (!timeService)
 	{
-		//Create one event loop for this
-		loop = new Native.EventLoop();
-		//Start it
-		loop.Start();
+		//Borrow one event loop from the shared pool
+		loop = MediaServer.borrowEventLoop();
 		
 		timeService = loop;
 	}
 	
 	//Create it
 	const incomingStreamTrack = new IncomingStreamTrackSimulcastAdapter(trackId, mediaId, timeService);
-	//Stop loop on track close if it is created here
+	//Return loop on track close if it is borrowed here
 	if (loop)
 	{
-		incomingStreamTrack.once("stopped",()=>loop?.Stop());
+		eventLoopBorrowers.add(incomingStreamTrack);
+		incomingStreamTrack.once("stopped",()=>{
+			eventLoopBorrowers.delete(incomingStreamTrack);
+			loop && MediaServer.returnEventLoop(loop);
+		});
 	}
 	//Done
 	return incomingStreamTrack;
@@ -1,12 +1,57 @@
 const os = require("os");
+const fs = require("fs");
 const path = require("path");
 const SharedPointer = require("./SharedPointer");
+
+/**
+ * Get the best x86-64 micro-architecture level supported by the running cpu
+ * @returns {number} 4, 3 or 0 if none of the optimized levels is supported
+ */
+function getCPULevel()
+{
+	//Only for linux x64 builds
+	if (os.platform()!=="linux" || os.arch()!=="x64")
+		return 0;
+	try {
+		//Get cpu flags of the running host
+		const match = fs.readFileSync("/proc/cpuinfo","utf8").match(/^flags\s*:(.*)$/m);
+		const flags = new Set(match ? match[1].trim().split(/\s+/) : []);
+		const has = (/** @type {string[]} */ required) => required.every(flag=>flags.has(flag));
+		//Check levels as defined by the x86-64 psABI
+		const v3 = has(["avx","avx2","bmi1","bmi2","f16c","fma","abm","movbe","xsave"]);
+		const v4 = v3 && has(["avx512f","avx512bw","avx512cd","avx512dq","avx512vl"]);
+		return v4 ? 4 : v3 ? 3 : 0;
+	} catch (e) {
+		return 0;
+	}
+}
+
+/**
+ * Get the path of the addon to load, preferring the variant built for the best level supported by the cpu
+ * @returns {string}
+ */
+function getAddonPath()
+{
+	const dir = path.resolve(path.dirname(module.filename), "../build/Release");
+	//Allow forcing the level (i.e. MEDOOZE_ISA=3), 0 forces the baseline one
+	const forced = process.env.MEDOOZE_ISA;
+	const level = forced !== undefined ? parseInt(forced) : getCPULevel();
+	//Try best variants first
+	for (let i = level; i >= 3; --i)
+	{
+		const variant = path.join(dir, "medooze-media-server-x86-64-v" + i + ".node");
+		if (fs.existsSync(variant))
+			return variant;
+	}
+	//Baseline
+	return path.join(dir, "medooze-media-server.node");
+}
  
 try 
 {
 	//We try first to load it via dlopen on Node 9
 	//@ts-expect-error
-	process.dlopen(module,path.resolve(path.dirname(module.filename), "../build/Release/medooze-media-server.node"), os.constants.dlopen.RTLD_NOW);// | os.constants.dlopen.RTLD_DEEPBIND);
+	process.dlopen(module,getAddonPath(), os.constants.dlopen.RTLD_NOW);// | os.constants.dlopen.RTLD_DEEPBIND);
 } catch (e) {
 	//old one
 	module.exports = require(/** @type {any} */ ("../build/Release/medooze-media-server"));
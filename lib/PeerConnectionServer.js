@@ -73,7 +73,7 @@ class PeerConnectionServer extends Emitter
 					const answer = offer.answer({
 						dtls		: transport.getLocalDTLSInfo(),
 						ice		: transport.getLocalICEInfo(),
-						candidates	: this.endpoint.getLocalCandidates(),
+						candidates	: transport.getLocalCandidates(),
 						capabilities	: this.capabilities
 					});
 					
@@ -188,7 +188,7 @@ class PeerConnectionServer extends Emitter
 						id		: id,
 						dtls		: answer.getDTLS().plain(),
 						ice		: answer.getICE().plain(),
-						candidates	: this.endpoint.getLocalCandidates(),
+						candidates	: transport.getLocalCandidates(),
 						capabilities	: this.capabilities
 					});
 					
@@ -14,9 +14,22 @@ const parseInt = /** @type {(x: number) => number} */ (global.parseInt);
  * @property {number} [refresh] Periodically refresh an intra on all video tracks (in ms)
  * @property {boolean} [waitForIntra] Wait until first video iframe is received to start recording media
  * @property {number} [timeShift] Buffer time in ms. Recording must be splicity started with flush() call
+ * @property {number} [timeShiftBitrate] Max expected bitrate of all recorded tracks in bps, used to preallocate the time shift buffer (defaults to 4Mbps)
  * @property {boolean} [disableHints] Disable recording hint tracks. Note that this file won't be playable with the Player object;
  */
 
+/**
+ * @typedef {Object} TimeShiftStats
+ * @property {number} capacity Size of the preallocated buffer in bytes
+ * @property {number} used Bytes currently used by buffered frames
+ * @property {number} highWaterMark Max bytes used since the buffer was allocated
+ * @property {number} frames Number of frames currently buffered
+ * @property {number} maxFrames Max number of frames that can be buffered
+ * @property {number} window Time span of the buffered frames in ms
+ * @property {number} evicted Number of frames removed from the buffer because they were too old or there was no room for newer ones
+ * @property {number} dropped Number of frames not buffered because they were bigger than the whole buffer
+ */
+
 /**
  * @typedef {Object} RecorderEvents
  * @property {(self: Recorder) => void} stopped
@@ -67,8 +80,8 @@ class Recorder extends Emitter
 			//recording start time
 			this.startTime = new Date();
 		} else {
-			//Set timeshift
-			this.recorder.SetTimeShiftDuration(parseInt(this.params.timeShift));
+			//Set timeshift and preallocate buffer for it
+			this.recorder.SetTimeShiftDuration(parseInt(this.params.timeShift),parseInt(this.params.timeShiftBitrate || 4000000));
 		}
 			
 		//init track list
@@ -114,6 +127,27 @@ class Recorder extends Emitter
 		return !!this.params.timeShift;
 	}
 	
+	/**
+	 * Get time shift buffer occupancy stats
+	 * @returns {TimeShiftStats} 
+	 */
+	getTimeShiftStats()
+	{
+		//Get native stats
+		const stats = this.recorder.GetTimeShiftStats();
+		//Convert them
+		return {
+			capacity	: stats.capacity,
+			used		: stats.used,
+			highWaterMark	: stats.highWaterMark,
+			frames		: stats.frames,
+			maxFrames	: stats.maxFrames,
+			window		: stats.window,
+			evicted		: stats.evicted,
+			dropped		: stats.dropped,
+		};
+	}
+	
 	/**
 	 * Start recording time shiftt buffer. 
 	 * @param {String} filename - Override filename [Optional]
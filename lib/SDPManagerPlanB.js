@@ -43,11 +43,13 @@ class SDPManagerPlanB extends SDPManager
 		//If there is no local info
 		if (!this.localInfo)
 		{
+			//Generate local ICE info
+			const ice = ICEInfo.generate(true);
 			//Create initial offer
 			this.localInfo = SDPInfo.create({
 				dtls		: new DTLSInfo(Setup.ACTPASS,"sha-256",this.endpoint.getDTLSFingerprint()),
-				ice		: ICEInfo.generate(true),
-				candidates	: this.endpoint.getLocalCandidates(),
+				ice		: ice,
+				candidates	: this.endpoint.getLocalCandidates(ice),
 				capabilities	: this.capabilities
 			});
 		}
@@ -112,7 +114,7 @@ class SDPManagerPlanB extends SDPManager
 				this.localInfo = this.remoteInfo.answer({
 					dtls		: this.transport.getLocalDTLSInfo(),
 					ice		: this.transport.getLocalICEInfo(),
-					candidates	: this.endpoint.getLocalCandidates(),
+					candidates	: this.transport.getLocalCandidates(),
 					capabilities	: this.capabilities
 				});
 			//Set RTP local properties
@@ -141,7 +143,7 @@ class SDPManagerPlanB extends SDPManager
 			this.localInfo = this.remoteInfo.answer({
 				dtls		: this.transport.getLocalDTLSInfo(),
 				ice		: this.transport.getLocalICEInfo(),
-				candidates	: this.endpoint.getLocalCandidates(),
+				candidates	: this.transport.getLocalCandidates(),
 				capabilities	: this.capabilities
 			});
 		
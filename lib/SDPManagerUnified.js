@@ -1,4 +1,5 @@
 const SDPManager	= require("./SDPManager");
+const Tracing		= require("./Tracing");
 
 const SemanticSDP	= require("semantic-sdp");
 
@@ -69,15 +70,27 @@ class SDPManagerUnified extends SDPManager
 	
 	/** @override */
 	createLocalDescription()
+	{
+		//Trace it on the main thread track
+		return Tracing.wrap("SDPManagerUnified::createLocalDescription", () => this.buildLocalDescription());
+	}
+
+	/**
+	 * @ignore
+	 * @returns {string}
+	 */
+	buildLocalDescription()
 	{
 		//If there is no local info
 		if (!this.localInfo)
 		{
+			//Generate local ICE info
+			const ice = ICEInfo.generate(true);
 			//Create initial with 
 			this.localInfo = SDPInfo.create({
 				dtls		: new DTLSInfo(Setup.ACTPASS,"sha-256",this.endpoint.getDTLSFingerprint()),
-				ice		: ICEInfo.generate(true),
-				candidates	: this.endpoint.getLocalCandidates()
+				ice		: ice,
+				candidates	: this.endpoint.getLocalCandidates(ice)
 			});
 			//For each media capability
 			for (const media of /** @type {SemanticSDP.MediaType[]} */ (Object.keys(this.capabilities)))
@@ -277,6 +290,16 @@ class SDPManagerUnified extends SDPManager
 	
 	/** @override */
 	processRemoteDescription(/** @type {string} */ sdp)
+	{
+		//Trace it on the main thread track
+		return Tracing.wrap("SDPManagerUnified::processRemoteDescription", () => this.applyRemoteDescription(sdp));
+	}
+
+	/**
+	 * @ignore
+	 * @returns {string}
+	 */
+	applyRemoteDescription(/** @type {string} */ sdp)
 	{
 		//Parse sdp
 		this.remoteInfo = SDPInfo.parse(sdp);
@@ -295,7 +318,7 @@ class SDPManagerUnified extends SDPManager
 				this.localInfo = this.remoteInfo.answer({
 					dtls		: this.transport.getLocalDTLSInfo(),
 					ice		: this.transport.getLocalICEInfo(),
-					candidates	: this.endpoint.getLocalCandidates(),
+					candidates	: this.transport.getLocalCandidates(),
 					capabilities	: this.capabilities
 				});
 			//Set RTP local properties
@@ -336,7 +359,7 @@ class SDPManagerUnified extends SDPManager
 			this.localInfo = this.remoteInfo.answer({
 				dtls		: this.transport.getLocalDTLSInfo(),
 				ice		: this.transport.getLocalICEInfo(),
-				candidates	: this.endpoint.getLocalCandidates(),
+				candidates	: this.transport.getLocalCandidates(),
 				capabilities	: this.capabilities
 			});
 		
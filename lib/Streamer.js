@@ -32,6 +32,9 @@ class Streamer extends Emitter
 	 * @param {String} params.remote.ip	- Sending ip address
 	 * @param {Number} params.remote.port	- Sending port
 	 * @param {Number} params.noRTCP	- Disable sending rtcp
+	 * @param {Number} params.sendQueueSize	- Max number of packets queued for sending by each loop (defaults to 1024)
+	 * @param {Number} params.batchSize	- Send and receive up to this number of packets per syscall with sendmmsg/recvmmsg and UDP GSO (disabled by default)
+	 * @param {Number} params.batchLatency	- Max time in ms to hold a partial batch waiting for it to be filled (defaults to 0, send what is queued)
 	 * @returns {StreamerSession} The new streaming session
 	 */
 	createSession(media,params)
@@ -10,6 +10,35 @@ const {
 } = require("semantic-sdp");
 
 
+/**
+ * @typedef {Object} SendQueueStats
+ * @property {number} producers Number of loops that have sent packets to the session, each one with its own queue
+ * @property {number} capacity Max number of packets that can be queued by each loop
+ * @property {number} depth Number of packets currently queued
+ * @property {number} maxDepth Max number of packets queued at the same time
+ * @property {number} enqueued Total number of packets queued
+ * @property {number} sent Total number of packets sent
+ * @property {number} dropped Total number of packets dropped because the queue was full
+ * @property {number} batches Number of times the session loop has woken up to send packets
+ */
+
+/**
+ * @typedef {Object} BatchingStats
+ * @property {boolean} enabled If packets are sent and received in batches
+ * @property {number} batchSize Max number of packets per send/receive syscall
+ * @property {number} batchLatency Max time in ms a partial batch is held before being sent
+ * @property {number} latencyFlushes Number of partial batches sent because the batch latency expired
+ * @property {number} rtcpPackets Number of rtcp packets sent by the session while batching
+ * @property {number} retransmissions Number of packets resent in response to a NACK while batching
+ * @property {boolean} gso If UDP generic segmentation offload is being used
+ * @property {number} sendCalls Number of sendmmsg calls
+ * @property {number} sentPackets Number of packets sent
+ * @property {number} gsoSends Number of segmented messages sent
+ * @property {number} sendErrors Number of failed sendmmsg calls
+ * @property {number} recvCalls Number of recvmmsg calls
+ * @property {number} recvPackets Number of packets received
+ */
+
 /**
  * Represent the connection between a local udp port and a remote one. It sends and/or receive plain RTP data.
  */
@@ -28,8 +57,12 @@ class StreamerSession extends Emitter
 		//Create new sequence generator
 		this.lfsr = new LFSR();
 
-		//Create session
-		this.session = new Native.RTPSessionFacadeShared(media.getType().toLowerCase()==="audio" ? 0 : 1);
+		//Create session, packets are queued and sent asynchronously from its loop
+		this.session = new Native.RTPSessionFacadeShared(media.getType().toLowerCase()==="audio" ? 0 : 1, parseInt(params?.sendQueueSize || 1024));
+		//Send and receive several packets per syscall, must be done before binding
+		if (params && params.batchSize > 1)
+			//Enable it
+			this.session.SetBatching(parseInt(params.batchSize), parseInt(params.batchLatency || 0));
 		//Set local params
 		if (params && params.local && params.local.port)
 			//Set it
@@ -64,6 +97,20 @@ class StreamerSession extends Emitter
 			}
 			//Set length
 			properties.SetIntegerProperty("codecs.length", num);
+
+			//Reset
+			num = 0;
+			//For each extension
+			for (let [id,uri] of media.getExtensions().entries())
+			{
+				//Set properties
+				properties.SetIntegerProperty("ext."+num+".id"	, parseInt(id));
+				properties.SetStringProperty("ext."+num+".uri"	, String(uri));
+				//one more
+				num++;
+			}
+			//Set length
+			properties.SetIntegerProperty("ext.length", num);
 		}
 		
 		//Check if we have to disable RTCP
@@ -120,6 +167,53 @@ class StreamerSession extends Emitter
 	}
 		
 	
+	/**
+	 * Get stats of the asynchronous sending queue
+	 * @returns {SendQueueStats}
+	 */
+	getSendQueueStats()
+	{
+		//Get native stats
+		const stats = this.session.GetSendQueueStats();
+		//Convert them
+		return {
+			producers	: stats.producers,
+			capacity	: stats.capacity,
+			depth		: stats.depth,
+			maxDepth	: stats.maxDepth,
+			enqueued	: stats.enqueued,
+			sent		: stats.sent,
+			dropped		: stats.dropped,
+			batches		: stats.batches,
+		};
+	}
+
+	/**
+	 * Get stats of the batched udp socket
+	 * @returns {BatchingStats}
+	 */
+	getBatchingStats()
+	{
+		//Get native stats
+		const stats = this.session.GetBatchingStats();
+		//Convert them
+		return {
+			enabled		: stats.enabled,
+			batchSize	: stats.batchSize,
+			batchLatency	: stats.batchLatency,
+			latencyFlushes	: stats.latencyFlushes,
+			rtcpPackets	: stats.rtcpPackets,
+			retransmissions	: stats.retransmissions,
+			gso		: stats.socket.gso,
+			sendCalls	: stats.socket.sendCalls,
+			sentPackets	: stats.socket.sentPackets,
+			gsoSends	: stats.socket.gsoSends,
+			sendErrors	: stats.socket.sendErrors,
+			recvCalls	: stats.socket.recvCalls,
+			recvPackets	: stats.socket.recvPackets,
+		};
+	}
+
 	/**
 	 * Returns the incoming stream track associated with this streaming session
 	 * @returns {IncomingStreamTrack}
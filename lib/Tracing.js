@@ -0,0 +1,145 @@
+const Native		= require("./Native");
+
+//@ts-expect-error
+const parseInt = /** @type {(x: number) => number} */ (global.parseInt);
+
+/**
+ * @typedef {Object} TracingParams
+ * @property {string[]} [categories] Track event categories to enable (all if not set)
+ * @property {number} [bufferSize] Size of the in memory trace buffer in KB (defaults to 32768)
+ * @property {number} [duration] Stop tracing automatically after this number of milliseconds (defaults to 0, until stopped)
+ */
+
+/** @type {Array<() => void>} */
+let waiting = [];
+
+//Native callback object
+const listener = {
+	onstopped : () => {
+		//Resolve pending stops
+		const resolvers = waiting;
+		waiting = [];
+		for (const resolve of resolvers)
+			resolve();
+	}
+};
+
+/**
+ * Control the in-process Perfetto tracing backend, so traces can be captured on demand
+ * without running the tracing daemon.
+ * @namespace
+ */
+const Tracing = {};
+
+/**
+ * Start writing a trace to a file descriptor. Only one trace can be captured at a time.
+ * @memberof Tracing
+ * @param {number} fd - Writable file descriptor, must be kept open until tracing is stopped
+ * @param {TracingParams} [params] - Tracing configuration
+ * @returns {boolean} true if tracing has been started
+ */
+Tracing.start = function(fd, params)
+{
+	//Get categories
+	const categories = (params?.categories || []).join(",");
+	//Start in-process session
+	return Native.TracingFacade.Start(listener, parseInt(fd), categories, parseInt(params?.bufferSize || 32768), parseInt(params?.duration || 0));
+};
+
+/**
+ * Stop tracing, or wait for a trace with duration to finish.
+ * @memberof Tracing
+ * @returns {Promise<void>} resolved once the trace has been flushed to the file descriptor
+ */
+Tracing.stop = function()
+{
+	//If not tracing
+	if (!Native.TracingFacade.IsActive())
+		return Promise.resolve();
+	//Wait for native notification
+	const stopped = new Promise((resolve) => waiting.push(() => resolve(undefined)));
+	//Stop it, may be already stopping if it had a duration
+	Native.TracingFacade.Stop();
+	return stopped;
+};
+
+/**
+ * Check if there is an in-process trace being captured
+ * @memberof Tracing
+ * @returns {boolean}
+ */
+Tracing.isActive = function()
+{
+	return Native.TracingFacade.IsActive();
+};
+
+/**
+ * Check if js events are being recorded (the "node.js" category is enabled on any trace),
+ * so callers can skip building event names and values otherwise.
+ * @memberof Tracing
+ * @returns {boolean}
+ */
+Tracing.isEnabled = function()
+{
+	return Native.TracingFacade.IsEnabled();
+};
+
+/**
+ * Begin a slice on the current thread track. Must be balanced with an end() call on the same thread.
+ * @memberof Tracing
+ * @param {string} name - Slice name
+ */
+Tracing.begin = function(name)
+{
+	Native.TracingFacade.Begin(String(name));
+};
+
+/**
+ * End the last slice opened with begin()
+ * @memberof Tracing
+ */
+Tracing.end = function()
+{
+	Native.TracingFacade.End();
+};
+
+/**
+ * Run a function inside a slice on the current thread track, ending it even if the function throws
+ * @memberof Tracing
+ * @template T
+ * @param {string} name - Slice name
+ * @param {() => T} func - Function to run
+ * @returns {T} the function result
+ */
+Tracing.wrap = function(name, func)
+{
+	Tracing.begin(name);
+	try {
+		return func();
+	} finally {
+		Tracing.end();
+	}
+};
+
+/**
+ * Emit an instant event on the current thread track
+ * @memberof Tracing
+ * @param {string} name - Event name
+ */
+Tracing.instant = function(name)
+{
+	Native.TracingFacade.Instant(String(name));
+};
+
+/**
+ * Set the value of a counter track
+ * @memberof Tracing
+ * @param {string} name - Counter name
+ * @param {number} value - Counter value
+ */
+Tracing.counter = function(name, value)
+{
+	Native.TracingFacade.Counter(String(name), Number(value));
+};
+
+module.exports = Tracing;
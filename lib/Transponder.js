@@ -4,6 +4,7 @@ const LayerInfo		= require("./LayerInfo");
 const Native		= require("./Native");
 const IncomingStreamTrack = require("./IncomingStreamTrack");
 const SemanticSDP	= require("semantic-sdp");
+const Tracing		= require("./Tracing");
 
 /** @typedef {IncomingStreamTrack.LayerStats} LayerStats */
 
@@ -29,6 +30,59 @@ const SemanticSDP	= require("semantic-sdp");
  * @property {string[]} [codecs] Codec preferences list in descending order, layers with codec not present in codec list will be ignored
  */
 
+/**
+ * @typedef {Object} TargetLayers Filtered and ordered layers reused while the track active layers and the selection options do not change
+ * @ignore
+ * @property {Readonly<IncomingStreamTrack.ActiveLayersInfo>} info
+ * @property {SetTargetBitrateOptions['traversal']} traversal
+ * @property {string[] | undefined} codecs
+ * @property {number} maxSpatialLayerId
+ * @property {number} maxTemporalLayerId
+ * @property {number} maxWidth
+ * @property {number} maxHeight
+ * @property {IncomingStreamTrack.ActiveLayersInfo['layers']} layers
+ * @property {Native.LayerSelector | null} selector Native selector of the track if it has ordered the layers
+ * @property {number} ordering Ordering id on the native selector
+ */
+
+/** Traversal ids on the native layer selector */
+const Traversals = {
+	"default"			: 0,
+	"spatial-temporal"		: 1,
+	"zig-zag-spatial-temporal"	: 2,
+	"temporal-spatial"		: 3,
+	"zig-zag-temporal-spatial"	: 4,
+};
+
+/**
+ * Get the max of the actual and signaled target bitrate of the layer
+ */
+function getLayerBitrate(/** @type {LayerStats} */ layer)
+{
+	return layer.targetBitrate ? Math.max(layer.bitrate, layer.targetBitrate) : layer.bitrate;
+}
+
+/**
+ * Get spatial info of the layer
+ * Either spatialLayerId on SVC stream or simulcastIdx on simulcast stream
+ */
+function getSpatialLayerId(/** @type {LayerStats} */ layer)
+{
+	return layer.spatialLayerId!=LayerInfo.MaxLayerId ? layer.spatialLayerId : layer.simulcastIdx;
+}
+
+function sameCodecs(/** @type {string[] | undefined} */ a, /** @type {string[] | undefined} */ b)
+{
+	if (a === b)
+		return true;
+	if (!a || !b || a.length != b.length)
+		return false;
+	for (let i = 0; i < a.length; ++i)
+		if (a[i] != b[i])
+			return false;
+	return true;
+}
+
 /**
  * @typedef {Object} TransponderEvents
  * @property {(muted: boolean) => void} muted
@@ -68,6 +122,8 @@ class Transponder extends Emitter
 		this.maxTemporalLayerId = LayerInfo.MaxLayerId;
 		this.maxWidth = 0;
 		this.maxHeight = 0;
+		//Last layers used for bitrate selection
+		this.targetLayers = /** @type {TargetLayers | null} */ (null);
 		
 		//The listener for attached tracks end event
 		this.onAttachedTrackStopped = () => {
@@ -79,6 +135,7 @@ class Transponder extends Emitter
 			this.track.detached();
 			//Dettach
 			this.track = null;
+			this.targetLayers = null;
 			//Stop listening
 			this.transponder.ResetIncoming();
 			//No encoding
@@ -103,6 +160,19 @@ class Transponder extends Emitter
 				});
 			} 
 		};
+		//Listener for when the layer fanout of the track is enabled or disabled
+		this.onAttachedTrackLayerFanout = () => {
+			//If we are forwarding an encoding
+			if (this.track && this.encoding)
+			{
+				//Attach again to the fanout group or to the encoding
+				this.attachIncoming(this.encoding, true);
+				//If not using fanout
+				if (!this.encoding.fanout)
+					//Restore layer selection
+					this.transponder.SelectLayer(this.spatialLayerId, this.temporalLayerId);
+			}
+		};
 	}
 	
 	/**
@@ -130,12 +200,14 @@ class Transponder extends Emitter
 			//Remove listeners listener
 			this.track.off("stopped", this.onAttachedTrackStopped);
 			this.track.off("encoding",this.onAttachedTrackEncoding);
+			this.track.off("layerfanout",this.onAttachedTrackLayerFanout);
 			//Signal dettached
 			this.track.detached();
 		}
 		
 		//Store new track info
 		this.track = track;
+		this.targetLayers = null;
 		
 		//If removing track
 		if (this.track)
@@ -173,6 +245,7 @@ class Transponder extends Emitter
 
 			//Add listeners
 			this.track.on("encoding",this.onAttachedTrackEncoding);
+			this.track.on("layerfanout",this.onAttachedTrackLayerFanout);
 			this.track.once("stopped",this.onAttachedTrackStopped);
 
 			//Singal track is attached
@@ -274,41 +347,69 @@ class Transponder extends Emitter
 	}
 
 	/**
-	 * Select encoding and temporal and spatial layers based on the desired bitrate. This operation will unmute the transponder if it was muted and it is possible to select an encoding and layer based on the target bitrate and options.
-	 * 
-	 * @param {Number} target Target bitrate
-	 * @param {SetTargetBitrateOptions} [options]
-	 * @returns {ReturnType<NumberConstructor>} Current bitrate of the selected encoding and layers, it also includes the selected layer indexes and available layers as properties of the Number object.
+	 * Get the active layers allowed by the max layers and codecs, ordered by traversal. As the active layers table is shared
+	 * by all the transponders of the track, the result is reused until the table or the selection options change.
+	 * If there is no codec preference the native layer selector of the track does the ordering, so it is computed once
+	 * for all the transponders, and is stored so selection can be done on it too.
+	 * @ignore
+	 * @param {Readonly<IncomingStreamTrack.ActiveLayersInfo>} info
+	 * @param {SetTargetBitrateOptions['traversal']} [traversal]
+	 * @param {string[]} [codecs] Lowercase codec preferences
+	 * @returns {TargetLayers}
 	 */
-	setTargetBitrate(target, options) 
+	getTargetLayers(info, traversal, codecs)
 	{
-		//Check track
-		if (!this.track)
-			//Ignore
-			return;
-		//Current encoding
-		const prevEncodingId    = this.encodingId;
-		//For optimum fit
-		let current		= -1;
-		let encodingId		= "";
-		let spatialLayerId	= LayerInfo.MaxLayerId;
-		let temporalLayerId	= LayerInfo.MaxLayerId;
-		//For minimum fit
-		let min			= Number.MAX_SAFE_INTEGER;
-		let encodingIdMin	= "";
-		let spatialLayerIdMin	= LayerInfo.MaxLayerId;
-		let temporalLayerIdMin	= LayerInfo.MaxLayerId;
-		
-		let ordering = /** @type {(a: LayerStats, b: LayerStats) => number} */ (/** @type {any} */ (false));
-		
-		//Helper for retrieving spatial info
-		const getSpatialLayerId = function(/** @type {LayerStats} */ layer) {
-			// Either spatialLayerId on SVC stream or simulcastIdx on simulcast stream
-			return layer.spatialLayerId!=LayerInfo.MaxLayerId ? layer.spatialLayerId : layer.simulcastIdx ;
+		//Check if nothing has changed since last time
+		const cached = this.targetLayers;
+		if (cached && cached.info === info && cached.traversal === traversal 
+			&& cached.maxSpatialLayerId === this.maxSpatialLayerId && cached.maxTemporalLayerId === this.maxTemporalLayerId
+			&& cached.maxWidth === this.maxWidth && cached.maxHeight === this.maxHeight && sameCodecs(cached.codecs, codecs)
+			//Native orderings are discarded when the track loads a newer table
+			&& (!cached.selector || this.track.getLayerSelector(info) === cached.selector))
+			//Reuse them
+			return cached;
+
+		/** @type {TargetLayers} */
+		const target = {
+			info			: info,
+			traversal		: traversal,
+			codecs			: codecs,
+			maxSpatialLayerId	: this.maxSpatialLayerId,
+			maxTemporalLayerId	: this.maxTemporalLayerId,
+			maxWidth		: this.maxWidth,
+			maxHeight		: this.maxHeight,
+			layers			: [],
+			selector		: null,
+			ordering		: -1
 		};
 
+		//Get native selector if we don't need to sort by codec preference
+		const selector = !codecs && this.track.getLayerSelector ? this.track.getLayerSelector(info) : null;
+
+		//If we have it
+		if (selector)
+		{
+			//Get ordering, computed only by the first transponder asking for it
+			const ordering = selector.Prepare(Traversals[traversal || "default"] || 0,
+				Math.min(this.maxSpatialLayerId, LayerInfo.MaxLayerId),
+				Math.min(this.maxTemporalLayerId, LayerInfo.MaxLayerId),
+				this.maxWidth || 0,
+				this.maxHeight || 0);
+			//Get ordered layers from the shared table
+			const size = selector.GetSize(ordering);
+			for (let i=0; i<size; ++i)
+				target.layers.push(info.layers[selector.GetIndex(ordering, i)]);
+			//Store it for selecting
+			target.selector = selector;
+			target.ordering = ordering;
+			//Store for next time
+			return this.targetLayers = target;
+		}
+
+		let ordering = /** @type {(a: LayerStats, b: LayerStats) => number} */ (/** @type {any} */ (false));
+
 		//Depending on the traversal method
-		switch (options?.traversal)
+		switch (traversal)
 		{
 			case "spatial-temporal":
 				ordering = (a,b) => ((getSpatialLayerId(b)*LayerInfo.MaxLayerId+b.temporalLayerId) - (getSpatialLayerId(a)*LayerInfo.MaxLayerId+a.temporalLayerId));
@@ -329,25 +430,17 @@ class Transponder extends Emitter
 					ordering = (a,b) => ((getSpatialLayerId(b)*LayerInfo.MaxLayerId+b.temporalLayerId) - (getSpatialLayerId(a)*LayerInfo.MaxLayerId+a.temporalLayerId));
 		}
 
-		//If we want to filter by codecs
-		const codecs = options?.codecs?.map(codec => codec.toLowerCase());
 		const codecSortByPreference = codecs 
 			? (/** @type {LayerStats} */a,/** @type {LayerStats} */b) => codecs.indexOf(a.codec) - codecs.indexOf(b.codec)
 			: undefined;
-		
-		//Get all active layers 
-		const info = this.track.getActiveLayers();
-		
+
 		//Filter layers by max TL and SL
-		const filtered = info.layers.filter(layer=> this.maxSpatialLayerId>=layer.spatialLayerId
+		//We expect spatial/simulcast layers to ensure that a layer with higher bitrate has also higher width/heights in order to be able to properly select based on maxWidth/maxHeight
+		let layers = info.layers.filter(layer=> this.maxSpatialLayerId>=layer.spatialLayerId
 			&& this.maxTemporalLayerId>=layer.temporalLayerId
 			&& (!codecs || codecs.includes(layer?.codec.toLowerCase()))
 		);
 		
-		//Get layers and filter by max TL & SL
-		//We expect spatial/simulcast layers to ensure that a layer with higher bitrate has also higher width/heights in order to be able to properly select based on maxWidth/maxHeight
-		let layers = filtered;
-		
 		//If doing any sorting		
 		if (ordering && codecSortByPreference)
 			//Order codec preferences in descending order and traversal
@@ -358,6 +451,50 @@ class Transponder extends Emitter
 		else if (codecSortByPreference)
 			//Order codec preferences in descending order and bitrate
 			layers = layers.sort((a,b) => codecSortByPreference(a,b) || IncomingStreamTrack.sortByBitrateReverse(a,b));
+
+		//Store for next time
+		target.layers = layers;
+		return this.targetLayers = target;
+	}
+
+	/**
+	 * Select encoding and temporal and spatial layers based on the desired bitrate. This operation will unmute the transponder if it was muted and it is possible to select an encoding and layer based on the target bitrate and options.
+	 * 
+	 * @param {Number} target Target bitrate
+	 * @param {SetTargetBitrateOptions} [options]
+	 * @returns {ReturnType<NumberConstructor>} Current bitrate of the selected encoding and layers, it also includes the selected layer indexes and available layers as properties of the Number object.
+	 */
+	setTargetBitrate(target, options) 
+	{
+		//Check track
+		if (!this.track)
+			//Ignore
+			return;
+		//Trace requested bitrate
+		if (Tracing.isEnabled())
+			Tracing.counter("Transponder::targetBitrate "+this.track.getId(), target);
+		//Current encoding
+		const prevEncodingId    = this.encodingId;
+		//For optimum fit
+		let current		= -1;
+		let encodingId		= "";
+		let spatialLayerId	= LayerInfo.MaxLayerId;
+		let temporalLayerId	= LayerInfo.MaxLayerId;
+		//For minimum fit
+		let min			= Number.MAX_SAFE_INTEGER;
+		let encodingIdMin	= "";
+		let spatialLayerIdMin	= LayerInfo.MaxLayerId;
+		let temporalLayerIdMin	= LayerInfo.MaxLayerId;
+		
+		//If we want to filter by codecs
+		const codecs = options?.codecs?.map(codec => codec.toLowerCase());
+		
+		//Get all active layers, shared by all the transponders of the track until its stats are refreshed
+		const info = this.track.getSharedActiveLayers();
+		
+		//Get layers filtered by max TL & SL and ordered by traversal
+		const targetLayers = this.getTargetLayers(info, options?.traversal, codecs);
+		const layers = targetLayers.layers;
 		
 		//If there are no layers
 		if (!layers.length)
@@ -372,48 +509,77 @@ class Transponder extends Emitter
 			//Not sending anything
 			return Object.assign(new Number(0),{
 				layerIndex	: -1, //Do not set the defaultEncodingId as the layers are empty
-				layers		: layers
+				layers		: layers.slice()
 			});
 		}
 		
 		//selected layer index
 		let layerMinIndex = 0;
 		let layerIndex = 0;
-		//Try to do layer selection instead
-		for (let layer of layers)
+		//If the native selector has ordered the layers
+		if (targetLayers.selector)
 		{
-			//Use the max of the actual and signaled target bitrate
-			const layerBitrate = layer.targetBitrate ? Math.max(layer.bitrate, layer.targetBitrate) : layer.bitrate;
-			//If this layer is better than the one before
-			if (layerBitrate<=target && layerBitrate>current &&
-			    this.maxSpatialLayerId>=layer.spatialLayerId && this.maxTemporalLayerId>=layer.temporalLayerId &&
-			    (!this.maxWidth || ((layer.width || layer.targetWidth) <= this.maxWidth)) &&
-			    (!this.maxHeight || ((layer.height || layer.targetHeight) <= this.maxHeight))
-			)
+			//Binary search on the precomputed ordering
+			const selection = targetLayers.selector.Select(targetLayers.ordering, target);
+			//If any layer fits
+			if (selection.position>=0)
 			{
+				const layer = layers[selection.position];
 				//Use it as is
+				layerIndex	= selection.position;
 				encodingId	= layer.encodingId;
 				spatialLayerId	= layer.spatialLayerId;
 				temporalLayerId	= layer.temporalLayerId;
-				//Update max current bitrate
-				current = layerBitrate;
-				//we don't want to look more
-				break;
+				current		= getLayerBitrate(layer);
 			}
-			//Check if it is the minimum
-			if (layerBitrate && layerBitrate<min &&
-			    this.maxSpatialLayerId>=layer.spatialLayerId && this.maxTemporalLayerId>=layer.temporalLayerId)
+			//If there is a minimum
+			if (selection.minPosition>=0)
 			{
+				const layer = layers[selection.minPosition];
 				//Use it as min
-				layerMinIndex		= layerIndex;
+				layerMinIndex		= selection.minPosition;
 				encodingIdMin		= layer.encodingId;
 				spatialLayerIdMin	= layer.spatialLayerId;
 				temporalLayerIdMin	= layer.temporalLayerId;
-				//Update min bitrate
-				min = layerBitrate;
+				min			= getLayerBitrate(layer);
+			}
+		} else {
+			//Try to do layer selection instead
+			for (let layer of layers)
+			{
+				//Use the max of the actual and signaled target bitrate
+				const layerBitrate = layer.targetBitrate ? Math.max(layer.bitrate, layer.targetBitrate) : layer.bitrate;
+				//If this layer is better than the one before
+				if (layerBitrate<=target && layerBitrate>current &&
+				    this.maxSpatialLayerId>=layer.spatialLayerId && this.maxTemporalLayerId>=layer.temporalLayerId &&
+				    (!this.maxWidth || ((layer.width || layer.targetWidth) <= this.maxWidth)) &&
+				    (!this.maxHeight || ((layer.height || layer.targetHeight) <= this.maxHeight))
+				)
+				{
+					//Use it as is
+					encodingId	= layer.encodingId;
+					spatialLayerId	= layer.spatialLayerId;
+					temporalLayerId	= layer.temporalLayerId;
+					//Update max current bitrate
+					current = layerBitrate;
+					//we don't want to look more
+					break;
+				}
+				//Check if it is the minimum
+				if (layerBitrate && layerBitrate<min &&
+				    this.maxSpatialLayerId>=layer.spatialLayerId && this.maxTemporalLayerId>=layer.temporalLayerId)
+				{
+					//Use it as min
+					layerMinIndex		= layerIndex;
+					encodingIdMin		= layer.encodingId;
+					spatialLayerIdMin	= layer.spatialLayerId;
+					temporalLayerIdMin	= layer.temporalLayerId;
+					//Update min bitrate
+					min = layerBitrate;
+				}
+				//Next
+				layerIndex++;
 			}
-			//Next
-			layerIndex++;
 		}
 
 		//Check if we have been able to find a layer that matched the target bitrate
@@ -435,7 +601,7 @@ class Transponder extends Emitter
 					encodingId	: encodingIdMin,
 					spatialLayerId	: spatialLayerIdMin,
 					temporalLayerId	: temporalLayerIdMin,
-					layers		: layers
+					layers		: layers.slice()
 				});
 			} else {
 				//Mute it
@@ -443,7 +609,7 @@ class Transponder extends Emitter
 				//Not sending anything
 				return Object.assign(new Number(0),{
 					layerIndex	: -1,
-					layers		: layers
+					layers		: layers.slice()
 				});
 			}
 		}
@@ -473,7 +639,7 @@ class Transponder extends Emitter
 			encodingId	: encodingId,
 			spatialLayerId	: spatialLayerId,
 			temporalLayerId	: temporalLayerId,
-			layers		: layers
+			layers		: layers.slice()
 		});
 	}
 
@@ -490,6 +656,9 @@ class Transponder extends Emitter
 		if (!this.track)
 			//Ignore
 			return;
+		//Trace requested bitrate
+		if (Tracing.isEnabled())
+			Tracing.counter("Transponder::targetBitrate "+this.track.getId(), target);
 		//Current encoding
 		const prevEncodingId    = this.encodingId;
 		//For optimum fit
@@ -503,44 +672,12 @@ class Transponder extends Emitter
 		let spatialLayerIdMin	= LayerInfo.MaxLayerId;
 		let temporalLayerIdMin	= LayerInfo.MaxLayerId;
 		
-		let ordering = /** @type {(a: LayerStats, b: LayerStats) => number} */ (/** @type {any} */ (false));
-		
-		//Helper for retrieving spatial info
-		const getSpatialLayerId = function(/** @type {LayerStats} */ layer) {
-			// Either spatialLayerId on SVC stream or simulcastIdx on simulcast stream
-			return layer.spatialLayerId!=LayerInfo.MaxLayerId ? layer.spatialLayerId : layer.simulcastIdx ;
-		};
-	
-		//Depending on the traversal method
-		switch (options && options.traversal)
-		{
-			case "spatial-temporal":
-				ordering = (a,b) => ((getSpatialLayerId(b)*LayerInfo.MaxLayerId+b.temporalLayerId) - (getSpatialLayerId(a)*LayerInfo.MaxLayerId+a.temporalLayerId));
-				break;
-			case "zig-zag-spatial-temporal":
-				ordering = (a,b) => (((getSpatialLayerId(b)+b.temporalLayerId+1)*LayerInfo.MaxLayerId-b.temporalLayerId) - ((getSpatialLayerId(a)+a.temporalLayerId+1)*LayerInfo.MaxLayerId-a.temporalLayerId));
-				break;
-			case "temporal-spatial":
-				ordering = (a,b) => ((b.temporalLayerId*LayerInfo.MaxLayerId+getSpatialLayerId(b)) - (a.temporalLayerId*LayerInfo.MaxLayerId+getSpatialLayerId(a)));
-				break;
-			case "zig-zag-temporal-spatial":
-				ordering = (a,b) => (((getSpatialLayerId(b)+b.temporalLayerId+1)*LayerInfo.MaxLayerId-getSpatialLayerId(b)) - ((getSpatialLayerId(a)+a.temporalLayerId+1)*LayerInfo.MaxLayerId-getSpatialLayerId(a)));
-				break;
-			default:
-				//If we are filtering bymin/max we use the "spatial-tempral" ordering
-				//TODO: use (target)Width/(target)Height for ordering too?
-				if (this.maxWidth || this.maxHeight)
-					ordering = (a,b) => ((getSpatialLayerId(b)*LayerInfo.MaxLayerId+b.temporalLayerId) - (getSpatialLayerId(a)*LayerInfo.MaxLayerId+a.temporalLayerId));
-		}
-		
 		//Get all active layers 
-		const info = await this.track.getActiveLayersAsync();
+		const info = await this.track.getSharedActiveLayersAsync();
 		
-		//Filter layers by max TL and SL
-		const filtered = info.layers.filter(layer=>this.maxSpatialLayerId>=layer.spatialLayerId && this.maxTemporalLayerId>=layer.temporalLayerId);
-		
-		//Get layers and filter by max TL & SL
-		const layers = ordering ? filtered.sort(ordering) : filtered;
+		//Get layers filtered by max TL & SL and ordered by traversal
+		const targetLayers = this.getTargetLayers(info, options?.traversal);
+		const layers = targetLayers.layers;
 		
 		//If there are no layers
 		if (!layers.length)
@@ -555,7 +692,7 @@ class Transponder extends Emitter
 			//Not sending anything
 			return Object.assign(new Number(0),{
 				layerIndex	: -1, //Do not set the defaultEncodingId as the layers are empty
-				layers		: layers
+				layers		: layers.slice()
 			});
 		}
 		
@@ -563,41 +700,70 @@ class Transponder extends Emitter
 		let layerMinIndex = 0;
 		let layerIndex = 0;
 		
-		//Try to do layer selection instead
-		for (let layer of layers)
+		//If the native selector has ordered the layers
+		if (targetLayers.selector)
 		{
-			//Use the max of the actual and signaled target bitrate
-			const layerBitrate = layer.targetBitrate ? Math.max(layer.bitrate, layer.targetBitrate) : layer.bitrate;
-			//If this layer is better than the one before
-			if (layerBitrate<=target && layerBitrate>current &&
-			    this.maxSpatialLayerId>=layer.spatialLayerId && this.maxTemporalLayerId>=layer.temporalLayerId &&
-			    (!this.maxWidth || ((layer.width || layer.targetWidth) <= this.maxWidth)) &&
-			    (!this.maxHeight || ((layer.height || layer.targetHeight) <= this.maxHeight))
-			)
+			//Binary search on the precomputed ordering
+			const selection = targetLayers.selector.Select(targetLayers.ordering, target);
+			//If any layer fits
+			if (selection.position>=0)
 			{
+				const layer = layers[selection.position];
 				//Use it as is
+				layerIndex	= selection.position;
 				encodingId	= layer.encodingId;
 				spatialLayerId	= layer.spatialLayerId;
 				temporalLayerId	= layer.temporalLayerId;
-				//Update max current bitrate
-				current = layerBitrate;
-				//we don't want to look more
-				break;
+				current		= getLayerBitrate(layer);
 			}
-			//Check if it is the minimum
-			if (layerBitrate && layerBitrate<min &&
-			    this.maxSpatialLayerId>=layer.spatialLayerId && this.maxTemporalLayerId>=layer.temporalLayerId)
+			//If there is a minimum
+			if (selection.minPosition>=0)
 			{
+				const layer = layers[selection.minPosition];
 				//Use it as min
-				layerMinIndex		= layerIndex;
+				layerMinIndex		= selection.minPosition;
 				encodingIdMin		= layer.encodingId;
 				spatialLayerIdMin	= layer.spatialLayerId;
 				temporalLayerIdMin	= layer.temporalLayerId;
-				//Update min bitrate
-				min = layerBitrate;
+				min			= getLayerBitrate(layer);
+			}
+		} else {
+			//Try to do layer selection instead
+			for (let layer of layers)
+			{
+				//Use the max of the actual and signaled target bitrate
+				const layerBitrate = layer.targetBitrate ? Math.max(layer.bitrate, layer.targetBitrate) : layer.bitrate;
+				//If this layer is better than the one before
+				if (layerBitrate<=target && layerBitrate>current &&
+				    this.maxSpatialLayerId>=layer.spatialLayerId && this.maxTemporalLayerId>=layer.temporalLayerId &&
+				    (!this.maxWidth || ((layer.width || layer.targetWidth) <= this.maxWidth)) &&
+				    (!this.maxHeight || ((layer.height || layer.targetHeight) <= this.maxHeight))
+				)
+				{
+					//Use it as is
+					encodingId	= layer.encodingId;
+					spatialLayerId	= layer.spatialLayerId;
+					temporalLayerId	= layer.temporalLayerId;
+					//Update max current bitrate
+					current = layerBitrate;
+					//we don't want to look more
+					break;
+				}
+				//Check if it is the minimum
+				if (layerBitrate && layerBitrate<min &&
+				    this.maxSpatialLayerId>=layer.spatialLayerId && this.maxTemporalLayerId>=layer.temporalLayerId)
+				{
+					//Use it as min
+					layerMinIndex		= layerIndex;
+					encodingIdMin		= layer.encodingId;
+					spatialLayerIdMin	= layer.spatialLayerId;
+					temporalLayerIdMin	= layer.temporalLayerId;
+					//Update min bitrate
+					min = layerBitrate;
+				}
+				//Next
+				layerIndex++;
 			}
-			//Next
-			layerIndex++;
 		}
 
 		//Check if we have been able to find a layer that matched the target bitrate
@@ -619,7 +785,7 @@ class Transponder extends Emitter
 					encodingId	: encodingIdMin,
 					spatialLayerId	: spatialLayerIdMin,
 					temporalLayerId	: temporalLayerIdMin,
-					layers		: layers
+					layers		: layers.slice()
 				});
 			} else {
 				//Mute it
@@ -627,7 +793,7 @@ class Transponder extends Emitter
 				//Not sending anything
 				return Object.assign(new Number(0),{
 					layerIndex	: -1,
-					layers		: layers
+					layers		: layers.slice()
 				});
 			}
 		}
@@ -657,7 +823,7 @@ class Transponder extends Emitter
 			encodingId	: encodingId,
 			spatialLayerId	: spatialLayerId,
 			temporalLayerId	: temporalLayerId,
-			layers		: layers
+			layers		: layers.slice()
 		});
 	}
 
@@ -686,7 +852,11 @@ class Transponder extends Emitter
 		this.setMaximumLayers(curated.maxSpatialLayerId,curated.maxTemporalLayerId);
 
 		//Set svc layers
-		this.transponder.SelectLayer(curated.spatialLayerId,curated.temporalLayerId);
+		if (this.encoding && this.encoding.fanout)
+			//Done by fanout group
+			this.selectLayer(curated.spatialLayerId,curated.temporalLayerId);
+		else
+			this.transponder.SelectLayer(curated.spatialLayerId,curated.temporalLayerId);
 
 		//Set maximum width/height
 		this.setMaximumDimensions(curated.maxWidth, curated.maxHeight);
@@ -714,12 +884,36 @@ class Transponder extends Emitter
 		if (encoding===this.encoding)
 			//Do nothing
 			return;
+		//Trace encoding switch
+		if (Tracing.isEnabled())
+			Tracing.instant("Transponder::selectEncoding "+this.track.getId()+" "+encodingId);
 		//Start listening to it
-		this.transponder.SetIncoming(encoding.source.toRTPIncomingMediaStream(),encoding.receiver,!!smooth);
+		this.attachIncoming(encoding,!!smooth);
 		//store encoding
 		this.encodingId = encodingId;
 		this.encoding = encoding;
 	}
+
+	/**
+	 * Set the native incoming stream for the encoding, either the encoding source or the fanout group of the selected layers
+	 * @ignore
+	 * @param {IncomingStreamTrack.Encoding} encoding
+	 * @param {boolean} smooth
+	 */
+	attachIncoming(encoding, smooth)
+	{
+		//If the track groups transponders by layers
+		if (encoding.fanout)
+		{
+			//Listen to the group of the selected layers
+			this.transponder.SetIncoming(encoding.fanout.GetGroup(this.spatialLayerId, this.temporalLayerId),encoding.receiver,smooth);
+			//Layers are already selected by the group
+			this.transponder.SelectLayer(LayerInfo.MaxLayerId,LayerInfo.MaxLayerId);
+		} else {
+			//Listen to the encoding
+			this.transponder.SetIncoming(encoding.source.toRTPIncomingMediaStream(),encoding.receiver,smooth);
+		}
+	}
 	
 	/**
 	 * Return the encoding that is being forwarded, or null if no track attached
@@ -762,7 +956,7 @@ class Transponder extends Emitter
 			//Ignore
 			return null;
 		//Get all active layers 
-		const layers = this.track.getActiveLayers().layers;
+		const layers = this.track.getSharedActiveLayers().layers;
 
 		//Find current layer
 		return layers.find((layer)=>layer.encodingId==this.encodingId && layer.spatialLayerId==this.spatialLayerId && layer.temporalLayerId==this.temporalLayerId);
@@ -779,7 +973,7 @@ class Transponder extends Emitter
 			//Ignore
 			return null;
 		//Get all active layers 
-		const layers = (await this.track.getActiveLayersAsync()).layers;
+		const layers = (await this.track.getSharedActiveLayersAsync()).layers;
 
 		//Find current layer
 		return layers.find((layer)=>layer.encodingId==this.encodingId && layer.spatialLayerId==this.spatialLayerId && layer.temporalLayerId==this.temporalLayerId);
@@ -803,12 +997,24 @@ class Transponder extends Emitter
 			//Nothing
 			return;
 		
-		//Call native interface
-		this.transponder.SelectLayer(spatialLayerId,temporalLayerId);
+		//Trace layer switch
+		if (Tracing.isEnabled())
+			Tracing.instant("Transponder::selectLayer "+(this.track ? this.track.getId() : "")+" "+spatialLayerId+"/"+temporalLayerId);
 		
+		//Going up needs to wait for an intra frame when switching fanout groups
+		const smooth = spatialLayerId>this.spatialLayerId || temporalLayerId>this.temporalLayerId;
+
 		//Store new values
 		this.spatialLayerId = spatialLayerId;
 		this.temporalLayerId = temporalLayerId;
+
+		//If using fanout
+		if (this.encoding && this.encoding.fanout)
+			//Move to the group for the new layers
+			this.attachIncoming(this.encoding, smooth);
+		else
+			//Call native interface
+			this.transponder.SelectLayer(spatialLayerId,temporalLayerId);
 	}
 
 	/**
@@ -863,6 +1069,7 @@ class Transponder extends Emitter
 		this.transponder = null;
 		//Remove track referecne also
 		this.track = null;
+		this.targetLayers = null;
 	}
 	
 };
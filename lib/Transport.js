@@ -64,6 +64,16 @@ const noop = function(){};
  * @property {number} responsesReceived Number of ice responses received
  */
 
+/**
+ * @typedef {Object} CandidateRawTxStats Raw TX stats of a remote candidate
+ * @property {string} ip Candidate ip
+ * @property {number} port Candidate port
+ * @property {boolean} raw If packets to the candidate are being sent through the raw TX ring
+ * @property {number} rawPackets Number of packets sent through the raw TX ring
+ * @property {number} udpPackets Number of packets sent through the udp socket
+ * @property {number} dropped Number of packets dropped because the raw TX ring was full
+ */
+
 /**
  * @typedef {Object} SSRCs
  * @property {number} media ssrc for the media track 
@@ -166,6 +176,11 @@ class Transport extends Emitter
 		
 		//Store bundle
 		this.bundle = bundle;
+		//Pool of the packets created by the bindings for this transport
+		this.packetPool = SharedPointer(bundle.GetPacketPool());
+		//Remote candidates packets are sent to, by ip:port
+		/** @type {Map<string, [string, number]>} */
+		this.rawTxCandidates = new Map();
 		//No state yet
 		/** @type {DTLSState} */
 		this.dtlsState = "new";
@@ -195,6 +210,8 @@ class Transport extends Emitter
 			/** @type {number} */ port,
 			/** @type {number} */ priority,
 		) => {
+			//It may be a peer reflexive one
+			this.rawTxCandidates.set(ip + ":" + port, [ip, port]);
 			this.emit("remoteicecandidate", new CandidateInfo("1", 1, "UDP", priority, ip, port, "host"), this);
 		};
 
@@ -248,6 +265,9 @@ class Transport extends Emitter
 
 		//Craeate transport listener
 		this.listener = new Native.DTLSICETransportListenerShared(this);
+		//Account DTLS handshakes on the shard
+		if (bundle.handshakeMonitor)
+			this.listener.get().SetHandshakeMonitor(bundle.handshakeMonitor);
 		//Set it
 		this.transport.SetListener(this.listener);
 		
@@ -629,6 +649,7 @@ class Transport extends Emitter
 
 		//Add candidate to remote list
 		this.remote.candidates.push(candidate.clone());
+		this.rawTxCandidates.set(ip + ":" + port, [ip, port]);
 
 		//Collect and set raw TX data, if raw TX is active
 		//TODO: Change addRemoteCandidate to async
@@ -654,6 +675,25 @@ class Transport extends Emitter
 		//Send data to endpoint thread
 		return this.bundle.SetCandidateRawTxData(ip, port, ...rawTxData);
 	}
+
+	/**
+	 * Get which path, raw TX ring or udp socket, the packets sent to each remote candidate have taken
+	 * @returns {CandidateRawTxStats[]}
+	 */
+	getRawTxStats()
+	{
+		return Array.from(this.rawTxCandidates.values(), ([ip, port]) => {
+			const stats = this.bundle.GetCandidateRawTxStats(ip, port);
+			return {
+				ip		: ip,
+				port		: port,
+				raw		: stats.raw,
+				rawPackets	: stats.rawPackets,
+				udpPackets	: stats.udpPackets,
+				dropped		: stats.dropped,
+			};
+		});
+	}
 	
 	/**
 	 * Register an array remote candidate info. Only needed for ice-lite to ice-lite endpoints
@@ -1088,6 +1128,8 @@ class Transport extends Emitter
 			SharedPointer(this.transport.toRTPReceiver()),
 			sources
 		);
+		//Rewritten packets are created on the pool of the bundle
+		incomingStreamTrack.packetPool = this.packetPool;
 
 		//Add listener
 		incomingStreamTrack.once("stopped",()=>{
@@ -1172,6 +1214,10 @@ class Transport extends Emitter
 		
 		//Remove transport/connection from bundle, DO NOT USE them later on
 		this.bundle.RemoveICETransport(this.username);
+		//Remove raw tx data and stats of its candidates
+		for (const [ip, port] of this.rawTxCandidates.values())
+			this.bundle.ClearCandidateRawTxData(ip, port);
+		this.rawTxCandidates.clear();
 
 		//Stop listening for events, as they might have been queued
 		this.ontargetbitrate = noop;
@@ -16,8 +16,12 @@ public:
 	virtual void onActiveSpeakerChanded(uint32_t id) override
 	{
 		UltraDebug("-ActiveSpeakerDetectorFacade::onActiveSpeakerChanded() [id:%d]\n",id);
+		PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
+		TRACE_EVENT_INSTANT("node.speaker", "ActiveSpeakerDetectorFacade::onActiveSpeakerChanged", "id", id);
 		//Run function on main node thread
 		MediaServer::Async([=,cloned=persistent](){
+			PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
+			TRACE_EVENT("node.speaker", "ActiveSpeakerDetectorFacade::onactivespeakerchanged", "id", id);
 			Nan::HandleScope scope;
 			int i = 0;
 			v8::Local<v8::Value> argv[1];
@@ -83,6 +87,8 @@ public:
 				return;
 			//Accumulate on id
 			ActiveSpeakerDetector::Accumulate(it->second, packet->GetVAD(),packet->GetLevel(), getTimeMS());
+			PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
+			TRACE_COUNTER("node.speaker", perfetto::CounterTrack("ActiveSpeakerDetectorFacade::Level", perfetto::Track(it->second)), packet->GetLevel());
 		}
 	}
 	
@@ -0,0 +1,395 @@
+%{
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+struct BatchedUDPSocketStats
+{
+	uint64_t sendCalls	= 0;
+	uint64_t sentPackets	= 0;
+	uint64_t gsoSends	= 0;
+	uint64_t sendErrors	= 0;
+	uint64_t recvCalls	= 0;
+	uint64_t recvPackets	= 0;
+	bool gso		= false;
+};
+
+/*
+ * BatchedUDPSocket
+ *  UDP socket sending and receiving several datagrams per syscall with sendmmsg/recvmmsg.
+ *  Consecutive datagrams of the same size are coalesced with UDP_SEGMENT when the kernel supports it.
+ *  The socket is dual stack, so the remote can be ipv4 or ipv6, unless ipv6 is not available on the host.
+ *  Datagrams read by each recvmmsg call are delivered together from the receiving thread.
+ */
+class BatchedUDPSocket
+{
+public:
+	//Max size of a single datagram
+	static constexpr size_t MaxDatagramSize = 1500;
+	//Kernel limits for a segmented send
+	static constexpr size_t MaxSegments = 64;
+	static constexpr size_t MaxSegmentedSize = 65000;
+
+	using ReceiveCallback = std::function<void(const std::vector<iovec>& datagrams)>;
+
+public:
+	BatchedUDPSocket(size_t batchSize) :
+		batchSize(std::max<size_t>(batchSize, 1)),
+		recvBuffers(this->batchSize * MaxDatagramSize),
+		recvIovecs(this->batchSize),
+		recvMsgs(this->batchSize)
+	{
+		received.reserve(this->batchSize);
+	}
+
+	~BatchedUDPSocket()
+	{
+		Close();
+	}
+
+	int Bind(int port, ReceiveCallback&& callback)
+	{
+		//Create dual stack socket, falling back to ipv4 only if ipv6 is not available
+		family = AF_INET6;
+		fd = socket(AF_INET6, SOCK_DGRAM, 0);
+		if (fd < 0 && errno == EAFNOSUPPORT)
+		{
+			family = AF_INET;
+			fd = socket(AF_INET, SOCK_DGRAM, 0);
+		}
+		if (fd < 0)
+			return Error("-BatchedUDPSocket::Bind() could not create socket [errno:%d]\n", errno);
+
+		sockaddr_storage addr = {};
+		socklen_t len;
+		if (family == AF_INET6)
+		{
+			//Accept ipv4 too
+			int only = 0;
+			setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &only, sizeof(only));
+			auto addr6 = reinterpret_cast<sockaddr_in6*>(&addr);
+			addr6->sin6_family	= AF_INET6;
+			addr6->sin6_addr	= in6addr_any;
+			addr6->sin6_port	= htons(port);
+			len = sizeof(sockaddr_in6);
+		} else {
+			auto addr4 = reinterpret_cast<sockaddr_in*>(&addr);
+			addr4->sin_family	= AF_INET;
+			addr4->sin_addr.s_addr	= INADDR_ANY;
+			addr4->sin_port		= htons(port);
+			len = sizeof(sockaddr_in);
+		}
+		//Bind it
+		if (bind(fd, (sockaddr*)&addr, len) < 0)
+		{
+			Error("-BatchedUDPSocket::Bind() could not bind socket [port:%d,errno:%d]\n", port, errno);
+			Close();
+			return 0;
+		}
+
+		//Get assigned port, at the same offset on both families
+		len = sizeof(addr);
+		getsockname(fd, (sockaddr*)&addr, &len);
+		localPort = ntohs(reinterpret_cast<sockaddr_in*>(&addr)->sin_port);
+
+		//Remote may have been set before knowing the socket family
+		bool reachable;
+		{
+			ScopedLock lock(mutex);
+			reachable = !remoteFamily || SetDestination();
+		}
+		if (!reachable)
+		{
+			Close();
+			return 0;
+		}
+
+		//Check if generic segmentation offload is available
+		int segment = 0;
+		gso = setsockopt(fd, SOL_UDP, UDP_SEGMENT, &segment, sizeof(segment)) == 0;
+
+		//Create stop signal
+		stopfd = eventfd(0, EFD_NONBLOCK);
+		this->callback = std::move(callback);
+
+		//Start receiving thread
+		receiving = true;
+		receiver = std::thread([this]() { ReceiveLoop(); });
+
+		Log("-BatchedUDPSocket::Bind() [port:%d,batch:%zu,gso:%d,ipv6:%d]\n", localPort, batchSize, (bool)gso, family == AF_INET6);
+
+		return localPort;
+	}
+
+	int GetLocalPort() const
+	{
+		return localPort;
+	}
+
+	/*
+	 * SetRemote
+	 *  Set the ipv4 or ipv6 destination of the sent datagrams, ipv6 ones are rejected if the socket is ipv4 only
+	 */
+	bool SetRemote(const char* ip, int port)
+	{
+		ScopedLock lock(mutex);
+		//Parse it in any family
+		if (inet_pton(AF_INET6, ip, &remoteAddr) == 1)
+			remoteFamily = AF_INET6;
+		else if (inet_pton(AF_INET, ip, &remoteAddr) == 1)
+			remoteFamily = AF_INET;
+		else
+			return Error("-BatchedUDPSocket::SetRemote() invalid ip address [ip:%s]\n", ip);
+		remotePort = port;
+		//Update destination if already bound
+		return fd < 0 || SetDestination();
+	}
+
+	size_t Send(const std::vector<iovec>& datagrams)
+	{
+		//Get destination, it may be changed while sending
+		sockaddr_storage to;
+		socklen_t toLen;
+		{
+			ScopedLock lock(mutex);
+			to = destination;
+			toLen = destinationLen;
+		}
+		//Check we are ready
+		if (fd < 0 || !toLen || datagrams.empty())
+			return 0;
+
+		std::vector<mmsghdr> msgs;
+		std::vector<std::array<char, CMSG_SPACE(sizeof(uint16_t))>> controls;
+		msgs.reserve(datagrams.size());
+		controls.reserve(datagrams.size());
+
+		//Group datagrams
+		for (size_t i = 0; i < datagrams.size();)
+		{
+			size_t num = 1;
+			size_t total = datagrams[i].iov_len;
+			//Coalesce following datagrams of the same size, last one may be shorter
+			if (gso)
+			{
+				while (i + num < datagrams.size()
+					&& num < MaxSegments
+					&& datagrams[i + num].iov_len <= datagrams[i].iov_len
+					&& total + datagrams[i + num].iov_len <= MaxSegmentedSize)
+				{
+					total += datagrams[i + num].iov_len;
+					//Shorter datagram ends the run
+					if (datagrams[i + num++].iov_len < datagrams[i].iov_len)
+						break;
+				}
+			}
+
+			mmsghdr msg = {};
+			msg.msg_hdr.msg_name	= &to;
+			msg.msg_hdr.msg_namelen	= toLen;
+			msg.msg_hdr.msg_iov	= const_cast<iovec*>(&datagrams[i]);
+			msg.msg_hdr.msg_iovlen	= num;
+
+			//Set segment size
+			if (num > 1)
+			{
+				controls.emplace_back();
+				msg.msg_hdr.msg_control		= controls.back().data();
+				msg.msg_hdr.msg_controllen	= controls.back().size();
+				cmsghdr* cmsg = CMSG_FIRSTHDR(&msg.msg_hdr);
+				cmsg->cmsg_level	= SOL_UDP;
+				cmsg->cmsg_type		= UDP_SEGMENT;
+				cmsg->cmsg_len		= CMSG_LEN(sizeof(uint16_t));
+				*(uint16_t*)CMSG_DATA(cmsg) = datagrams[i].iov_len;
+				gsoSends++;
+			}
+			msgs.push_back(msg);
+			i += num;
+		}
+
+		size_t sent = 0;
+		size_t done = 0;
+		//Send all messages
+		while (done < msgs.size())
+		{
+			int ret = sendmmsg(fd, msgs.data() + done, msgs.size() - done, 0);
+			sendCalls++;
+			if (ret <= 0)
+			{
+				sendErrors++;
+				//If segmentation is not supported by the device, disable it and retry
+				if (errno == EIO && gso)
+				{
+					Warning("-BatchedUDPSocket::Send() disabling GSO\n");
+					gso = false;
+					return sent + Send(std::vector<iovec>(datagrams.begin() + CountDatagrams(msgs, done), datagrams.end()));
+				}
+				break;
+			}
+			for (int j = 0; j < ret; ++j)
+				sent += msgs[done + j].msg_hdr.msg_iovlen;
+			done += ret;
+		}
+		sentPackets += sent;
+		return sent;
+	}
+
+	void Close()
+	{
+		//Stop receiving thread
+		if (receiving)
+		{
+			receiving = false;
+			uint64_t one = 1;
+			[[maybe_unused]] auto ret = write(stopfd, &one, sizeof(one));
+		}
+		if (receiver.joinable())
+			receiver.join();
+		if (stopfd >= 0)
+			close(stopfd);
+		if (fd >= 0)
+			close(fd);
+		stopfd = -1;
+		fd = -1;
+	}
+
+	BatchedUDPSocketStats GetStats() const
+	{
+		BatchedUDPSocketStats stats;
+		stats.sendCalls		= sendCalls;
+		stats.sentPackets	= sentPackets;
+		stats.gsoSends		= gsoSends;
+		stats.sendErrors	= sendErrors;
+		stats.recvCalls		= recvCalls;
+		stats.recvPackets	= recvPackets;
+		stats.gso		= gso;
+		return stats;
+	}
+
+private:
+	bool SetDestination()
+	{
+		destination = {};
+		destinationLen = 0;
+		if (family == AF_INET)
+		{
+			//Can't reach ipv6 from an ipv4 only socket
+			if (remoteFamily == AF_INET6)
+				return Error("-BatchedUDPSocket::SetDestination() ipv6 remote not supported, ipv6 is not available on this host\n");
+			auto addr4 = reinterpret_cast<sockaddr_in*>(&destination);
+			addr4->sin_family	= AF_INET;
+			addr4->sin_port		= htons(remotePort);
+			memcpy(&addr4->sin_addr, &remoteAddr, sizeof(in_addr));
+			destinationLen = sizeof(sockaddr_in);
+		} else {
+			auto addr6 = reinterpret_cast<sockaddr_in6*>(&destination);
+			addr6->sin6_family	= AF_INET6;
+			addr6->sin6_port	= htons(remotePort);
+			if (remoteFamily == AF_INET6)
+			{
+				addr6->sin6_addr = remoteAddr;
+			} else {
+				//Use ipv4 mapped address
+				addr6->sin6_addr.s6_addr[10] = 0xFF;
+				addr6->sin6_addr.s6_addr[11] = 0xFF;
+				memcpy(&addr6->sin6_addr.s6_addr[12], &remoteAddr, sizeof(in_addr));
+			}
+			destinationLen = sizeof(sockaddr_in6);
+		}
+		return true;
+	}
+
+	static size_t CountDatagrams(const std::vector<mmsghdr>& msgs, size_t num)
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < num; ++i)
+			count += msgs[i].msg_hdr.msg_iovlen;
+		return count;
+	}
+
+	void ReceiveLoop()
+	{
+		//Prepare receiving buffers once
+		for (size_t i = 0; i < batchSize; ++i)
+		{
+			recvIovecs[i].iov_base	= recvBuffers.data() + i * MaxDatagramSize;
+			recvIovecs[i].iov_len	= MaxDatagramSize;
+			recvMsgs[i] = {};
+			recvMsgs[i].msg_hdr.msg_iov	= &recvIovecs[i];
+			recvMsgs[i].msg_hdr.msg_iovlen	= 1;
+		}
+
+		pollfd fds[2] = {
+			{ fd,		POLLIN, 0 },
+			{ stopfd,	POLLIN, 0 },
+		};
+
+		while (receiving)
+		{
+			//Wait for data
+			if (poll(fds, 2, -1) < 0 || fds[1].revents)
+				continue;
+			//Read as many datagrams as available
+			int num = recvmmsg(fd, recvMsgs.data(), batchSize, MSG_DONTWAIT, nullptr);
+			recvCalls++;
+			if (num <= 0)
+				continue;
+			recvPackets += num;
+			//Deliver them at once
+			received.clear();
+			for (int i = 0; i < num; ++i)
+				received.push_back({ recvIovecs[i].iov_base, recvMsgs[i].msg_len });
+			callback(received);
+		}
+	}
+
+private:
+	size_t batchSize;
+	int fd = -1;
+	int stopfd = -1;
+	int localPort = 0;
+	int family = AF_INET6;
+	std::atomic<bool> gso = false;
+	//Remote as set, in any family
+	int remoteFamily = 0;
+	in6_addr remoteAddr = {};
+	int remotePort = 0;
+	//Remote in the socket family
+	Mutex mutex;
+	sockaddr_storage destination = {};
+	socklen_t destinationLen = 0;
+	std::thread receiver;
+	std::atomic<bool> receiving = false;
+	ReceiveCallback callback;
+	std::vector<BYTE> recvBuffers;
+	std::vector<iovec> recvIovecs;
+	std::vector<mmsghdr> recvMsgs;
+	std::vector<iovec> received;
+	//Updated from the sending and receiving threads
+	std::atomic<uint64_t> sendCalls = 0;
+	std::atomic<uint64_t> sentPackets = 0;
+	std::atomic<uint64_t> gsoSends = 0;
+	std::atomic<uint64_t> sendErrors = 0;
+	std::atomic<uint64_t> recvCalls = 0;
+	std::atomic<uint64_t> recvPackets = 0;
+};
+%}
+
+%nodefaultctor BatchedUDPSocketStats;
+struct BatchedUDPSocketStats
+{
+	uint64_t sendCalls;
+	uint64_t sentPackets;
+	uint64_t gsoSends;
+	uint64_t sendErrors;
+	uint64_t recvCalls;
+	uint64_t recvPackets;
+	bool gso;
+};
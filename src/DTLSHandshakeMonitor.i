@@ -0,0 +1,136 @@
+%{
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+
+struct DTLSHandshakeStats
+{
+	uint64_t started	= 0;
+	uint64_t connected	= 0;
+	uint64_t failed		= 0;
+	uint64_t aborted	= 0;
+	uint32_t pending	= 0;
+	uint32_t maxPending	= 0;
+	uint64_t latencyLast	= 0;
+	uint64_t latencyAvg	= 0;
+	uint64_t latencyMax	= 0;
+};
+
+/*
+ * DTLSHandshakeMonitor
+ *  Tracks the DTLS handshakes of the transports of a loop from their state changes. A handshake starts when
+ *  the transport enters the connecting state and ends when it gets connected, fails, or is closed before
+ *  finishing. Pending handshakes are the ones competing for the loop at a given time, which is what stalls
+ *  media forwarding on reconnect storms. Latencies are in microseconds and only account finished handshakes.
+ *  Stats can be read from any thread.
+ */
+class DTLSHandshakeMonitor
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	//Upper bounds of the latency histogram buckets in us, last one has no limit
+	static constexpr std::array<uint64_t, 9> LatencyBounds = { 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000 };
+	static constexpr size_t LatencyBuckets = LatencyBounds.size() + 1;
+
+public:
+	Clock::time_point Start()
+	{
+		started++;
+		uint32_t current = ++pending;
+		//Update max, may be called from several loops
+		uint32_t max = maxPending;
+		while (current > max && !maxPending.compare_exchange_weak(max, current));
+		return Clock::now();
+	}
+
+	void Finish(Clock::time_point start, bool success)
+	{
+		pending--;
+		if (!success)
+		{
+			failed++;
+			return;
+		}
+		uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+		size_t bucket = std::upper_bound(LatencyBounds.begin(), LatencyBounds.end(), latency) - LatencyBounds.begin();
+		latencyHistogram[bucket]++;
+		latencyTotal += latency;
+		latencyLast = latency;
+		uint64_t max = latencyMax;
+		while (latency > max && !latencyMax.compare_exchange_weak(max, latency));
+		connected++;
+	}
+
+	void Abort()
+	{
+		pending--;
+		aborted++;
+	}
+
+	DTLSHandshakeStats GetStats() const
+	{
+		DTLSHandshakeStats stats;
+		stats.started		= started;
+		stats.connected		= connected;
+		stats.failed		= failed;
+		stats.aborted		= aborted;
+		stats.pending		= pending;
+		stats.maxPending	= maxPending;
+		stats.latencyLast	= latencyLast;
+		stats.latencyAvg	= stats.connected ? latencyTotal / stats.connected : 0;
+		stats.latencyMax	= latencyMax;
+		return stats;
+	}
+
+	DWORD GetLatencyBuckets() const			{ return LatencyBuckets; }
+	uint64_t GetLatencyBound(DWORD index) const	{ return index < LatencyBounds.size() ? LatencyBounds[index] : 0; }
+	uint64_t GetLatencyCount(DWORD index) const	{ return index < LatencyBuckets ? latencyHistogram[index].load() : 0; }
+
+private:
+	std::atomic<uint64_t> started = 0;
+	std::atomic<uint64_t> connected = 0;
+	std::atomic<uint64_t> failed = 0;
+	std::atomic<uint64_t> aborted = 0;
+	std::atomic<uint32_t> pending = 0;
+	std::atomic<uint32_t> maxPending = 0;
+	std::atomic<uint64_t> latencyLast = 0;
+	std::atomic<uint64_t> latencyTotal = 0;
+	std::atomic<uint64_t> latencyMax = 0;
+	std::array<std::atomic<uint64_t>, LatencyBuckets> latencyHistogram = {};
+};
+%}
+
+%nodefaultctor DTLSHandshakeStats;
+struct DTLSHandshakeStats
+{
+	uint64_t started;
+	uint64_t connected;
+	uint64_t failed;
+	uint64_t aborted;
+	uint32_t pending;
+	uint32_t maxPending;
+	uint64_t latencyLast;
+	uint64_t latencyAvg;
+	uint64_t latencyMax;
+};
+
+%nodefaultctor DTLSHandshakeMonitor;
+class DTLSHandshakeMonitor
+{
+public:
+	DTLSHandshakeStats GetStats() const;
+	DWORD GetLatencyBuckets() const;
+	uint64_t GetLatencyBound(DWORD index) const;
+	uint64_t GetLatencyCount(DWORD index) const;
+};
+
+SHARED_PTR_BEGIN(DTLSHandshakeMonitor)
+{
+	DTLSHandshakeMonitorShared()
+	{
+		return new std::shared_ptr<DTLSHandshakeMonitor>(new DTLSHandshakeMonitor());
+	}
+}
+SHARED_PTR_END(DTLSHandshakeMonitor)
@@ -1,4 +1,5 @@
 %include "MediaServer.i"
+%include "DTLSHandshakeMonitor.i"
 
 %{
 
@@ -11,7 +12,21 @@ public:
 		persistent = std::make_shared<Persistent<v8::Object>>(object);
 	}
 		
-	virtual ~DTLSICETransportListener() = default;
+	virtual ~DTLSICETransportListener()
+	{
+		//Handshake did not finish
+		if (monitor && handshaking)
+			monitor->Abort();
+	}
+
+	/*
+	 * SetHandshakeMonitor
+	 *  Account handshakes on the monitor, must be set before the listener is set on the transport
+	 */
+	void SetHandshakeMonitor(const std::shared_ptr<DTLSHandshakeMonitor>& monitor)
+	{
+		this->monitor = monitor;
+	}
 	
 	virtual void onRemoteICECandidateActivated(const std::string& ip, uint16_t port, uint32_t priority) override
 	{
@@ -31,6 +46,9 @@ public:
 	
 	virtual void onDTLSStateChanged(const DTLSICETransport::DTLSState state) override 
 	{
+		//Account handshake on the transport loop
+		if (monitor)
+			UpdateHandshake(state);
 		//Run function on main node thread
 		MediaServer::Async([=,cloned=persistent](){
 			Nan::HandleScope scope;
@@ -93,8 +111,37 @@ public:
 		});
 	}
 
+private:
+	void UpdateHandshake(const DTLSICETransport::DTLSState state)
+	{
+		switch(state)
+		{
+			case DTLSICETransport::DTLSState::Connecting:
+				//Start once
+				if (!handshaking)
+					handshakeStart = monitor->Start();
+				handshaking = true;
+				return;
+			case DTLSICETransport::DTLSState::Connected:
+			case DTLSICETransport::DTLSState::Failed:
+				if (handshaking)
+					monitor->Finish(handshakeStart, state == DTLSICETransport::DTLSState::Connected);
+				break;
+			case DTLSICETransport::DTLSState::Closed:
+				if (handshaking)
+					monitor->Abort();
+				break;
+			default:
+				return;
+		}
+		handshaking = false;
+	}
+
 private:
 	std::shared_ptr<Persistent<v8::Object>> persistent;
+	std::shared_ptr<DTLSHandshakeMonitor> monitor;
+	DTLSHandshakeMonitor::Clock::time_point handshakeStart;
+	bool handshaking = false;
 };
 %}
 
@@ -102,6 +149,7 @@ class DTLSICETransportListener
 {
 public:
 	DTLSICETransportListener(v8::Local<v8::Object> object);
+	void SetHandshakeMonitor(const DTLSHandshakeMonitorShared& monitor);
 };
 
 
@@ -0,0 +1,240 @@
+%include "EventLoop.i"
+
+%{
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <sys/resource.h>
+
+struct EventLoopLoadStats
+{
+	uint32_t period		= 0;
+	uint64_t samples	= 0;
+	uint64_t elapsed	= 0;
+	uint64_t busy		= 0;
+	uint64_t idle		= 0;
+	double load		= 0;
+	uint64_t wakeups	= 0;
+	uint64_t preemptions	= 0;
+	uint64_t timerLagAvg	= 0;
+	uint64_t timerLagMax	= 0;
+	uint64_t asyncDelay	= 0;
+	uint64_t asyncDelayMax	= 0;
+	uint32_t asyncPending	= 0;
+};
+
+/*
+ * EventLoopMonitor
+ *  Samples the load of a loop from a periodic timer running on it. On each tick it reads the cpu time and the
+ *  voluntary context switches (wakeups from poll) of the loop thread, measures how late the timer fired and
+ *  posts an async task to measure how long tasks wait on the loop queue. All times are in microseconds and
+ *  stats can be read from any thread without blocking the loop.
+ */
+class EventLoopMonitor :
+	public std::enable_shared_from_this<EventLoopMonitor>
+{
+public:
+	//Upper bounds of the timer lag histogram buckets in us, last one has no limit
+	static constexpr std::array<uint64_t, 9> LagBounds = { 100, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000 };
+	static constexpr size_t LagBuckets = LagBounds.size() + 1;
+
+public:
+	static std::shared_ptr<EventLoopMonitor> Create(TimeService& timeService, DWORD period)
+	{
+		auto monitor = std::shared_ptr<EventLoopMonitor>(new EventLoopMonitor(timeService, std::max<DWORD>(period, 1)));
+		monitor->Start();
+		return monitor;
+	}
+
+	~EventLoopMonitor() = default;
+
+	void Stop()
+	{
+		//Cancel timer on the loop
+		timeService.Async([weak = weak_from_this()](std::chrono::milliseconds) {
+			if (auto monitor = weak.lock())
+			{
+				if (monitor->timer)
+					monitor->timer->Cancel();
+				monitor->timer.reset();
+			}
+		});
+	}
+
+	EventLoopLoadStats GetStats() const
+	{
+		EventLoopLoadStats stats;
+		stats.period		= period.count();
+		stats.samples		= samples;
+		stats.elapsed		= elapsed;
+		stats.busy		= busy;
+		stats.idle		= elapsed > busy ? elapsed - busy : 0;
+		stats.load		= load;
+		stats.wakeups		= wakeups;
+		stats.preemptions	= preemptions;
+		stats.timerLagAvg	= samples ? lagTotal / samples : 0;
+		stats.timerLagMax	= lagMax;
+		stats.asyncDelay	= asyncDelay;
+		stats.asyncDelayMax	= asyncDelayMax;
+		stats.asyncPending	= asyncPending;
+		return stats;
+	}
+
+	DWORD GetTimerLagBuckets() const		{ return LagBuckets; }
+	uint64_t GetTimerLagBound(DWORD index) const	{ return index < LagBounds.size() ? LagBounds[index] : 0; }
+	uint64_t GetTimerLagCount(DWORD index) const	{ return index < LagBuckets ? lagHistogram[index].load() : 0; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	EventLoopMonitor(TimeService& timeService, DWORD period) :
+		timeService(timeService),
+		period(period)
+	{
+	}
+
+	void Start()
+	{
+		timeService.Async([weak = weak_from_this()](std::chrono::milliseconds) {
+			auto monitor = weak.lock();
+			if (!monitor)
+				return;
+			//Initial sample
+			monitor->start = monitor->last = Clock::now();
+			monitor->ReadUsage(monitor->startCpu, monitor->startWakeups, monitor->startPreemptions);
+			monitor->lastCpu = monitor->startCpu;
+			//Sample periodically
+			monitor->timer = monitor->timeService.CreateTimer(monitor->period, monitor->period, [weak](std::chrono::milliseconds) {
+				if (auto monitor = weak.lock())
+					monitor->Sample();
+			});
+		});
+	}
+
+	/*
+	 * Sample
+	 *  Called on the loop thread
+	 */
+	void Sample()
+	{
+		auto now = Clock::now();
+
+		//Timer lag against previous tick
+		auto expected = last + period;
+		uint64_t lag = now > expected ? std::chrono::duration_cast<std::chrono::microseconds>(now - expected).count() : 0;
+		size_t bucket = std::upper_bound(LagBounds.begin(), LagBounds.end(), lag) - LagBounds.begin();
+		lagHistogram[bucket]++;
+		lagTotal += lag;
+		if (lag > lagMax)
+			lagMax = lag;
+
+		//Thread usage
+		uint64_t cpu = 0, voluntary = 0, involuntary = 0;
+		ReadUsage(cpu, voluntary, involuntary);
+		uint64_t window = std::chrono::duration_cast<std::chrono::microseconds>(now - last).count();
+		load		= window ? std::min(1.0, (double)(cpu - lastCpu) / window) : 0;
+		busy		= cpu - startCpu;
+		elapsed		= std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
+		wakeups		= voluntary - startWakeups;
+		preemptions	= involuntary - startPreemptions;
+		lastCpu		= cpu;
+		last		= now;
+		samples++;
+
+		//Measure queue delay with a single task in flight, if previous is still pending the queue is blocked
+		if (!asyncPending)
+		{
+			asyncPending++;
+			timeService.Async([weak = weak_from_this(), posted = now](std::chrono::milliseconds) {
+				auto monitor = weak.lock();
+				if (!monitor)
+					return;
+				uint64_t delay = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - posted).count();
+				monitor->asyncDelay = delay;
+				if (delay > monitor->asyncDelayMax)
+					monitor->asyncDelayMax = delay;
+				monitor->asyncPending--;
+			});
+		}
+	}
+
+	static void ReadUsage(uint64_t& cpu, uint64_t& voluntary, uint64_t& involuntary)
+	{
+#ifdef RUSAGE_THREAD
+		rusage usage = {};
+		if (getrusage(RUSAGE_THREAD, &usage) == 0)
+		{
+			cpu		= (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ull + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+			voluntary	= usage.ru_nvcsw;
+			involuntary	= usage.ru_nivcsw;
+		}
+#endif
+	}
+
+private:
+	TimeService& timeService;
+	std::chrono::milliseconds period;
+	Timer::shared timer;
+
+	//Only accessed on the loop thread
+	Clock::time_point start;
+	Clock::time_point last;
+	uint64_t startCpu = 0;
+	uint64_t startWakeups = 0;
+	uint64_t startPreemptions = 0;
+	uint64_t lastCpu = 0;
+
+	//Read from any thread
+	std::atomic<uint64_t> samples = 0;
+	std::atomic<uint64_t> elapsed = 0;
+	std::atomic<uint64_t> busy = 0;
+	std::atomic<double> load = 0;
+	std::atomic<uint64_t> wakeups = 0;
+	std::atomic<uint64_t> preemptions = 0;
+	std::atomic<uint64_t> lagTotal = 0;
+	std::atomic<uint64_t> lagMax = 0;
+	std::array<std::atomic<uint64_t>, LagBuckets> lagHistogram = {};
+	std::atomic<uint64_t> asyncDelay = 0;
+	std::atomic<uint64_t> asyncDelayMax = 0;
+	std::atomic<uint32_t> asyncPending = 0;
+};
+%}
+
+%nodefaultctor EventLoopLoadStats;
+struct EventLoopLoadStats
+{
+	uint32_t period;
+	uint64_t samples;
+	uint64_t elapsed;
+	uint64_t busy;
+	uint64_t idle;
+	double load;
+	uint64_t wakeups;
+	uint64_t preemptions;
+	uint64_t timerLagAvg;
+	uint64_t timerLagMax;
+	uint64_t asyncDelay;
+	uint64_t asyncDelayMax;
+	uint32_t asyncPending;
+};
+
+%nodefaultctor EventLoopMonitor;
+class EventLoopMonitor
+{
+public:
+	void Stop();
+	EventLoopLoadStats GetStats() const;
+	DWORD GetTimerLagBuckets() const;
+	uint64_t GetTimerLagBound(DWORD index) const;
+	uint64_t GetTimerLagCount(DWORD index) const;
+};
+
+SHARED_PTR_BEGIN(EventLoopMonitor)
+{
+	EventLoopMonitorShared(TimeService& timeService, DWORD period)
+	{
+		return new std::shared_ptr<EventLoopMonitor>(EventLoopMonitor::Create(timeService, period));
+	}
+}
+SHARED_PTR_END(EventLoopMonitor)
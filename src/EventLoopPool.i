@@ -0,0 +1,172 @@
+%include "EventLoop.i"
+
+%{
+#include <memory>
+#include <vector>
+
+struct EventLoopPoolStats
+{
+	uint32_t size		= 0;
+	uint32_t borrowed	= 0;
+	uint32_t minLoad	= 0;
+	uint32_t maxLoad	= 0;
+};
+
+/*
+ * EventLoopPool
+ *  Fixed number of running event loops shared by the objects that need their own time service, so the
+ *  number of threads is bounded by the pool size instead of growing with the number of objects. Loops
+ *  are borrowed by least load, where the load is the number of current borrowers, and optionally
+ *  pinned to consecutive cores.
+ */
+class EventLoopPool
+{
+public:
+	/*
+	 * size is the number of loops, firstCore the core of the first loop (-1 for no pinning) and
+	 * name the thread name prefix
+	 */
+	EventLoopPool(DWORD size, int firstCore, const std::string& name)
+	{
+		size = std::max<DWORD>(size, 1);
+		for (DWORD i = 0; i < size; ++i)
+		{
+			auto loop = std::make_unique<EventLoop>();
+			loop->Start();
+			//Pin it
+			if (firstCore >= 0 && !loop->SetAffinity(firstCore + i))
+				Warning("-EventLoopPool::EventLoopPool() could not set affinity [loop:%u,core:%d]\n", i, firstCore + i);
+			//Thread names are limited to 15 chars
+			std::string suffix = "-" + std::to_string(i);
+			loop->SetThreadName(name.substr(0, 15 - suffix.size()) + suffix);
+			loops.push_back({ std::move(loop), 0 });
+		}
+		Log("-EventLoopPool::EventLoopPool() [size:%u,firstCore:%d]\n", size, firstCore);
+	}
+
+	~EventLoopPool()
+	{
+		ScopedLock lock(mutex);
+		for (auto& entry : loops)
+		{
+			//Borrowers still hold a reference to the loop, so don't free it under them
+			if (entry.load)
+			{
+				Error("-EventLoopPool::~EventLoopPool() loop still borrowed, not freeing it [load:%u]\n", entry.load);
+				entry.loop->Stop();
+				entry.loop.release();
+				continue;
+			}
+			entry.loop->Stop();
+		}
+	}
+
+	/*
+	 * Borrow
+	 *  Get the least loaded loop, it must be returned when not used anymore
+	 */
+	TimeService& Borrow()
+	{
+		ScopedLock lock(mutex);
+		auto least = std::min_element(loops.begin(), loops.end(), [](const auto& a, const auto& b) { return a.load < b.load; });
+		least->load++;
+		return *least->loop;
+	}
+
+	bool Return(TimeService& timeService)
+	{
+		ScopedLock lock(mutex);
+		for (auto& entry : loops)
+		{
+			if (static_cast<TimeService*>(entry.loop.get()) != &timeService)
+				continue;
+			if (!entry.load)
+				return Error("-EventLoopPool::Return() loop was not borrowed\n");
+			entry.load--;
+			//Stop it now if the pool was stopped while it was borrowed
+			if (stopped && !entry.load)
+				entry.loop->Stop();
+			return true;
+		}
+		return Error("-EventLoopPool::Return() loop not in pool\n");
+	}
+
+	bool Owns(const TimeService& timeService) const
+	{
+		for (const auto& entry : loops)
+			if (static_cast<const TimeService*>(entry.loop.get()) == &timeService)
+				return true;
+		return false;
+	}
+
+	/*
+	 * Stop
+	 *  Stop the loops not borrowed, the borrowed ones are stopped when they are returned
+	 */
+	void Stop()
+	{
+		ScopedLock lock(mutex);
+		stopped = true;
+		for (auto& entry : loops)
+			if (!entry.load)
+				entry.loop->Stop();
+	}
+
+	DWORD GetSize() const	{ return loops.size(); }
+
+	DWORD GetLoad(DWORD index)
+	{
+		ScopedLock lock(mutex);
+		return index < loops.size() ? loops[index].load : 0;
+	}
+
+	EventLoopPoolStats GetStats()
+	{
+		ScopedLock lock(mutex);
+		EventLoopPoolStats stats;
+		stats.size	= loops.size();
+		stats.minLoad	= loops.front().load;
+		for (const auto& entry : loops)
+		{
+			stats.borrowed	+= entry.load;
+			stats.minLoad	= std::min(stats.minLoad, entry.load);
+			stats.maxLoad	= std::max(stats.maxLoad, entry.load);
+		}
+		return stats;
+	}
+
+private:
+	struct Entry
+	{
+		std::unique_ptr<EventLoop> loop;
+		uint32_t load;
+	};
+
+private:
+	Mutex mutex;
+	std::vector<Entry> loops;
+	bool stopped = false;
+};
+%}
+
+%nodefaultctor EventLoopPoolStats;
+struct EventLoopPoolStats
+{
+	uint32_t size;
+	uint32_t borrowed;
+	uint32_t minLoad;
+	uint32_t maxLoad;
+};
+
+class EventLoopPool
+{
+public:
+	EventLoopPool(DWORD size, int firstCore, const std::string& name);
+	TimeService& Borrow();
+	bool Return(TimeService& timeService);
+	bool Owns(const TimeService& timeService) const;
+	void Stop();
+	DWORD GetSize() const;
+	DWORD GetLoad(DWORD index);
+	EventLoopPoolStats GetStats();
+};
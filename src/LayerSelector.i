@@ -0,0 +1,234 @@
+%{
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+struct LayerSelection
+{
+	int position		= -1;
+	int index		= -1;
+	int minPosition		= -1;
+	int minIndex		= -1;
+};
+
+/*
+ * LayerSelector
+ *  Answers which is the best layer of an active layer table that fits on a target bitrate. Layers are
+ *  added in the table order (by bitrate descending) and, for each traversal and max layer/dimension caps,
+ *  the filtered and ordered layers are precomputed once by Prepare() together with the running minimum
+ *  of their bitrates. As the best layer is the first one in traversal order below target, and that is
+ *  also the first position where the running minimum is below target, Select() is a binary search.
+ *  Orderings are valid until the layers are cleared.
+ */
+class LayerSelector
+{
+public:
+	static constexpr int Default			= 0;
+	static constexpr int SpatialTemporal		= 1;
+	static constexpr int ZigZagSpatialTemporal	= 2;
+	static constexpr int TemporalSpatial		= 3;
+	static constexpr int ZigZagTemporalSpatial	= 4;
+
+public:
+	void Clear()
+	{
+		layers.clear();
+		orderings.clear();
+	}
+
+	/*
+	 * AddLayer
+	 *  width and height are the actual or target ones, -1 if unknown
+	 */
+	void AddLayer(double bitrate, double targetBitrate, BYTE spatialLayerId, BYTE temporalLayerId, int simulcastIdx, int width, int height)
+	{
+		Layer layer;
+		//Use the max of the actual and signaled target bitrate
+		layer.bitrate		= targetBitrate ? std::max(bitrate, targetBitrate) : bitrate;
+		layer.spatialLayerId	= spatialLayerId;
+		layer.temporalLayerId	= temporalLayerId;
+		layer.simulcastIdx	= simulcastIdx;
+		layer.width		= width;
+		layer.height		= height;
+		layers.push_back(layer);
+	}
+
+	/*
+	 * Prepare
+	 *  Get the ordering for the traversal and caps, computing it only the first time. Returns the
+	 *  ordering id to be used on the other methods.
+	 */
+	int Prepare(int traversal, BYTE maxSpatialLayerId, BYTE maxTemporalLayerId, DWORD maxWidth, DWORD maxHeight)
+	{
+		//If we are filtering by max width/height the default traversal is spatial-temporal
+		if (traversal == Default && (maxWidth || maxHeight))
+			traversal = SpatialTemporal;
+
+		//Check if already computed, they are a few
+		for (size_t i = 0; i < orderings.size(); ++i)
+		{
+			const auto& ordering = orderings[i];
+			if (ordering.traversal == traversal && ordering.maxSpatialLayerId == maxSpatialLayerId && ordering.maxTemporalLayerId == maxTemporalLayerId
+				&& ordering.maxWidth == maxWidth && ordering.maxHeight == maxHeight)
+				return i;
+		}
+
+		Ordering ordering;
+		ordering.traversal		= traversal;
+		ordering.maxSpatialLayerId	= maxSpatialLayerId;
+		ordering.maxTemporalLayerId	= maxTemporalLayerId;
+		ordering.maxWidth		= maxWidth;
+		ordering.maxHeight		= maxHeight;
+
+		//Filter by max layers
+		for (size_t i = 0; i < layers.size(); ++i)
+			if (layers[i].spatialLayerId <= maxSpatialLayerId && layers[i].temporalLayerId <= maxTemporalLayerId)
+				ordering.indexes.push_back(i);
+
+		//Order by traversal, stable so layers with same key keep the bitrate order
+		if (traversal != Default)
+			std::stable_sort(ordering.indexes.begin(), ordering.indexes.end(), [&](int a, int b) {
+				return GetKey(traversal, layers[a]) > GetKey(traversal, layers[b]);
+			});
+
+		//Compute running minimum of the bitrate of layers within max dimensions, and the position of the lowest non zero one before each layer
+		double runningMin = std::numeric_limits<double>::infinity();
+		double min = std::numeric_limits<double>::infinity();
+		int minPosition = -1;
+		ordering.minimums.reserve(ordering.indexes.size());
+		ordering.minPositions.reserve(ordering.indexes.size() + 1);
+		for (size_t i = 0; i < ordering.indexes.size(); ++i)
+		{
+			const auto& layer = layers[ordering.indexes[i]];
+			if ((!maxWidth || (layer.width >= 0 && (DWORD)layer.width <= maxWidth)) && (!maxHeight || (layer.height >= 0 && (DWORD)layer.height <= maxHeight)))
+				runningMin = std::min(runningMin, layer.bitrate);
+			ordering.minimums.push_back(runningMin);
+			ordering.minPositions.push_back(minPosition);
+			if (layer.bitrate > 0 && layer.bitrate < min)
+			{
+				min = layer.bitrate;
+				minPosition = i;
+			}
+		}
+		ordering.minPositions.push_back(minPosition);
+
+		orderings.push_back(std::move(ordering));
+		return orderings.size() - 1;
+	}
+
+	DWORD GetSize(int id) const
+	{
+		return IsValid(id) ? orderings[id].indexes.size() : 0;
+	}
+
+	/*
+	 * GetIndex
+	 *  Get the index on the layer table of the layer in that position of the ordering
+	 */
+	int GetIndex(int id, DWORD position) const
+	{
+		if (!IsValid(id) || position >= orderings[id].indexes.size())
+			return -1;
+		return orderings[id].indexes[position];
+	}
+
+	/*
+	 * Select
+	 *  Find the first layer of the ordering that fits on target bitrate, and the one with the lowest
+	 *  non zero bitrate before it to fall back to when it has none.
+	 */
+	LayerSelection Select(int id, double target) const
+	{
+		LayerSelection selection;
+		if (!IsValid(id))
+			return selection;
+		const auto& ordering = orderings[id];
+		//Running minimums are not increasing, find first one below target
+		auto it = std::partition_point(ordering.minimums.begin(), ordering.minimums.end(), [=](double min) { return min > target; });
+		size_t position = it - ordering.minimums.begin();
+		if (it != ordering.minimums.end())
+		{
+			selection.position	= position;
+			selection.index		= ordering.indexes[position];
+		}
+		//Get lowest one before it
+		selection.minPosition = ordering.minPositions[position];
+		if (selection.minPosition >= 0)
+			selection.minIndex = ordering.indexes[selection.minPosition];
+		return selection;
+	}
+
+private:
+	struct Layer
+	{
+		double bitrate		= 0;
+		BYTE spatialLayerId	= LayerInfo::MaxLayerId;
+		BYTE temporalLayerId	= LayerInfo::MaxLayerId;
+		int simulcastIdx	= -1;
+		int width		= -1;
+		int height		= -1;
+	};
+
+	struct Ordering
+	{
+		int traversal			= Default;
+		BYTE maxSpatialLayerId		= LayerInfo::MaxLayerId;
+		BYTE maxTemporalLayerId		= LayerInfo::MaxLayerId;
+		DWORD maxWidth			= 0;
+		DWORD maxHeight			= 0;
+		std::vector<int> indexes;
+		std::vector<double> minimums;
+		std::vector<int> minPositions;
+	};
+
+	bool IsValid(int id) const
+	{
+		return id >= 0 && (size_t)id < orderings.size();
+	}
+
+	static int GetKey(int traversal, const Layer& layer)
+	{
+		//Either spatialLayerId on SVC stream or simulcastIdx on simulcast stream
+		int spatial = layer.spatialLayerId != LayerInfo::MaxLayerId ? layer.spatialLayerId : layer.simulcastIdx;
+		int temporal = layer.temporalLayerId;
+		switch (traversal)
+		{
+			case SpatialTemporal:
+				return spatial * LayerInfo::MaxLayerId + temporal;
+			case ZigZagSpatialTemporal:
+				return (spatial + temporal + 1) * LayerInfo::MaxLayerId - temporal;
+			case TemporalSpatial:
+				return temporal * LayerInfo::MaxLayerId + spatial;
+			case ZigZagTemporalSpatial:
+				return (spatial + temporal + 1) * LayerInfo::MaxLayerId - spatial;
+			default:
+				return 0;
+		}
+	}
+
+private:
+	std::vector<Layer> layers;
+	std::vector<Ordering> orderings;
+};
+%}
+
+%nodefaultctor LayerSelection;
+struct LayerSelection
+{
+	int position;
+	int index;
+	int minPosition;
+	int minIndex;
+};
+
+class LayerSelector
+{
+public:
+	LayerSelector();
+	void Clear();
+	void AddLayer(double bitrate, double targetBitrate, BYTE spatialLayerId, BYTE temporalLayerId, int simulcastIdx, int width, int height);
+	int Prepare(int traversal, BYTE maxSpatialLayerId, BYTE maxTemporalLayerId, DWORD maxWidth, DWORD maxHeight);
+	DWORD GetSize(int id) const;
+	int GetIndex(int id, DWORD position) const;
+	LayerSelection Select(int id, double target) const;
+};
@@ -0,0 +1,356 @@
+%{
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+/*
+ * MMapPCAPReader
+ *  UDP reader for pcap files that maps the whole capture in memory, so reading
+ *  packets does not require any syscall. Seeking uses a time to offset index that
+ *  is built lazily on first seek and persisted on a sidecar file next to the capture.
+ *  The sidecar is only reused while the capture keeps the size and modification time
+ *  it was built for, otherwise it is rebuilt.
+ */
+class MMapPCAPReader : public UDPReader
+{
+public:
+	//Add an index entry every N packets
+	static constexpr size_t IndexInterval = 256;
+	static constexpr uint32_t IndexMagic = 0x4d504958; //"MPIX"
+	static constexpr uint32_t IndexVersion = 2;
+
+public:
+	MMapPCAPReader() = default;
+
+	virtual ~MMapPCAPReader()
+	{
+		Close();
+	}
+
+	bool Open(const char* filename)
+	{
+		//Close previous
+		Close();
+
+		//Open file
+		int fd = open(filename, O_RDONLY);
+		if (fd < 0)
+			return Error("-MMapPCAPReader::Open() could not open file [filename:%s,errno:%d]\n", filename, errno);
+
+		struct stat st;
+		//Get size
+		if (fstat(fd, &st) < 0 || st.st_size < 24)
+		{
+			close(fd);
+			return Error("-MMapPCAPReader::Open() invalid file [filename:%s]\n", filename);
+		}
+
+		//Map it private so packets can be modified in place without touching the file
+		void* addr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		//Not needed anymore
+		close(fd);
+		if (addr == MAP_FAILED)
+			return Error("-MMapPCAPReader::Open() could not map file [filename:%s,errno:%d]\n", filename, errno);
+
+		//We read it sequentially
+		madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+		data	= (uint8_t*)addr;
+		size	= st.st_size;
+		//Use full precision, a capture rewritten within the same second must not reuse the index
+		mtime	= (uint64_t)st.st_mtim.tv_sec * 1000000000ull + st.st_mtim.tv_nsec;
+		path	= filename;
+
+		//Check magic
+		uint32_t magic = get4(data, 0);
+		switch (magic)
+		{
+			case 0xa1b2c3d4:
+				bigEndian = true;  nanos = false; break;
+			case 0xd4c3b2a1:
+				bigEndian = false; nanos = false; break;
+			case 0xa1b23c4d:
+				bigEndian = true;  nanos = true;  break;
+			case 0x4d3cb2a1:
+				bigEndian = false; nanos = true;  break;
+			default:
+				Close();
+				return Error("-MMapPCAPReader::Open() not a pcap file [filename:%s,magic:%x]\n", filename, magic);
+		}
+
+		//Get link type
+		linkType = Read32(data + 20);
+
+		//Start reading after global header
+		Rewind();
+
+		Log("-MMapPCAPReader::Open() [filename:%s,size:%zu,linkType:%u]\n", filename, size, linkType);
+
+		return true;
+	}
+
+	virtual uint64_t Next() override
+	{
+		//Read records until we find an udp packet
+		while (offset + 16 <= size)
+		{
+			const uint8_t* record = data + offset;
+			//Get record header
+			uint64_t sec	= Read32(record);
+			uint64_t frac	= Read32(record + 4);
+			uint32_t caplen	= Read32(record + 8);
+			//Check size
+			if (offset + 16 + caplen > size)
+				break;
+			//Move to next record
+			offset += 16 + caplen;
+			//Try to get udp payload
+			if (!ParseUDP(data + (offset - caplen), caplen))
+				continue;
+			//Got it
+			return sec * 1000000 + (nanos ? frac / 1000 : frac);
+		}
+		//End of file
+		udp	= nullptr;
+		udpSize	= 0;
+		return 0;
+	}
+
+	virtual uint8_t* GetUDPData() override	{ return udp;		}
+	virtual uint32_t GetUDPSize() override	{ return udpSize;	}
+
+	virtual uint64_t Seek(const uint64_t time) override
+	{
+		//Ensure we have an index
+		if (index.empty())
+		{
+			indexReused = LoadIndex();
+			if (!indexReused)
+				BuildIndex();
+		}
+
+		//Nothing to seek
+		if (index.empty())
+			return 0;
+
+		//Seek relative to first packet
+		uint64_t target = index.front().first + time * 1000;
+
+		//Find last indexed packet before the target time
+		auto it = std::upper_bound(index.begin(), index.end(), target, [](uint64_t ts, const auto& entry) {
+			return ts < entry.first;
+		});
+		if (it != index.begin())
+			--it;
+
+		//Start reading from there
+		offset = it->second;
+
+		//Read until we reach the target
+		while (true)
+		{
+			size_t current = offset;
+			uint64_t ts = Next();
+			//If end of file or reached
+			if (!ts || ts >= target)
+			{
+				//Next read will return this packet again
+				offset = current;
+				return ts;
+			}
+		}
+	}
+
+	virtual void Rewind() override
+	{
+		offset	= 24;
+		udp	= nullptr;
+		udpSize	= 0;
+	}
+
+	virtual bool Close() override
+	{
+		if (data)
+			munmap(data, size);
+		data	= nullptr;
+		size	= 0;
+		offset	= 0;
+		udp	= nullptr;
+		udpSize	= 0;
+		index.clear();
+		indexReused = false;
+		return true;
+	}
+
+	size_t GetIndexSize() const	{ return index.size();	}
+	bool IsIndexReused() const	{ return indexReused;	}
+
+private:
+	uint32_t Read32(const uint8_t* buffer) const
+	{
+		uint32_t val = get4(buffer, 0);
+		return bigEndian ? val : __builtin_bswap32(val);
+	}
+
+	bool ParseUDP(uint8_t* packet, uint32_t len)
+	{
+		uint32_t ini = 0;
+		uint16_t proto = 0;
+
+		//Get network protocol depending on the link type
+		switch (linkType)
+		{
+			case 0:		//DLT_NULL
+				if (len < 4) return false;
+				proto = Read32(packet) == 2 ? 0x0800 : 0x86DD;
+				ini = 4;
+				break;
+			case 1:		//DLT_EN10MB
+				if (len < 14) return false;
+				proto = get2(packet, 12);
+				ini = 14;
+				//Skip vlan tags
+				while (proto == 0x8100 && len >= ini + 4)
+				{
+					proto = get2(packet, ini + 2);
+					ini += 4;
+				}
+				break;
+			case 12:	//DLT_RAW
+			case 14:
+			case 101:
+				if (!len) return false;
+				proto = (packet[0] >> 4) == 4 ? 0x0800 : 0x86DD;
+				break;
+			case 113:	//DLT_LINUX_SLL
+				if (len < 16) return false;
+				proto = get2(packet, 14);
+				ini = 16;
+				break;
+			case 276:	//DLT_LINUX_SLL2
+				if (len < 20) return false;
+				proto = get2(packet, 0);
+				ini = 20;
+				break;
+			default:
+				return false;
+		}
+
+		//Check ip version
+		if (proto == 0x0800)
+		{
+			if (len < ini + 20) return false;
+			uint32_t ihl = (packet[ini] & 0x0F) * 4;
+			//Only first fragment of udp packets
+			if (packet[ini + 9] != 17 || (get2(packet, ini + 6) & 0x1FFF))
+				return false;
+			ini += ihl;
+		} else if (proto == 0x86DD) {
+			if (len < ini + 40 || packet[ini + 6] != 17)
+				return false;
+			ini += 40;
+		} else {
+			return false;
+		}
+
+		//Check udp header
+		if (len < ini + 8)
+			return false;
+		uint32_t udpLen = get2(packet, ini + 4);
+		if (udpLen < 8 || ini + udpLen > len)
+			return false;
+
+		udp	= packet + ini + 8;
+		udpSize	= udpLen - 8;
+		return true;
+	}
+
+	void BuildIndex()
+	{
+		Debug(">MMapPCAPReader::BuildIndex() [path:%s]\n", path.c_str());
+
+		//Scan from the start
+		Rewind();
+		size_t num = 0;
+		uint64_t last = 0;
+		while (true)
+		{
+			size_t current = offset;
+			uint64_t ts = Next();
+			if (!ts)
+				break;
+			//Keep index monotonic in case of reordered captures
+			last = std::max(last, ts);
+			if (num++ % IndexInterval == 0)
+				index.emplace_back(last, current);
+		}
+		Rewind();
+
+		//Persist it on a temp file and rename it, so concurrent readers never load a partial index
+		std::string tmp = path + ".idx.tmp." + std::to_string(getpid());
+		std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+		uint64_t header[4] = { ((uint64_t)IndexMagic << 32) | IndexVersion, (uint64_t)size, (uint64_t)mtime, (uint64_t)index.size() };
+		file.write((const char*)header, sizeof(header));
+		file.write((const char*)index.data(), index.size() * sizeof(index[0]));
+		file.close();
+		//On error the index is just not persisted
+		if (!file || rename(tmp.c_str(), (path + ".idx").c_str()))
+			unlink(tmp.c_str());
+
+		Debug("<MMapPCAPReader::BuildIndex() [entries:%zu]\n", index.size());
+	}
+
+	bool LoadIndex()
+	{
+		std::ifstream file(path + ".idx", std::ios::binary);
+		if (!file)
+			return false;
+		uint64_t header[4];
+		if (!file.read((char*)header, sizeof(header)))
+			return false;
+		//Check it is still valid for this capture
+		if (header[0] != (((uint64_t)IndexMagic << 32) | IndexVersion) || header[1] != size || header[2] != mtime || header[3] > size / 16)
+			return false;
+		index.resize(header[3]);
+		if (!file.read((char*)index.data(), index.size() * sizeof(index[0])))
+		{
+			index.clear();
+			return false;
+		}
+		return true;
+	}
+
+private:
+	std::string path;
+	uint8_t* data	= nullptr;
+	size_t size	= 0;
+	uint64_t mtime	= 0;
+	size_t offset	= 0;
+	bool bigEndian	= false;
+	bool nanos	= false;
+	uint32_t linkType = 0;
+	uint8_t* udp	 = nullptr;
+	uint32_t udpSize = 0;
+	std::vector<std::pair<uint64_t, uint64_t>> index;
+	bool indexReused = false;
+};
+%}
+
+class MMapPCAPReader : public UDPReader
+{
+public:
+	MMapPCAPReader();
+	bool Open(const char* filename);
+	virtual uint64_t Next();
+	virtual uint8_t* GetUDPData();
+	virtual uint32_t GetUDPSize();
+	virtual uint64_t Seek(const uint64_t time);
+	virtual void Rewind();
+	virtual bool Close();
+	size_t GetIndexSize() const;
+	bool IsIndexReused() const;
+};
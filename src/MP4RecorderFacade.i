@@ -2,6 +2,294 @@
 %include "MediaFrame.i"
 
 %{
+
+struct MP4RecorderTimeShiftStats
+{
+	size_t capacity		= 0;
+	size_t used		= 0;
+	size_t highWaterMark	= 0;
+	size_t frames		= 0;
+	size_t maxFrames	= 0;
+	uint64_t window		= 0;
+	size_t evicted		= 0;
+	size_t dropped		= 0;
+};
+
+/*
+ * TimeShiftBuffer
+ *  Fixed capacity ring of frames stored contiguously on a preallocated arena.
+ *  The arena is sized once from bitrate x duration, so buffering frames never
+ *  allocates and the memory used per recorder is known beforehand.
+ */
+class TimeShiftBuffer
+{
+public:
+	//Max number of frames per second (all tracks) used to size the frame slots
+	static constexpr DWORD MaxFrameRate = 250;
+
+public:
+	void Configure(DWORD duration, DWORD bitrate)
+	{
+		//Store window
+		this->duration = duration;
+		//Size arena for the whole window with a 25% margin for bursts
+		size_t capacity = duration ? (size_t)((QWORD)bitrate * duration / 8000 * 5 / 4) : 0;
+		//Allocate it only once
+		std::vector<BYTE>(capacity).swap(arena);
+		std::vector<Slot>(duration ? (size_t)duration * MaxFrameRate / 1000 + 1 : 0).swap(slots);
+		//Reset stats
+		stats = {};
+		stats.capacity = arena.size();
+		stats.maxFrames = slots.size();
+		//Empty ring
+		Clear();
+	}
+
+	bool IsEnabled() const
+	{
+		return duration && arena.size() && slots.size();
+	}
+
+	bool Push(DWORD ssrc, const MediaFrame& frame)
+	{
+		//Get serialized size
+		size_t length = frame.GetLength() + frame.GetCodecConfigSize() + sizeof(WORD);
+		//Add packetization info
+		for (const auto& info : frame.GetRtpPacketizationInfo())
+			length += 3 * sizeof(DWORD) + info.GetPrefixLen();
+
+		//If it would never fit
+		if (length > arena.size())
+		{
+			//Drop it
+			stats.dropped++;
+			return false;
+		}
+
+		//Remove frames out of the window
+		while (count && frame.GetTime() > Front().time + duration)
+			Evict();
+
+		//Get position for the frame, evicting old ones until there is room
+		size_t offset;
+		while (!Reserve(length, offset))
+			Evict();
+
+		//Get slot
+		Slot& slot = slots[(first + count) % slots.size()];
+		//Fill metadata
+		slot.ssrc	= ssrc;
+		slot.type	= frame.GetType();
+		slot.time	= frame.GetTime();
+		slot.timestamp	= frame.GetTimestamp();
+		slot.clockRate	= frame.GetClockRate();
+		slot.offset	= offset;
+		slot.length	= length;
+		slot.mediaLength	= frame.GetLength();
+		slot.configLength	= frame.GetCodecConfigSize();
+		//Depending on the type
+		if (frame.GetType()==MediaFrame::Video)
+		{
+			const VideoFrame& video = (const VideoFrame&)frame;
+			slot.codec	= video.GetCodec();
+			slot.intra	= video.IsIntra();
+			slot.width	= video.GetWidth();
+			slot.height	= video.GetHeight();
+		} else {
+			slot.codec	= ((const AudioFrame&)frame).GetCodec();
+			slot.intra	= false;
+			slot.width	= 0;
+			slot.height	= 0;
+		}
+
+		//Serialize payload
+		BYTE* data = arena.data() + offset;
+		memcpy(data, frame.GetData(), frame.GetLength());
+		data += frame.GetLength();
+		if (frame.GetCodecConfigSize())
+			memcpy(data, frame.GetCodecConfigData(), frame.GetCodecConfigSize());
+		data += frame.GetCodecConfigSize();
+		//Serialize packetization info
+		set2(data, 0, frame.GetRtpPacketizationInfo().size());
+		data += sizeof(WORD);
+		for (const auto& info : frame.GetRtpPacketizationInfo())
+		{
+			set4(data, 0, info.GetPos());
+			set4(data, 4, info.GetSize());
+			set4(data, 8, info.GetPrefixLen());
+			data += 3 * sizeof(DWORD);
+			if (info.GetPrefixLen())
+				memcpy(data, info.GetPrefixData(), info.GetPrefixLen());
+			data += info.GetPrefixLen();
+		}
+
+		//Enqueue slot
+		count++;
+		used += length;
+		end = offset + length;
+		//Update stats
+		stats.highWaterMark = std::max(stats.highWaterMark, used);
+		return true;
+	}
+
+	template<typename Func>
+	void Flush(Func&& func)
+	{
+		//Replay each buffered frame in order
+		for (; count; Release())
+		{
+			const Slot& slot = Front();
+			const BYTE* data = arena.data() + slot.offset;
+
+			std::unique_ptr<MediaFrame> frame;
+			//Create frame
+			if (slot.type==MediaFrame::Video)
+			{
+				auto video = std::make_unique<VideoFrame>((VideoCodec::Type)slot.codec, slot.mediaLength);
+				video->SetIntra(slot.intra);
+				video->SetWidth(slot.width);
+				video->SetHeight(slot.height);
+				frame = std::move(video);
+			} else {
+				frame = std::make_unique<AudioFrame>((AudioCodec::Type)slot.codec);
+			}
+			frame->SetTime(slot.time);
+			frame->SetTimestamp(slot.timestamp);
+			frame->SetClockRate(slot.clockRate);
+			frame->SetMedia(data, slot.mediaLength);
+			data += slot.mediaLength;
+			if (slot.configLength)
+				frame->SetCodecConfig(data, slot.configLength);
+			data += slot.configLength;
+			//Restore packetization info
+			WORD num = get2(data, 0);
+			data += sizeof(WORD);
+			for (WORD i = 0; i < num; ++i)
+			{
+				DWORD pos	= get4(data, 0);
+				DWORD size	= get4(data, 4);
+				DWORD prefixLen	= get4(data, 8);
+				data += 3 * sizeof(DWORD);
+				frame->AddRtpPacket(pos, size, prefixLen ? data : nullptr, prefixLen);
+				data += prefixLen;
+			}
+			//Deliver it
+			func(slot.ssrc, *frame);
+		}
+	}
+
+	void Clear()
+	{
+		first	= 0;
+		count	= 0;
+		used	= 0;
+		begin	= 0;
+		end	= 0;
+	}
+
+	MP4RecorderTimeShiftStats GetStats() const
+	{
+		MP4RecorderTimeShiftStats current = stats;
+		current.used	= used;
+		current.frames	= count;
+		current.window	= count ? slots[(first + count - 1) % slots.size()].time - Front().time : 0;
+		return current;
+	}
+
+private:
+	struct Slot
+	{
+		DWORD ssrc		= 0;
+		MediaFrame::Type type	= MediaFrame::Unknown;
+		DWORD codec		= 0;
+		bool intra		= false;
+		DWORD width		= 0;
+		DWORD height		= 0;
+		QWORD time		= 0;
+		QWORD timestamp		= 0;
+		DWORD clockRate		= 0;
+		size_t offset		= 0;
+		size_t length		= 0;
+		DWORD mediaLength	= 0;
+		DWORD configLength	= 0;
+	};
+
+	const Slot& Front() const
+	{
+		return slots[first];
+	}
+
+	void Evict()
+	{
+		//Dropped without being recorded
+		stats.evicted++;
+		Release();
+	}
+
+	void Release()
+	{
+		//Release space
+		used -= Front().length;
+		first = (first + 1) % slots.size();
+		count--;
+		//If empty
+		if (!count)
+			//Restart from the beginning
+			Clear();
+		else
+			//Oldest data starts at next frame
+			begin = Front().offset;
+	}
+
+	bool Reserve(size_t length, size_t& offset)
+	{
+		//No free slot
+		if (count == slots.size())
+			return false;
+		//If empty, all the arena is free
+		if (!count)
+		{
+			offset = 0;
+			return true;
+		}
+		//If data is not wrapped yet
+		if (end > begin)
+		{
+			//Free space at the tail
+			if (arena.size() - end >= length)
+			{
+				offset = end;
+				return true;
+			}
+			//Wrap around and skip the tail
+			if (begin >= length)
+			{
+				offset = 0;
+				return true;
+			}
+			return false;
+		}
+		//Free space between newest and oldest
+		if (begin - end >= length)
+		{
+			offset = end;
+			return true;
+		}
+		return false;
+	}
+
+private:
+	DWORD duration = 0;
+	std::vector<BYTE> arena;
+	std::vector<Slot> slots;
+	size_t first	= 0;
+	size_t count	= 0;
+	size_t used	= 0;
+	size_t begin	= 0;
+	size_t end	= 0;
+	MP4RecorderTimeShiftStats stats;
+};
+
 class MP4RecorderFacade :
 	public MP4Recorder,
 	public MP4Recorder::Listener
@@ -26,7 +314,7 @@ public:
 			MakeCallback(cloned, "onstarted", i, argv);
 		});
 	}
-	void onClosed() override 
+	void onClosed() override
 	{
 		//Run function on main node thread
 		MediaServer::Async([=,cloned=persistent](){
@@ -37,13 +325,83 @@ public:
 			MakeCallback(cloned, "onclosed", i, argv);
 		});
 	}
+
+	void onMediaFrame(const MediaFrame &frame) override
+	{
+		onMediaFrame(0, frame);
+	}
+
+	void onMediaFrame(DWORD ssrc, const MediaFrame &frame) override
+	{
+		ScopedLock lock(mutex);
+		//If we are buffering before recording
+		if (!recording && timeShift.IsEnabled())
+		{
+			//Store it on the arena
+			timeShift.Push(ssrc, frame);
+			return;
+		}
+		//Record it
+		MP4Recorder::onMediaFrame(ssrc, frame);
+	}
+
+	void SetTimeShiftDuration(DWORD duration, DWORD bitrate)
+	{
+		Debug("-MP4RecorderFacade::SetTimeShiftDuration() [duration:%u,bitrate:%u]\n", duration, bitrate);
+		ScopedLock lock(mutex);
+		//Preallocate buffer
+		timeShift.Configure(duration, bitrate);
+	}
+
+	bool Record(bool waitVideo, bool disableHints)
+	{
+		ScopedLock lock(mutex);
+		//Start recording
+		if (!MP4Recorder::Record(waitVideo, disableHints))
+			return false;
+		//Now frames go directly to the recorder
+		recording = true;
+		//Dump time shifted frames first
+		timeShift.Flush([this](DWORD ssrc, const MediaFrame& frame) {
+			MP4Recorder::onMediaFrame(ssrc, frame);
+		});
+		return true;
+	}
+
+	bool Stop()
+	{
+		ScopedLock lock(mutex);
+		//Not recording anymore
+		recording = false;
+		return MP4Recorder::Stop();
+	}
+
+	MP4RecorderTimeShiftStats GetTimeShiftStats()
+	{
+		ScopedLock lock(mutex);
+		return timeShift.GetStats();
+	}
 private:
 	std::shared_ptr<Persistent<v8::Object>> persistent;
+	Mutex mutex;
+	bool recording = false;
+	TimeShiftBuffer timeShift;
 };
 
 %}
 
-
+%nodefaultctor MP4RecorderTimeShiftStats;
+struct MP4RecorderTimeShiftStats
+{
+	size_t capacity;
+	size_t used;
+	size_t highWaterMark;
+	size_t frames;
+	size_t maxFrames;
+	uint64_t window;
+	size_t evicted;
+	size_t dropped;
+};
 
 class MP4RecorderFacade :
 	public MediaFrameListener
@@ -56,7 +414,8 @@ public:
 	bool Record(bool waitVideo, bool disableHints);
 	bool Stop();
 	bool Close();
-	void SetTimeShiftDuration(DWORD duration);
+	void SetTimeShiftDuration(DWORD duration, DWORD bitrate);
+	MP4RecorderTimeShiftStats GetTimeShiftStats();
 	bool SetH264ParameterSets(const std::string& sprops);
 	bool Close(bool async);
 };
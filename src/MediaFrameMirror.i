@@ -0,0 +1,456 @@
+%include "EventLoop.i"
+%include "MediaFrame.i"
+%include "SPSCRing.i"
+
+%{
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+struct MediaFrameMirrorStats
+{
+	uint32_t capacity	= 0;
+	uint32_t depth		= 0;
+	uint32_t maxDepth	= 0;
+	uint32_t backlog	= 0;
+	uint64_t pushed		= 0;
+	uint64_t delivered	= 0;
+	uint64_t deferred	= 0;
+	uint64_t dropped	= 0;
+	uint64_t wakeups	= 0;
+};
+
+class MediaFrameMirror;
+
+/*
+ * MediaFrameHub
+ *  Listens once to the frames of a producer running on the origin loop and hands them to the mirrors
+ *  created on it. Each frame is cloned once and shared by reference between all the mirrors, so mirroring
+ *  to N loops costs N queue pushes instead of N depacketizations. The hub is only attached to the
+ *  producer while it has mirrors, and frames are expected to be delivered on the origin loop.
+ */
+class MediaFrameHub :
+	public MediaFrame::Listener,
+	public std::enable_shared_from_this<MediaFrameHub>
+{
+public:
+	static std::shared_ptr<MediaFrameHub> Create(const MediaFrame::Producer::shared& producer, TimeService& timeService)
+	{
+		if (!producer)
+			return nullptr;
+		return std::shared_ptr<MediaFrameHub>(new MediaFrameHub(producer, timeService));
+	}
+
+	virtual ~MediaFrameHub() = default;
+
+	virtual void onMediaFrame(const MediaFrame& frame) override
+	{
+		onMediaFrame(0, frame);
+	}
+
+	virtual void onMediaFrame(DWORD ssrc, const MediaFrame& frame) override;
+
+	size_t GetMirrors()
+	{
+		ScopedLock lock(mutex);
+		return mirrors.size();
+	}
+
+	uint64_t GetFrames() const	{ return frames; }
+	TimeService& GetTimeService()	{ return timeService; }
+
+private:
+	friend class MediaFrameMirror;
+
+	MediaFrameHub(const MediaFrame::Producer::shared& producer, TimeService& timeService) :
+		producer(producer),
+		timeService(timeService)
+	{
+	}
+
+	void AddMirror(MediaFrameMirror* mirror)
+	{
+		bool first;
+		{
+			ScopedLock lock(mutex);
+			first = mirrors.empty();
+			mirrors.push_back(mirror);
+		}
+		//Start listening on first one, outside lock as producer may be delivering
+		if (first)
+			if (auto shared = producer.lock())
+				shared->AddMediaListener(shared_from_this());
+	}
+
+	void RemoveMirror(MediaFrameMirror* mirror)
+	{
+		bool last;
+		{
+			ScopedLock lock(mutex);
+			auto it = std::find(mirrors.begin(), mirrors.end(), mirror);
+			if (it == mirrors.end())
+				return;
+			mirrors.erase(it);
+			last = mirrors.empty();
+		}
+		//Stop listening when nobody is mirroring
+		if (last)
+			if (auto shared = producer.lock())
+				shared->RemoveMediaListener(shared_from_this());
+	}
+
+private:
+	Mutex mutex;
+	//Weak, as the producer keeps us while we are listening
+	std::weak_ptr<MediaFrame::Producer> producer;
+	TimeService& timeService;
+	std::vector<MediaFrameMirror*> mirrors;
+	std::atomic<uint64_t> frames = 0;
+};
+
+/*
+ * MediaFrameMirror
+ *  Produces the frames of a hub on another loop. Frames are pushed by the origin loop on a lock-free
+ *  single producer single consumer queue and delivered to the listeners on the mirror loop, with a
+ *  single wakeup for all the frames queued before it runs. While the queue is full frames wait on the
+ *  origin loop. If the backlog is full too, a key frame replaces the video frames waiting, and once a
+ *  video frame is lost the following ones are dropped until the next key frame, as they can't be decoded.
+ */
+class MediaFrameMirror :
+	public MediaFrame::Producer,
+	public std::enable_shared_from_this<MediaFrameMirror>
+{
+public:
+	//Max number of frames delivered on each wakeup, so a busy origin does not starve the mirror loop
+	static constexpr size_t MaxDrainBatch = 64;
+	//Max number of frames waiting on the origin loop while the queue is full
+	static constexpr size_t MaxBacklog = 1024;
+
+	static std::shared_ptr<MediaFrameMirror> Create(const std::shared_ptr<MediaFrameHub>& hub, TimeService& timeService, size_t capacity)
+	{
+		if (!hub)
+			return nullptr;
+		auto mirror = std::shared_ptr<MediaFrameMirror>(new MediaFrameMirror(hub, timeService, capacity));
+		hub->AddMirror(mirror.get());
+		return mirror;
+	}
+
+	virtual ~MediaFrameMirror()
+	{
+		Stop();
+	}
+
+	virtual void AddMediaListener(const MediaFrame::Listener::shared& listener) override
+	{
+		ScopedLock lock(mutex);
+		listeners.insert(listener);
+	}
+
+	virtual void RemoveMediaListener(const MediaFrame::Listener::shared& listener) override
+	{
+		ScopedLock lock(mutex);
+		listeners.erase(listener);
+	}
+
+	void Stop()
+	{
+		std::shared_ptr<MediaFrameHub> stopped;
+		{
+			ScopedLock lock(mutex);
+			stopped = std::move(hub);
+			listeners.clear();
+		}
+		//Stop receiving frames
+		if (stopped)
+			stopped->RemoveMirror(this);
+	}
+
+	MediaFrameMirrorStats GetStats() const
+	{
+		MediaFrameMirrorStats stats;
+		stats.capacity	= queue.GetCapacity();
+		stats.depth	= queue.GetSize();
+		stats.maxDepth	= queue.GetMaxDepth();
+		stats.backlog	= queue.GetBacklogSize();
+		stats.pushed	= queue.GetPushed();
+		stats.delivered	= queue.GetDelivered();
+		stats.deferred	= queue.GetDeferred();
+		stats.dropped	= queue.GetDropped();
+		stats.wakeups	= queue.GetWakeups();
+		return stats;
+	}
+
+private:
+	friend class MediaFrameHub;
+
+	struct Item
+	{
+		DWORD ssrc = 0;
+		std::shared_ptr<const MediaFrame> frame;
+	};
+
+	friend class SPSCAsyncQueue<Item>;
+
+	MediaFrameMirror(const std::shared_ptr<MediaFrameHub>& hub, TimeService& timeService, size_t capacity) :
+		hub(hub),
+		queue(timeService, capacity, MaxDrainBatch)
+	{
+		queue.SetBacklog(hub->GetTimeService(), MaxBacklog);
+	}
+
+	static bool IsVideo(const Item& item)	{ return item.frame->GetType()==MediaFrame::Video; }
+
+	/*
+	 * Push
+	 *  Called on the origin loop only, so there is a single producer
+	 */
+	void Push(DWORD ssrc, const std::shared_ptr<const MediaFrame>& frame)
+	{
+		Item item = { ssrc, frame };
+		bool video = IsVideo(item);
+		bool intra = video && static_cast<const VideoFrame&>(*frame).IsIntra();
+
+		//Can't be decoded after a lost frame
+		if (video && !intra && waitingIntra)
+		{
+			queue.CountDropped();
+			return;
+		}
+
+		//Video frames waiting are not needed to decode a key frame, make room for it
+		if (intra && queue.IsBacklogFull())
+			queue.DropBacklog(IsVideo);
+
+		if (queue.Push(std::move(item), weak_from_this()))
+		{
+			if (intra)
+				waitingIntra = false;
+		} else if (video) {
+			waitingIntra = true;
+		}
+	}
+
+	/*
+	 * Drain
+	 *  Called on the mirror loop only, so there is a single consumer
+	 */
+	void Drain()
+	{
+		ScopedLock lock(mutex);
+		queue.Drain(weak_from_this(), [this](Item& item) {
+			for (const auto& listener : listeners)
+				listener->onMediaFrame(item.ssrc, *item.frame);
+		});
+	}
+
+private:
+	Mutex mutex;
+	std::shared_ptr<MediaFrameHub> hub;
+	std::set<MediaFrame::Listener::shared> listeners;
+	SPSCAsyncQueue<Item> queue;
+	//Only used on the origin loop
+	bool waitingIntra = false;
+};
+
+void MediaFrameHub::onMediaFrame(DWORD ssrc, const MediaFrame& frame)
+{
+	ScopedLock lock(mutex);
+	if (mirrors.empty())
+		return;
+	frames++;
+	//Clone once, shared by all mirrors
+	std::shared_ptr<const MediaFrame> shared(frame.Clone());
+	for (auto mirror : mirrors)
+		mirror->Push(ssrc, shared);
+}
+
+/*
+ * MediaFrameMirrorTester
+ *  Produces numbered video frames on the origin loop and listens to them on the mirror loop, so the
+ *  drop policy can be tested by blocking the mirror loop
+ */
+class MediaFrameMirrorTester :
+	public MediaFrame::Producer,
+	public MediaFrame::Listener,
+	public std::enable_shared_from_this<MediaFrameMirrorTester>
+{
+public:
+	static std::shared_ptr<MediaFrameMirrorTester> Create(TimeService& origin, TimeService& timeService, size_t capacity)
+	{
+		auto tester = std::shared_ptr<MediaFrameMirrorTester>(new MediaFrameMirrorTester(origin, timeService));
+		tester->hub = MediaFrameHub::Create(tester, origin);
+		tester->mirror = MediaFrameMirror::Create(tester->hub, timeService, capacity);
+		tester->mirror->AddMediaListener(tester);
+		return tester;
+	}
+
+	virtual void AddMediaListener(const MediaFrame::Listener::shared& listener) override
+	{
+		ScopedLock lock(mutex);
+		listeners.insert(listener);
+	}
+
+	virtual void RemoveMediaListener(const MediaFrame::Listener::shared& listener) override
+	{
+		ScopedLock lock(mutex);
+		listeners.erase(listener);
+	}
+
+	virtual void onMediaFrame(const MediaFrame& frame) override
+	{
+		onMediaFrame(0, frame);
+	}
+
+	virtual void onMediaFrame(DWORD ssrc, const MediaFrame& frame) override
+	{
+		uint64_t num = frame.GetTimestamp();
+		bool intra = static_cast<const VideoFrame&>(frame).IsIntra();
+		//A delta frame is only decodable right after the previous one
+		if (!intra && (!received || num != last + 1))
+			undecodable++;
+		if (intra)
+			intras++;
+		received++;
+		last = num;
+	}
+
+	void Block(DWORD ms)
+	{
+		timeService.Async([ms](std::chrono::milliseconds) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+		});
+	}
+
+	/*
+	 * Push
+	 *  Produce num frames on the origin loop, with a key frame every interval frames
+	 */
+	void Push(DWORD num, DWORD interval)
+	{
+		origin.Async([weak = weak_from_this(), num, interval](std::chrono::milliseconds) {
+			auto tester = weak.lock();
+			if (!tester)
+				return;
+			for (DWORD i = 0; i < num; ++i)
+			{
+				VideoFrame frame(VideoCodec::VP8, 0);
+				frame.SetIntra(interval && tester->next % interval == 0);
+				frame.SetTimestamp(tester->next++);
+				ScopedLock lock(tester->mutex);
+				for (const auto& listener : tester->listeners)
+					listener->onMediaFrame(0, frame);
+			}
+		});
+	}
+
+	void Stop()
+	{
+		if (mirror)
+			mirror->Stop();
+	}
+
+	MediaFrameMirrorStats GetStats() const	{ return mirror->GetStats();	}
+	uint64_t GetReceived() const		{ return received;		}
+	uint64_t GetIntras() const		{ return intras;		}
+	uint64_t GetUndecodable() const		{ return undecodable;		}
+	uint64_t GetLast() const		{ return last;			}
+
+private:
+	MediaFrameMirrorTester(TimeService& origin, TimeService& timeService) :
+		origin(origin),
+		timeService(timeService)
+	{
+	}
+
+private:
+	Mutex mutex;
+	TimeService& origin;
+	TimeService& timeService;
+	std::set<MediaFrame::Listener::shared> listeners;
+	std::shared_ptr<MediaFrameHub> hub;
+	std::shared_ptr<MediaFrameMirror> mirror;
+	//Only used on the origin loop
+	uint64_t next = 0;
+	//Only written on the mirror loop
+	std::atomic<uint64_t> received = 0;
+	std::atomic<uint64_t> intras = 0;
+	std::atomic<uint64_t> undecodable = 0;
+	std::atomic<uint64_t> last = 0;
+};
+%}
+
+%nodefaultctor MediaFrameMirrorStats;
+struct MediaFrameMirrorStats
+{
+	uint32_t capacity;
+	uint32_t depth;
+	uint32_t maxDepth;
+	uint32_t backlog;
+	uint64_t pushed;
+	uint64_t delivered;
+	uint64_t deferred;
+	uint64_t dropped;
+	uint64_t wakeups;
+};
+
+%nodefaultctor MediaFrameHub;
+class MediaFrameHub
+{
+public:
+	size_t GetMirrors();
+	uint64_t GetFrames() const;
+};
+
+SHARED_PTR_BEGIN(MediaFrameHub)
+{
+	MediaFrameHubShared(const MediaFrameProducerShared& producer, TimeService& timeService)
+	{
+		return new std::shared_ptr<MediaFrameHub>(MediaFrameHub::Create(producer, timeService));
+	}
+}
+SHARED_PTR_END(MediaFrameHub)
+
+%nodefaultctor MediaFrameMirror;
+class MediaFrameMirror :
+	public MediaFrameProducer
+{
+public:
+	void Stop();
+	MediaFrameMirrorStats GetStats() const;
+};
+
+SHARED_PTR_BEGIN(MediaFrameMirror)
+{
+	MediaFrameMirrorShared(const MediaFrameHubShared& hub, TimeService& timeService, size_t capacity)
+	{
+		return new std::shared_ptr<MediaFrameMirror>(MediaFrameMirror::Create(hub, timeService, capacity));
+	}
+	SHARED_PTR_TO(MediaFrameProducer)
+}
+SHARED_PTR_END(MediaFrameMirror)
+
+%nodefaultctor MediaFrameMirrorTester;
+class MediaFrameMirrorTester
+{
+public:
+	void Block(DWORD ms);
+	void Push(DWORD num, DWORD interval);
+	void Stop();
+	MediaFrameMirrorStats GetStats() const;
+	uint64_t GetReceived() const;
+	uint64_t GetIntras() const;
+	uint64_t GetUndecodable() const;
+	uint64_t GetLast() const;
+};
+
+SHARED_PTR_BEGIN(MediaFrameMirrorTester)
+{
+	MediaFrameMirrorTesterShared(TimeService& origin, TimeService& timeService, size_t capacity)
+	{
+		return new std::shared_ptr<MediaFrameMirrorTester>(MediaFrameMirrorTester::Create(origin, timeService, capacity));
+	}
+}
+SHARED_PTR_END(MediaFrameMirrorTester)
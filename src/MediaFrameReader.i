@@ -61,8 +61,13 @@ public:
 
 		//UltraDebug("-onMediaFrame() [type:%s,codec:%s,minPeriod:%d,lastFrame:%d]\n",type,codec,minPeriod,lastFrame);
 
+		PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
+		TRACE_EVENT("node.reader", "MediaFrameReader::onMediaFrame", "ssrc", ssrc, "codec", codec, "size", buffer->GetSize());
+
 		//Run function on main node thread
 		MediaServer::Async([=,cloned=persistent](){
+			PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
+			TRACE_EVENT("node.reader", "MediaFrameReader::onframe", "codec", codec, "delay", getTimeMS() - now);
 			Nan::HandleScope scope;
 			int i = 0;
 			v8::Local<v8::Value> argv[3];
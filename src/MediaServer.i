@@ -67,9 +67,25 @@ public:
 	 */
 	static void Async(std::function<void()> func) 
 	{
+		PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
 		//Check if not terminatd
 		if (uv_is_active((uv_handle_t *)&async))
 		{
+			//One more pending
+			size_t depth = ++pending;
+			//If tracing, link the producer thread with the execution on the js thread
+			if (TRACE_EVENT_CATEGORY_ENABLED("node.async"))
+			{
+				uint64_t flow = ++flows;
+				TRACE_EVENT("node.async", "MediaServer::Async::Enqueue", perfetto::Flow::ProcessScoped(flow));
+				TRACE_COUNTER("node.async", "MediaServer::Async::Depth", depth);
+				//Wrap it so the execution is also traced
+				func = [flow, func = std::move(func)]() {
+					PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
+					TRACE_EVENT("node.async", "MediaServer::Async::Run", perfetto::TerminatingFlow::ProcessScoped(flow));
+					func();
+				};
+			}
 			//Enqueue
 			queue.enqueue(std::move(func));
 			//Signal main thread
@@ -102,6 +118,7 @@ public:
 		std::function<void()> func;
 		//Dequeue all pending functions
 		while(queue.try_dequeue(func)){}
+		pending = 0;
 	}
 	
 	static void EnableWarning(bool flag)
@@ -150,13 +167,18 @@ public:
 
 	static void async_cb_handler(uv_async_t *handle)
 	{
+		PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
+		TRACE_EVENT("node.async", "MediaServer::Async::Dequeue");
 		std::function<void()> func;
 		//Get all pending functions
 		while(queue.try_dequeue(func))
 		{
+			//One less
+			--pending;
 			//Execute async function
 			func();
 		}
+		TRACE_COUNTER("node.async", "MediaServer::Async::Depth", pending.load());
 	}
 
 	static bool SetAffinity(int cpu)
@@ -172,11 +194,15 @@ private:
 	//http://stackoverflow.com/questions/31207454/v8-multithreaded-function
 	static uv_async_t  async;
 	static moodycamel::ConcurrentQueue<std::function<void()>> queue;
+	static std::atomic<size_t> pending;
+	static std::atomic<uint64_t> flows;
 };
 
 //Static initializaion
 uv_async_t MediaServer::async;
 moodycamel::ConcurrentQueue<std::function<void()>>  MediaServer::queue;
+std::atomic<size_t> MediaServer::pending;
+std::atomic<uint64_t> MediaServer::flows;
 
 //Empty implementation of event source
 EvenSource::EvenSource()
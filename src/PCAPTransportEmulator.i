@@ -1,21 +1,417 @@
 
 %include "UDPReader.h"
+%include "MMapPCAPReader.i"
+%include "VirtualTimeService.i"
+%include "RTPReceiver.i"
+%include "RTPIncomingSourceGroup.i"
+%include "PacketPool.i"
+
+%{
+/*
+ * PCAPVirtualTransportEmulator
+ *  Replays a capture on its own thread driving a virtual clock, which only moves to the capture time of
+ *  the next packet, so timers fire in deadline order at capture time and replays go as fast as the cpu
+ *  allows. Only RTP is replayed: RTCP on the capture is ignored, so there are no sender reports to map
+ *  RTP timestamps to NTP time nor remote RTT, and as there is no peer no feedback is sent either (PLI
+ *  requests are ignored and no NACKs are generated). RTX packets are unwrapped to the original packet using the apt of their
+ *  payload type and delivered as if they were received on the media ssrc, padding only ones are dropped.
+ */
+class PCAPVirtualTransportEmulator :
+	public RTPReceiver
+{
+public:
+	PCAPVirtualTransportEmulator(v8::Local<v8::Object> object)
+	{
+		persistent = std::make_shared<Persistent<v8::Object>>(object);
+		//Start replay thread, it will wait until played
+		running = true;
+		thread = std::thread([this]() { Run(); });
+	}
+
+	virtual ~PCAPVirtualTransportEmulator()
+	{
+		Close();
+		//Stop thread
+		running = false;
+		loop.Signal();
+		if (thread.joinable())
+			thread.join();
+	}
+
+	virtual int SendPLI(DWORD ssrc) override	{ return 1; }
+	virtual int Reset(DWORD ssrc) override		{ return 1; }
+
+	void SetRemoteProperties(const Properties& properties)
+	{
+		loop.Future([&](std::chrono::milliseconds) {
+			//Clear maps
+			rtpMap = {};
+			aptMap = {};
+			extMap = {};
+			//For each media
+			for (const auto& [mediaType, media] : std::vector<std::pair<MediaFrame::Type, std::string>>{{MediaFrame::Audio, "audio"}, {MediaFrame::Video, "video"}})
+			{
+				std::vector<Properties> codecs;
+				std::vector<Properties> extensions;
+				//Get codecs and extensions
+				properties.GetChildrenArray(media + ".codecs", codecs);
+				properties.GetChildrenArray(media + ".ext", extensions);
+				//For each codec
+				for (const auto& codec : codecs)
+				{
+					BYTE type = codec.GetProperty("pt", 0);
+					BYTE rtx  = codec.GetProperty("rtx", 0);
+					//Set codec
+					rtpMap.SetCodecForType(type, mediaType==MediaFrame::Audio
+						? (BYTE)AudioCodec::GetCodecForName(codec.GetProperty("codec"))
+						: (BYTE)VideoCodec::GetCodecForName(codec.GetProperty("codec")));
+					//If it has rtx
+					if (rtx)
+					{
+						rtpMap.SetCodecForType(rtx, VideoCodec::RTX);
+						aptMap.SetCodecForType(rtx, type);
+					}
+				}
+				//For each extension
+				for (const auto& extension : extensions)
+					extMap.SetCodecForType(extension.GetProperty("id", 0), RTPHeaderExtension::GetExtensionForName(extension.GetProperty("uri")));
+			}
+		}).wait();
+	}
+
+	bool AddIncomingSourceGroup(const RTPIncomingSourceGroupShared& group)
+	{
+		if (!group)
+			return false;
+		loop.Future([&](std::chrono::milliseconds) {
+			//Add media and rtx ssrcs
+			if (group->media.ssrc)
+				groups[group->media.ssrc] = group;
+			if (group->rtx.ssrc)
+				groups[group->rtx.ssrc] = group;
+		}).wait();
+		return true;
+	}
+
+	bool RemoveIncomingSourceGroup(const RTPIncomingSourceGroupShared& group)
+	{
+		if (!group)
+			return false;
+		loop.Future([&](std::chrono::milliseconds) {
+			groups.erase(group->media.ssrc);
+			groups.erase(group->rtx.ssrc);
+		}).wait();
+		return true;
+	}
+
+	bool Open(const char* filename)
+	{
+		auto pcap = std::make_unique<MMapPCAPReader>();
+		//Open file
+		if (!pcap->Open(filename))
+			return Error("-PCAPVirtualTransportEmulator::Open() could not open file [filename:%s]\n", filename);
+		//Set it
+		return SetReader(pcap.release());
+	}
+
+	bool SetReader(UDPReader* reader)
+	{
+		loop.Future([&](std::chrono::milliseconds) {
+			//Take ownership
+			this->reader.reset(reader);
+			//Start from the current virtual time
+			first = 0;
+		}).wait();
+		return true;
+	}
+
+	bool Play()
+	{
+		//Replay until the end of the capture
+		playing = true;
+		loop.Signal();
+		return true;
+	}
+
+	uint64_t Seek(uint64_t time)
+	{
+		uint64_t ts = 0;
+		loop.Future([&](std::chrono::milliseconds) {
+			if (!reader)
+				return;
+			//Seek reader
+			ts = reader->Seek(time);
+			//Restart time base so clock keeps going forward
+			first = 0;
+		}).wait();
+		return ts;
+	}
+
+	bool Stop()
+	{
+		playing = false;
+		loop.Signal();
+		return true;
+	}
+
+	bool Close()
+	{
+		Stop();
+		loop.Future([&](std::chrono::milliseconds) {
+			//Close reader
+			if (reader)
+				reader->Close();
+			reader.reset();
+			groups.clear();
+		}).wait();
+		return true;
+	}
+
+	bool SetAffinity(int cpu)
+	{
+		return EventLoop::SetAffinity(thread.native_handle(), cpu);
+	}
+
+	bool SetThreadName(const std::string& name)
+	{
+		return EventLoop::SetThreadName(thread.native_handle(), name);
+	}
+
+	uint64_t GetReplayedPackets() const	{ return replayed;	}
+	uint64_t GetVirtualTime() const		{ return loop.GetNow().count();	}
+
+	TimeService& GetTimeService()		{ return loop;		}
+
+	/*
+	 * SetPacketPoolSize
+	 *  Preallocate packets for replay, growing up to maxSize packets (0 for unbounded). Packets still in
+	 *  use are returned to the previous pool.
+	 */
+	void SetPacketPoolSize(size_t size, size_t maxSize)
+	{
+		//Stats may be read concurrently
+		std::atomic_store(&packetPool, PacketPool::Create(PacketPool::RTPPacketBlockSize, size, maxSize));
+	}
+
+	PacketPoolStats GetPacketPoolStats() const
+	{
+		return std::atomic_load(&packetPool)->GetStats();
+	}
+
+private:
+	void Run()
+	{
+		Log(">PCAPVirtualTransportEmulator::Run()\n");
+		//All timers and tasks run here
+		loop.SetOwner(std::this_thread::get_id());
+
+		while (running)
+		{
+			//Run any queued task
+			loop.RunPending();
+			//If not playing
+			if (!playing || !reader)
+			{
+				//Wait for tasks or commands
+				loop.Wait();
+				continue;
+			}
+
+			//Get next packet
+			uint64_t ts = reader->Next();
+			//If finished
+			if (!ts)
+			{
+				//Fire remaining timers due at the last packet time
+				loop.AdvanceTo(loop.GetNow());
+				//Done
+				playing = false;
+				//Notify
+				MediaServer::Async([cloned = persistent, replayed = replayed.load(), now = loop.GetNow().count()]() {
+					Nan::HandleScope scope;
+					int i = 0;
+					v8::Local<v8::Value> argv[2];
+					//Create local args
+					argv[i++] = Nan::New<v8::Number>(replayed);
+					argv[i++] = Nan::New<v8::Number>(now);
+					//Call object method with arguments
+					MakeCallback(cloned, "onended", i, argv);
+				});
+				continue;
+			}
+
+			//Set time base on first packet after open/seek
+			if (!first)
+			{
+				first = ts;
+				base = loop.GetNow();
+			}
+
+			//Calculate virtual packet time
+			auto now = base + std::chrono::milliseconds((ts - first) / 1000);
+			//Move clock, firing all timers in between
+			loop.AdvanceTo(now);
+			//Process it
+			OnPacket(reader->GetUDPData(), reader->GetUDPSize(), now);
+		}
+
+		Log("<PCAPVirtualTransportEmulator::Run()\n");
+	}
+
+	void OnPacket(const BYTE* data, DWORD size, std::chrono::milliseconds now)
+	{
+		//Ignore rtcp and non rtp traffic
+		if (size < 12 || (data[0] & 0xC0) != 0x80 || (data[1] >= 192 && data[1] <= 223))
+			return;
+
+		RTPHeader header;
+		RTPHeaderExtension extension;
+
+		//Parse header
+		DWORD ini = header.Parse(data, size);
+		if (!ini)
+			return;
+
+		//Find group
+		auto it = groups.find(header.ssrc);
+		if (it == groups.end())
+			//Unknown ssrc
+			return;
+		auto& group = it->second;
+
+		//Parse extensions
+		if (header.extension)
+		{
+			DWORD len = extension.Parse(extMap, data + ini, size - ini);
+			if (!len)
+				return;
+			ini += len;
+		}
+
+		//Remove padding
+		if (header.padding && size > ini)
+		{
+			BYTE padding = data[size - 1];
+			if (ini + padding > size)
+				return;
+			size -= padding;
+		}
+
+		//Get codec
+		BYTE codec = rtpMap.GetCodecForType(header.payloadType);
+
+		//If it is rtx
+		if (header.ssrc == group->rtx.ssrc && header.ssrc != group->media.ssrc)
+		{
+			//Ignore padding only packets
+			if (size < ini + 2)
+				return;
+			//Recover original packet
+			header.sequenceNumber	= get2(data, ini);
+			header.ssrc		= group->media.ssrc;
+			header.payloadType	= aptMap.GetCodecForType(header.payloadType);
+			codec			= rtpMap.GetCodecForType(header.payloadType);
+			ini += 2;
+		}
+
+		//Unknown codec
+		if (codec == RTPMap::NotFound)
+			return;
+
+		//Create packet
+		auto packet = std::atomic_load(&packetPool)->MakeShared<RTPPacket>(group->type, codec, header, extension);
+		//Set payload
+		packet->SetPayload(data + ini, size - ini);
+		//Deliver it
+		group->AddPacket(packet, size, now.count());
+		//One more
+		replayed++;
+	}
+
+private:
+	std::shared_ptr<Persistent<v8::Object>> persistent;
+	VirtualTimeService loop;
+	std::thread thread;
+	std::atomic<bool> running = false;
+	std::atomic<bool> playing = false;
+	std::atomic<uint64_t> replayed = 0;
+	std::unique_ptr<UDPReader> reader;
+	uint64_t first = 0;
+	std::chrono::milliseconds base = std::chrono::milliseconds(0);
+	RTPMap rtpMap;
+	RTPMap aptMap;
+	RTPMap extMap;
+	std::map<DWORD, RTPIncomingSourceGroupShared> groups;
+	std::shared_ptr<PacketPool> packetPool = PacketPool::Create(PacketPool::RTPPacketBlockSize, 0, 0);
+};
+%}
+
 class PCAPTransportEmulator
 {
 public:
 	PCAPTransportEmulator();
-	
+
 	void SetRemoteProperties(const Properties& properties);
 
 	bool AddIncomingSourceGroup(RTPIncomingSourceGroup *group);
 	bool RemoveIncomingSourceGroup(RTPIncomingSourceGroup *group);
-	
+
 	bool Open(const char* filename);
 	bool SetReader(UDPReader* reader);
 	bool Play();
 	uint64_t Seek(uint64_t time);
 	bool Stop();
 	bool Close();
-	
+
 	TimeService& GetTimeService();
+
+%extend {
+	bool OpenMapped(const char* filename)
+	{
+		auto pcap = std::make_unique<MMapPCAPReader>();
+		//Open file
+		if (!pcap->Open(filename))
+			return false;
+		//Emulator takes ownership of the reader
+		return self->SetReader(pcap.release());
+	}
+}
 };
+
+class PCAPVirtualTransportEmulator
+{
+public:
+	PCAPVirtualTransportEmulator(v8::Local<v8::Object> object);
+
+	void SetRemoteProperties(const Properties& properties);
+
+	bool AddIncomingSourceGroup(const RTPIncomingSourceGroupShared& group);
+	bool RemoveIncomingSourceGroup(const RTPIncomingSourceGroupShared& group);
+
+	bool Open(const char* filename);
+	bool SetReader(UDPReader* reader);
+	bool Play();
+	uint64_t Seek(uint64_t time);
+	bool Stop();
+	bool Close();
+
+	bool SetAffinity(int cpu);
+	bool SetThreadName(const std::string& name);
+	uint64_t GetReplayedPackets() const;
+	uint64_t GetVirtualTime() const;
+
+	void SetPacketPoolSize(size_t size, size_t maxSize);
+	PacketPoolStats GetPacketPoolStats() const;
+
+	TimeService& GetTimeService();
+};
+
+SHARED_PTR_BEGIN(PCAPVirtualTransportEmulator)
+{
+	PCAPVirtualTransportEmulatorShared(v8::Local<v8::Object> object)
+	{
+		return new std::shared_ptr<PCAPVirtualTransportEmulator>(new PCAPVirtualTransportEmulator(object));
+	}
+	SHARED_PTR_TO(RTPReceiver)
+}
+SHARED_PTR_END(PCAPVirtualTransportEmulator)
@@ -0,0 +1,352 @@
+%include "shared_ptr.i"
+
+%{
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct PacketPoolStats
+{
+	size_t capacity		= 0;
+	size_t maxSize		= 0;
+	size_t outstanding	= 0;
+	size_t highWaterMark	= 0;
+	uint64_t hits		= 0;
+	uint64_t misses		= 0;
+	uint64_t grows		= 0;
+	uint64_t overflows	= 0;
+};
+
+/*
+ * PacketPool
+ *  Fixed size memory blocks for packets created on the binding receive paths, so they are not malloc'ed
+ *  for each packet. Blocks are picked and released on per-thread free lists, as packets are usually
+ *  created on the reading thread and released on another one, and only the spare blocks are moved
+ *  from and to the shared free list under lock. The pool grows on demand up to the max size, after
+ *  which blocks are allocated from the heap and counted as overflows.
+ *  Use MakeShared() to create objects on the pool, the pool is kept alive until all of them are released.
+ */
+class PacketPool :
+	public std::enable_shared_from_this<PacketPool>
+{
+public:
+	//Blocks kept on each thread free list before returning them to the shared one
+	static constexpr size_t CacheSize = 64;
+	//Minimum number of blocks allocated when growing
+	static constexpr size_t MinGrow = 64;
+	//Block size for rtp packets, including the shared_ptr control block
+	static constexpr size_t RTPPacketBlockSize = sizeof(RTPPacket) + 64;
+
+	template<typename T>
+	struct Allocator
+	{
+		using value_type = T;
+
+		Allocator(const std::shared_ptr<PacketPool>& pool) : pool(pool) {}
+		template<typename U>
+		Allocator(const Allocator<U>& other) : pool(other.pool) {}
+
+		T* allocate(size_t n)
+		{
+			//Only single objects fitting on a block are pooled
+			if (n * sizeof(T) <= pool->GetBlockSize())
+				return static_cast<T*>(pool->Pick());
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		}
+
+		void deallocate(T* ptr, size_t n)
+		{
+			if (n * sizeof(T) <= pool->GetBlockSize())
+				pool->Release(ptr);
+			else
+				::operator delete(ptr);
+		}
+
+		template<typename U>
+		bool operator==(const Allocator<U>& other) const { return pool == other.pool; }
+		template<typename U>
+		bool operator!=(const Allocator<U>& other) const { return pool != other.pool; }
+
+		std::shared_ptr<PacketPool> pool;
+	};
+
+public:
+	/*
+	 * Create
+	 *  blockSize is the size of each object including the shared_ptr control block, size the number of
+	 *  blocks allocated upfront and maxSize the maximum number of blocks (0 for unbounded)
+	 */
+	static std::shared_ptr<PacketPool> Create(size_t blockSize, size_t size, size_t maxSize)
+	{
+		return std::shared_ptr<PacketPool>(new PacketPool(blockSize, size, maxSize));
+	}
+
+	template<typename T, typename... Args>
+	std::shared_ptr<T> MakeShared(Args&&... args)
+	{
+		return std::allocate_shared<T>(Allocator<T>(shared_from_this()), std::forward<Args>(args)...);
+	}
+
+	void* Pick()
+	{
+		auto& cache = GetCache();
+		Header* header = nullptr;
+
+		//Try the thread free list first
+		if (!cache.blocks.empty())
+		{
+			header = cache.blocks.back();
+			cache.blocks.pop_back();
+			hits++;
+		} else {
+			std::lock_guard<std::mutex> lock(mutex);
+			//Grow if there are no spare blocks
+			if (free.empty() && !Grow())
+			{
+				//Limit reached, allocate from heap
+				header = new (::operator new(sizeof(Header) + blockSize)) Header{nullptr};
+				overflows++;
+			} else {
+				//Refill the thread free list with half of it, so it does not bounce between lists
+				size_t num = std::min(free.size(), CacheSize / 2);
+				cache.blocks.insert(cache.blocks.end(), free.end() - num, free.end());
+				free.resize(free.size() - num);
+				header = cache.blocks.back();
+				cache.blocks.pop_back();
+				misses++;
+			}
+		}
+
+		//Update usage
+		size_t current = ++outstanding;
+		size_t max = highWaterMark.load(std::memory_order_relaxed);
+		while (current > max && !highWaterMark.compare_exchange_weak(max, current, std::memory_order_relaxed));
+
+		return header + 1;
+	}
+
+	void Release(void* ptr)
+	{
+		Header* header = static_cast<Header*>(ptr) - 1;
+		outstanding--;
+
+		//If it was allocated from heap
+		if (!header->pool)
+		{
+			header->~Header();
+			::operator delete(header);
+			return;
+		}
+
+		auto& cache = GetCache();
+		cache.blocks.push_back(header);
+		//Return half of the blocks if there are too many
+		if (cache.blocks.size() > CacheSize)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			free.insert(free.end(), cache.blocks.end() - CacheSize / 2, cache.blocks.end());
+			cache.blocks.resize(cache.blocks.size() - CacheSize / 2);
+		}
+	}
+
+	size_t GetBlockSize() const	{ return blockSize; }
+
+	PacketPoolStats GetStats() const
+	{
+		PacketPoolStats stats;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stats.capacity	= capacity;
+		}
+		stats.maxSize		= maxSize;
+		stats.outstanding	= outstanding;
+		stats.highWaterMark	= highWaterMark;
+		stats.hits		= hits;
+		stats.misses		= misses;
+		stats.grows		= grows;
+		stats.overflows		= overflows;
+		return stats;
+	}
+
+private:
+	struct alignas(std::max_align_t) Header
+	{
+		PacketPool* pool;
+	};
+
+	struct Cache
+	{
+		uint64_t id = 0;
+		std::weak_ptr<PacketPool> pool;
+		std::vector<Header*> blocks;
+
+		~Cache()
+		{
+			//Give blocks back if pool is still alive
+			if (auto shared = pool.lock())
+			{
+				std::lock_guard<std::mutex> lock(shared->mutex);
+				shared->free.insert(shared->free.end(), blocks.begin(), blocks.end());
+			}
+		}
+	};
+
+	PacketPool(size_t blockSize, size_t size, size_t maxSize) :
+		blockSize((blockSize + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1)),
+		maxSize(maxSize),
+		id(++ids)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		//Preallocate
+		if (size)
+			Allocate(maxSize ? std::min(size, maxSize) : size);
+	}
+
+	Cache& GetCache()
+	{
+		//Thread free lists of all the pools used by this thread
+		thread_local std::vector<std::unique_ptr<Cache>> caches;
+		//Find ours, pools are few so a linear search is fine
+		for (auto& cache : caches)
+			if (cache->id == id)
+				return *cache;
+		//Drop lists of destroyed pools, its blocks were freed with them
+		caches.erase(std::remove_if(caches.begin(), caches.end(), [](const auto& cache) { return cache->pool.expired(); }), caches.end());
+		//Create new one
+		auto cache = std::make_unique<Cache>();
+		cache->id	= id;
+		cache->pool	= weak_from_this();
+		cache->blocks.reserve(CacheSize + 1);
+		caches.push_back(std::move(cache));
+		return *caches.back();
+	}
+
+	bool Grow()
+	{
+		//Check limit
+		if (maxSize && capacity >= maxSize)
+			return false;
+		//Double size
+		size_t num = std::max(capacity, MinGrow);
+		if (maxSize)
+			num = std::min(num, maxSize - capacity);
+		Allocate(num);
+		grows++;
+		return true;
+	}
+
+	void Allocate(size_t num)
+	{
+		size_t stride = sizeof(Header) + blockSize;
+		chunks.emplace_back(new BYTE[num * stride]);
+		BYTE* chunk = chunks.back().get();
+		free.reserve(capacity + num);
+		for (size_t i = 0; i < num; ++i)
+			free.push_back(new (chunk + i * stride) Header{this});
+		capacity += num;
+	}
+
+private:
+	static inline std::atomic<uint64_t> ids = 0;
+
+	const size_t blockSize;
+	const size_t maxSize;
+	const uint64_t id;
+	mutable std::mutex mutex;
+	std::vector<std::unique_ptr<BYTE[]>> chunks;
+	std::vector<Header*> free;
+	size_t capacity = 0;
+	std::atomic<size_t> outstanding = 0;
+	std::atomic<size_t> highWaterMark = 0;
+	std::atomic<uint64_t> hits = 0;
+	std::atomic<uint64_t> misses = 0;
+	std::atomic<uint64_t> grows = 0;
+	std::atomic<uint64_t> overflows = 0;
+};
+
+/*
+ * PacketPoolTester
+ *  Holds rtp packets created on a pool, so allocation and release can be checked from the tests
+ */
+class PacketPoolTester
+{
+public:
+	PacketPoolTester(const std::shared_ptr<PacketPool>& pool) :
+		pool(pool)
+	{
+	}
+
+	bool Allocate(DWORD num)
+	{
+		if (!pool)
+			return false;
+		for (DWORD i = 0; i < num; ++i)
+			packets.push_back(pool->MakeShared<RTPPacket>(MediaFrame::Video, VideoCodec::VP8));
+		return true;
+	}
+
+	void Release(DWORD num)
+	{
+		packets.resize(packets.size() - std::min<size_t>(num, packets.size()));
+	}
+
+	/*
+	 * ReleaseOnThread
+	 *  Release the packets from another thread, so they are returned through its free list
+	 */
+	void ReleaseOnThread(DWORD num)
+	{
+		std::vector<RTPPacket::shared> released(packets.end() - std::min<size_t>(num, packets.size()), packets.end());
+		Release(num);
+		std::thread([released = std::move(released)]() mutable { released.clear(); }).join();
+	}
+
+	size_t GetAllocated() const	{ return packets.size(); }
+
+private:
+	std::shared_ptr<PacketPool> pool;
+	std::vector<RTPPacket::shared> packets;
+};
+%}
+
+%nodefaultctor PacketPoolStats;
+struct PacketPoolStats
+{
+	size_t capacity;
+	size_t maxSize;
+	size_t outstanding;
+	size_t highWaterMark;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t grows;
+	uint64_t overflows;
+};
+
+%nodefaultctor PacketPool;
+class PacketPool
+{
+public:
+	PacketPoolStats GetStats() const;
+};
+
+SHARED_PTR_BEGIN(PacketPool)
+{
+	PacketPoolShared(size_t size, size_t maxSize)
+	{
+		return new std::shared_ptr<PacketPool>(PacketPool::Create(PacketPool::RTPPacketBlockSize, size, maxSize));
+	}
+}
+SHARED_PTR_END(PacketPool)
+
+class PacketPoolTester
+{
+public:
+	PacketPoolTester(const PacketPoolShared& pool);
+	bool Allocate(DWORD num);
+	void Release(DWORD num);
+	void ReleaseOnThread(DWORD num);
+	size_t GetAllocated() const;
+};
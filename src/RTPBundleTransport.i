@@ -1,7 +1,199 @@
 %include "shared_ptr.i"
+%include "RawTxRing.i"
+%include "PacketPool.i"
 
 %{
+#include <arpa/inet.h>
+
 using RTPBundleTransportConnection = RTPBundleTransport::Connection; 
+
+struct RTPBundleTransportRawTxStats
+{
+	bool enabled		= false;
+	RawTxRingStats ring;
+};
+
+struct RTPBundleTransportCandidateRawTxStats
+{
+	bool raw		= false;
+	uint64_t rawPackets	= 0;
+	uint64_t udpPackets	= 0;
+	uint64_t dropped	= 0;
+};
+
+/*
+ * RTPBundleTransportFacade
+ *  Bundle transport that, when raw tx is enabled, sends through a PACKET_TX_RING owned by the bindings instead
+ *  of the native raw sender, so the path taken by the packets of each remote candidate can be counted.
+ *  All the packets of a candidate take the same path: if the ring is still full after flushing it the packet
+ *  is dropped instead of sending it through the udp socket out of order with the rest of the batch.
+ *  It also owns the pool of the packets created by the bindings for the transports of the bundle.
+ */
+class RTPBundleTransportFacade :
+	public RTPBundleTransport
+{
+public:
+	//Number of frames of the raw tx ring
+	static constexpr size_t RawTxFrames = 256;
+
+public:
+	RTPBundleTransportFacade(uint32_t packetPoolSize, uint32_t maxPacketPoolSize) :
+		RTPBundleTransport(packetPoolSize),
+		packetPool(PacketPool::Create(PacketPool::RTPPacketBlockSize, packetPoolSize, maxPacketPoolSize))
+	{
+	}
+
+	std::shared_ptr<PacketPool> GetPacketPool() const	{ return packetPool;			}
+	PacketPoolStats GetPacketPoolStats() const		{ return packetPool->GetStats();	}
+
+	/*
+	 * SetRawTx
+	 *  Create the ring on the interface, candidates are sent through the default route until their own
+	 *  data is set. Throws std::system_error if the ring can not be created.
+	 */
+	void SetRawTx(int32_t ifindex, unsigned int sndbuf, bool skipQdisc, const std::string& selfLladdr, uint32_t defaultSelfAddr, const std::string& defaultDstLladdr, uint16_t port)
+	{
+		//Create ring first, it may throw
+		auto ring = std::make_unique<RawTxRing>(ifindex, sndbuf, skipQdisc, RawTxFrames);
+
+		ScopedLock lock(mutex);
+		//Replace previous one, it is flushed on destruction
+		rawTx = std::move(ring);
+		this->selfLladdr	= selfLladdr;
+		this->defaultSelfAddr	= defaultSelfAddr;
+		this->defaultDstLladdr	= defaultDstLladdr;
+		this->port		= port;
+		//Update routes of known candidates
+		for (auto& [key, flow] : flows)
+			SetFlowRoute(key, flow);
+	}
+
+	void ClearRawTx()
+	{
+		ScopedLock lock(mutex);
+		rawTx.reset();
+		for (auto& [key, flow] : flows)
+			flow.routed = false;
+	}
+
+	void SetCandidateRawTxData(const std::string& ip, uint16_t port, uint32_t selfAddr, const std::string& dstLladdr)
+	{
+		ScopedLock lock(mutex);
+		auto key = std::make_pair(ip, port);
+		auto& flow = flows[key];
+		flow.data	= true;
+		flow.selfAddr	= selfAddr;
+		flow.dstLladdr	= dstLladdr;
+		SetFlowRoute(key, flow);
+	}
+
+	void ClearCandidateRawTxData(const std::string& ip, uint16_t port)
+	{
+		ScopedLock lock(mutex);
+		flows.erase(std::make_pair(ip, port));
+	}
+
+	RTPBundleTransportRawTxStats GetRawTxStats()
+	{
+		ScopedLock lock(mutex);
+		RTPBundleTransportRawTxStats stats;
+		stats.enabled = !!rawTx;
+		if (rawTx)
+			stats.ring = rawTx->GetStats();
+		return stats;
+	}
+
+	RTPBundleTransportCandidateRawTxStats GetCandidateRawTxStats(const std::string& ip, uint16_t port)
+	{
+		ScopedLock lock(mutex);
+		auto it = flows.find(std::make_pair(ip, port));
+		if (it == flows.end())
+			return {};
+		auto stats = it->second.stats;
+		stats.raw = it->second.routed;
+		return stats;
+	}
+
+	virtual void Send(const ICERemoteCandidate* candidate, Packet&& buffer) override
+	{
+		ScopedLock lock(mutex);
+		auto key = std::make_pair(std::string(candidate->GetIP()), candidate->GetPort());
+		auto it = flows.find(key);
+		//New candidate, use default route
+		if (it == flows.end())
+		{
+			it = flows.emplace(key, Flow()).first;
+			SetFlowRoute(key, it->second);
+		}
+		auto& flow = it->second;
+
+		//If not sending raw
+		if (!flow.routed)
+		{
+			flow.stats.udpPackets++;
+			return RTPBundleTransport::Send(candidate, std::move(buffer));
+		}
+
+		//Queue it on the ring, flushing it if full so the kernel releases the sent frames
+		if (!rawTx->Queue(flow.route, buffer.GetData(), buffer.GetSize())
+			&& (!rawTx->Flush() || !rawTx->Queue(flow.route, buffer.GetData(), buffer.GetSize())))
+		{
+			flow.stats.dropped++;
+			return;
+		}
+		flow.stats.rawPackets++;
+
+		//Flush once for all the packets sent on this loop iteration
+		if (!flushScheduled)
+		{
+			flushScheduled = true;
+			GetTimeService().Async([this](std::chrono::milliseconds) {
+				ScopedLock lock(mutex);
+				flushScheduled = false;
+				if (rawTx)
+					rawTx->Flush();
+			});
+		}
+	}
+
+private:
+	struct Flow
+	{
+		//Raw tx data of the candidate
+		bool data = false;
+		uint32_t selfAddr = 0;
+		std::string dstLladdr;
+		//Current route on the ring
+		bool routed = false;
+		RawTxRing::Route route;
+		RTPBundleTransportCandidateRawTxStats stats;
+	};
+	using FlowKey = std::pair<std::string, uint16_t>;
+
+	void SetFlowRoute(const FlowKey& key, Flow& flow)
+	{
+		flow.routed = false;
+		//Only ipv4 candidates can be sent through the ring
+		in_addr addr;
+		if (!rawTx || inet_pton(AF_INET, key.first.c_str(), &addr) != 1)
+			return;
+		flow.routed = RawTxRing::SetRoute(flow.route, selfLladdr,
+			flow.data ? flow.selfAddr : defaultSelfAddr,
+			flow.data ? flow.dstLladdr : defaultDstLladdr,
+			port, ntohl(addr.s_addr), key.second);
+	}
+
+private:
+	Mutex mutex;
+	std::unique_ptr<RawTxRing> rawTx;
+	std::string selfLladdr;
+	uint32_t defaultSelfAddr = 0;
+	std::string defaultDstLladdr;
+	uint16_t port = 0;
+	std::map<FlowKey, Flow> flows;
+	bool flushScheduled = false;
+	std::shared_ptr<PacketPool> packetPool;
+};
 %}
 
 %nodefaultctor RTPBundleTransportConnection;
@@ -47,4 +239,42 @@ public:
 	bool SetPriority(int priority);
 	void SetIceTimeout(uint32_t timeout);
 	TimeService& GetTimeService();
+};
+
+%nodefaultctor RTPBundleTransportRawTxStats;
+struct RTPBundleTransportRawTxStats
+{
+	bool enabled;
+	RawTxRingStats ring;
+};
+
+%nodefaultctor RTPBundleTransportCandidateRawTxStats;
+struct RTPBundleTransportCandidateRawTxStats
+{
+	bool raw;
+	uint64_t rawPackets;
+	uint64_t udpPackets;
+	uint64_t dropped;
+};
+
+class RTPBundleTransportFacade :
+	public RTPBundleTransport
+{
+public:
+	RTPBundleTransportFacade(uint32_t packetPoolSize, uint32_t maxPacketPoolSize);
+	PacketPoolShared GetPacketPool() const;
+	PacketPoolStats GetPacketPoolStats() const;
+	%exception SetRawTx {
+		try {
+			$action
+		} catch (std::system_error& exc) {
+			SWIG_exception(SWIG_SystemError, exc.what());
+		}
+	}
+	void SetRawTx(int32_t ifindex, unsigned int sndbuf, bool skipQdisc, const std::string& selfLladdr, uint32_t defaultSelfAddr, const std::string& defaultDstLladdr, uint16_t port);
+	void ClearRawTx();
+	void SetCandidateRawTxData(const std::string& ip, uint16_t port, uint32_t selfAddr, const std::string& dstLladdr);
+	void ClearCandidateRawTxData(const std::string& ip, uint16_t port);
+	RTPBundleTransportRawTxStats GetRawTxStats();
+	RTPBundleTransportCandidateRawTxStats GetCandidateRawTxStats(const std::string& ip, uint16_t port);
 };
\ No newline at end of file
@@ -0,0 +1,328 @@
+%include "RTPIncomingMediaStream.i"
+%include "SPSCRing.i"
+
+%{
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
+
+struct RTPLoopChannelStats
+{
+	uint32_t bridges	= 0;
+	uint32_t capacity	= 0;
+	uint32_t depth		= 0;
+	uint32_t maxDepth	= 0;
+	uint32_t backlog	= 0;
+	uint64_t pushed		= 0;
+	uint64_t delivered	= 0;
+	uint64_t deferred	= 0;
+	uint64_t dropped	= 0;
+	uint64_t wakeups	= 0;
+};
+
+class RTPIncomingMediaStreamBridge;
+
+/*
+ * RTPLoopChannel
+ *  Hands packets from a source loop to a target loop for all the bridges between both. Packets are pushed
+ *  on a bounded lock-free single producer single consumer queue, as they are only pushed by the source loop,
+ *  and the target loop is woken up once for all the packets queued before it drains the queue. While the
+ *  ring is full packets wait on the source loop, so a slow target only loses packets when the backlog is
+ *  full too. Channels are shared by all the bridges of the same pair of loops and destroyed with the last one.
+ */
+class RTPLoopChannel :
+	public std::enable_shared_from_this<RTPLoopChannel>
+{
+public:
+	//Max number of items delivered on each wakeup, so a busy source does not starve the target loop
+	static constexpr size_t MaxDrainBatch = 256;
+	//Max number of items waiting on the source loop while the ring is full
+	static constexpr size_t MaxBacklog = 4096;
+
+	enum Event
+	{
+		RTP,
+		Bye,
+		Ended
+	};
+
+	struct Item
+	{
+		std::shared_ptr<RTPIncomingMediaStreamBridge> bridge;
+		RTPPacket::shared packet;
+		Event event = RTP;
+	};
+
+public:
+	/*
+	 * Get
+	 *  Get the channel between both loops, creating it with the given capacity if it does not exist
+	 */
+	static std::shared_ptr<RTPLoopChannel> Get(TimeService& source, TimeService& target, size_t capacity)
+	{
+		static Mutex mutex;
+		static std::map<std::pair<TimeService*, TimeService*>, std::weak_ptr<RTPLoopChannel>> channels;
+
+		ScopedLock lock(mutex);
+		auto& weak = channels[{&source, &target}];
+		auto channel = weak.lock();
+		if (!channel)
+		{
+			//Remove expired ones
+			for (auto it = channels.begin(); it != channels.end();)
+				if (it->second.expired() && &it->second != &weak)
+					it = channels.erase(it);
+				else
+					++it;
+			channel = std::shared_ptr<RTPLoopChannel>(new RTPLoopChannel(source, target, capacity));
+			weak = channel;
+		}
+		return channel;
+	}
+
+	/*
+	 * Push
+	 *  Called on the source loop only
+	 */
+	bool Push(Item&& item)
+	{
+		return queue.Push(std::move(item), weak_from_this());
+	}
+
+	TimeService& GetTarget()	{ return queue.GetTimeService(); }
+
+	void AddBridge()		{ bridges++; }
+	void RemoveBridge()		{ bridges--; }
+
+	RTPLoopChannelStats GetStats() const
+	{
+		RTPLoopChannelStats stats;
+		stats.bridges	= bridges;
+		stats.capacity	= queue.GetCapacity();
+		stats.depth	= queue.GetSize();
+		stats.maxDepth	= queue.GetMaxDepth();
+		stats.backlog	= queue.GetBacklogSize();
+		stats.pushed	= queue.GetPushed();
+		stats.delivered	= queue.GetDelivered();
+		stats.deferred	= queue.GetDeferred();
+		stats.dropped	= queue.GetDropped();
+		stats.wakeups	= queue.GetWakeups();
+		return stats;
+	}
+
+private:
+	friend class SPSCAsyncQueue<Item>;
+
+	RTPLoopChannel(TimeService& source, TimeService& target, size_t capacity) :
+		queue(target, capacity, MaxDrainBatch)
+	{
+		queue.SetBacklog(source, MaxBacklog);
+	}
+
+	/*
+	 * Drain
+	 *  Called on the target loop only
+	 */
+	void Drain();
+
+private:
+	SPSCAsyncQueue<Item> queue;
+	std::atomic<uint32_t> bridges = 0;
+};
+
+/*
+ * RTPIncomingMediaStreamBridge
+ *  Forwards an incoming stream from its loop to listeners running on another loop, through the channel
+ *  shared by all the bridges between both loops.
+ */
+class RTPIncomingMediaStreamBridge :
+	public RTPIncomingMediaStream,
+	public RTPIncomingMediaStream::Listener,
+	public std::enable_shared_from_this<RTPIncomingMediaStreamBridge>
+{
+public:
+	static std::shared_ptr<RTPIncomingMediaStreamBridge> Create(const RTPIncomingMediaStream::shared& incoming, TimeService& timeService, size_t capacity)
+	{
+		if (!incoming)
+			return nullptr;
+		auto channel = RTPLoopChannel::Get(incoming->GetTimeService(), timeService, capacity);
+		auto bridge = std::shared_ptr<RTPIncomingMediaStreamBridge>(new RTPIncomingMediaStreamBridge(incoming, channel));
+		incoming->AddListener(bridge.get());
+		return bridge;
+	}
+
+	virtual ~RTPIncomingMediaStreamBridge()
+	{
+		Stop();
+		channel->RemoveBridge();
+	}
+
+	virtual void AddListener(RTPIncomingMediaStream::Listener* listener) override
+	{
+		ScopedLock lock(mutex);
+		listeners.insert(listener);
+	}
+
+	virtual void RemoveListener(RTPIncomingMediaStream::Listener* listener) override
+	{
+		ScopedLock lock(mutex);
+		listeners.erase(listener);
+	}
+
+	virtual DWORD GetMediaSSRC() const override	{ return ssrc;			}
+	virtual TimeService& GetTimeService() override	{ return channel->GetTarget();	}
+	virtual void Mute(bool muting) override		{ muted = muting;		}
+
+	void Stop()
+	{
+		RTPIncomingMediaStream::shared stopped;
+		{
+			ScopedLock lock(mutex);
+			stopped = std::move(incoming);
+		}
+		//Stop listening
+		if (!stopped)
+			return;
+		stopped->RemoveListener(this);
+		//End listeners on target loop, packets still queued will have nobody to deliver to
+		channel->GetTarget().Async([weak = weak_from_this()](std::chrono::milliseconds) {
+			if (auto bridge = weak.lock())
+				bridge->Deliver(RTPLoopChannel::Ended, nullptr);
+		});
+	}
+
+	RTPLoopChannelStats GetChannelStats() const	{ return channel->GetStats();	}
+	uint64_t GetDropped() const			{ return dropped;		}
+
+	virtual void onRTP(const RTPIncomingMediaStream* stream, const RTPPacket::shared& packet) override
+	{
+		if (muted)
+			return;
+		//We may be being destroyed
+		auto self = weak_from_this().lock();
+		if (!self)
+			return;
+		if (!channel->Push({ std::move(self), packet, RTPLoopChannel::RTP }))
+			dropped++;
+	}
+
+	virtual void onBye(const RTPIncomingMediaStream* stream) override
+	{
+		if (auto self = weak_from_this().lock())
+			channel->Push({ std::move(self), nullptr, RTPLoopChannel::Bye });
+	}
+
+	virtual void onEnded(const RTPIncomingMediaStream* stream) override
+	{
+		{
+			ScopedLock lock(mutex);
+			//Source is gone, don't remove us on stop
+			incoming.reset();
+		}
+		//Ring may be full, don't lose the end of the stream
+		channel->GetTarget().Async([weak = weak_from_this()](std::chrono::milliseconds) {
+			if (auto bridge = weak.lock())
+				bridge->Deliver(RTPLoopChannel::Ended, nullptr);
+		});
+	}
+
+private:
+	friend class RTPLoopChannel;
+
+	RTPIncomingMediaStreamBridge(const RTPIncomingMediaStream::shared& incoming, const std::shared_ptr<RTPLoopChannel>& channel) :
+		incoming(incoming),
+		channel(channel),
+		ssrc(incoming->GetMediaSSRC())
+	{
+		channel->AddBridge();
+	}
+
+	/*
+	 * Deliver
+	 *  Called on the target loop only
+	 */
+	void Deliver(RTPLoopChannel::Event event, const RTPPacket::shared& packet)
+	{
+		switch (event)
+		{
+			case RTPLoopChannel::RTP:
+			{
+				ScopedLock lock(mutex);
+				for (auto listener : listeners)
+					listener->onRTP(this, packet);
+				break;
+			}
+			case RTPLoopChannel::Bye:
+			{
+				ScopedLock lock(mutex);
+				for (auto listener : listeners)
+					listener->onBye(this);
+				break;
+			}
+			case RTPLoopChannel::Ended:
+			{
+				std::set<RTPIncomingMediaStream::Listener*> ended;
+				{
+					ScopedLock lock(mutex);
+					ended.swap(listeners);
+				}
+				//Listeners may remove themselves
+				for (auto listener : ended)
+					listener->onEnded(this);
+				break;
+			}
+		}
+	}
+
+private:
+	Mutex mutex;
+	RTPIncomingMediaStream::shared incoming;
+	std::shared_ptr<RTPLoopChannel> channel;
+	DWORD ssrc;
+	std::set<RTPIncomingMediaStream::Listener*> listeners;
+	volatile bool muted = false;
+	std::atomic<uint64_t> dropped = 0;
+};
+
+void RTPLoopChannel::Drain()
+{
+	//Items are released before the next one, bridge may be destroyed there
+	queue.Drain(weak_from_this(), [](Item& item) {
+		item.bridge->Deliver(item.event, item.packet);
+	});
+}
+%}
+
+%nodefaultctor RTPLoopChannelStats;
+struct RTPLoopChannelStats
+{
+	uint32_t bridges;
+	uint32_t capacity;
+	uint32_t depth;
+	uint32_t maxDepth;
+	uint32_t backlog;
+	uint64_t pushed;
+	uint64_t delivered;
+	uint64_t deferred;
+	uint64_t dropped;
+	uint64_t wakeups;
+};
+
+%nodefaultctor RTPIncomingMediaStreamBridge;
+struct RTPIncomingMediaStreamBridge : public RTPIncomingMediaStream
+{
+	void Stop();
+	RTPLoopChannelStats GetChannelStats() const;
+	uint64_t GetDropped() const;
+};
+
+SHARED_PTR_BEGIN(RTPIncomingMediaStreamBridge)
+{
+	RTPIncomingMediaStreamBridgeShared(const RTPIncomingMediaStreamShared& incomingMediaStream, TimeService& timeService, size_t capacity)
+	{
+		return new std::shared_ptr<RTPIncomingMediaStreamBridge>(RTPIncomingMediaStreamBridge::Create(incomingMediaStream, timeService, capacity));
+	}
+	SHARED_PTR_TO(RTPIncomingMediaStream)
+}
+SHARED_PTR_END(RTPIncomingMediaStreamBridge)
@@ -0,0 +1,171 @@
+%include "RTPIncomingMediaStream.i"
+
+%{
+struct RTPLatencyProbeStats
+{
+	uint64_t packets	= 0;
+	uint64_t overflow	= 0;
+	uint32_t min		= 0;
+	uint32_t p50		= 0;
+	uint32_t p90		= 0;
+	uint32_t p99		= 0;
+	uint32_t p999		= 0;
+	uint32_t max		= 0;
+};
+
+/*
+ * RTPLatencyProbe
+ *  Listens to incoming streams fed by a SyntheticRTPSource and builds a histogram of the
+ *  time elapsed since each packet was generated. Latencies are in microseconds with a
+ *  resolution of 10us up to 100ms, higher values are counted as overflow.
+ */
+class RTPLatencyProbe :
+	public RTPIncomingMediaStream::Listener
+{
+public:
+	static constexpr uint32_t Resolution = 10;
+	static constexpr size_t Buckets = 10000;
+
+public:
+	RTPLatencyProbe() :
+		histogram(Buckets)
+	{
+	}
+
+	virtual ~RTPLatencyProbe()
+	{
+		ScopedLock lock(mutex);
+		//Remove us from all streams
+		for (auto incoming : incomings)
+			incoming->RemoveListener(this);
+	}
+
+	void AddIncoming(RTPIncomingMediaStream* incoming)
+	{
+		if (!incoming)
+			return;
+		ScopedLock lock(mutex);
+		//Only once
+		if (incomings.insert(incoming).second)
+			incoming->AddListener(this);
+	}
+
+	void RemoveIncoming(RTPIncomingMediaStream* incoming)
+	{
+		if (!incoming)
+			return;
+		ScopedLock lock(mutex);
+		if (incomings.erase(incoming))
+			incoming->RemoveListener(this);
+	}
+
+	void Reset()
+	{
+		ScopedLock lock(mutex);
+		std::fill(histogram.begin(), histogram.end(), 0);
+		packets		= 0;
+		overflow	= 0;
+		min		= std::numeric_limits<uint32_t>::max();
+		max		= 0;
+	}
+
+	RTPLatencyProbeStats GetStats()
+	{
+		ScopedLock lock(mutex);
+		RTPLatencyProbeStats stats;
+		stats.packets	= packets;
+		stats.overflow	= overflow;
+		stats.min	= packets ? min : 0;
+		stats.max	= max;
+		stats.p50	= GetPercentile(0.50);
+		stats.p90	= GetPercentile(0.90);
+		stats.p99	= GetPercentile(0.99);
+		stats.p999	= GetPercentile(0.999);
+		return stats;
+	}
+
+	virtual void onRTP(const RTPIncomingMediaStream* incoming, const RTPPacket::shared& packet) override
+	{
+		//Check it has generation time
+		if (packet->GetMediaLength() < 9)
+			return;
+		//Get generation and current time
+		uint64_t ts = get8(packet->GetMediaData(), 1);
+		uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		uint32_t latency = now > ts ? std::min<uint64_t>(now - ts, std::numeric_limits<uint32_t>::max()) : 0;
+
+		ScopedLock lock(mutex);
+		packets++;
+		min = std::min(min, latency);
+		max = std::max(max, latency);
+		//Add to histogram
+		size_t bucket = latency / Resolution;
+		if (bucket < Buckets)
+			histogram[bucket]++;
+		else
+			overflow++;
+	}
+
+	virtual void onBye(const RTPIncomingMediaStream* incoming) override
+	{
+	}
+
+	virtual void onEnded(const RTPIncomingMediaStream* incoming) override
+	{
+		ScopedLock lock(mutex);
+		//Stream is gone, don't remove us on destruction
+		incomings.erase(const_cast<RTPIncomingMediaStream*>(incoming));
+	}
+
+private:
+	uint32_t GetPercentile(double percentile) const
+	{
+		if (!packets)
+			return 0;
+		//Get number of packets below percentile
+		uint64_t target = std::ceil(packets * percentile);
+		uint64_t count = 0;
+		for (size_t i = 0; i < Buckets; ++i)
+		{
+			count += histogram[i];
+			if (count >= target)
+				//Upper bound of the bucket
+				return (i + 1) * Resolution;
+		}
+		//It is on the overflow
+		return max;
+	}
+
+private:
+	Mutex mutex;
+	std::set<RTPIncomingMediaStream*> incomings;
+	std::vector<uint64_t> histogram;
+	uint64_t packets	= 0;
+	uint64_t overflow	= 0;
+	uint32_t min		= std::numeric_limits<uint32_t>::max();
+	uint32_t max		= 0;
+};
+%}
+
+%nodefaultctor RTPLatencyProbeStats;
+struct RTPLatencyProbeStats
+{
+	uint64_t packets;
+	uint64_t overflow;
+	uint32_t min;
+	uint32_t p50;
+	uint32_t p90;
+	uint32_t p99;
+	uint32_t p999;
+	uint32_t max;
+};
+
+class RTPLatencyProbe
+{
+public:
+	RTPLatencyProbe();
+	void AddIncoming(RTPIncomingMediaStream* incoming);
+	void RemoveIncoming(RTPIncomingMediaStream* incoming);
+	void Reset();
+	RTPLatencyProbeStats GetStats();
+};
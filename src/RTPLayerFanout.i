@@ -0,0 +1,281 @@
+%include "RTPIncomingMediaStream.i"
+%include "PacketPool.i"
+
+%{
+#include "VideoLayerSelector.h"
+
+struct RTPLayerFanoutStats
+{
+	uint32_t groups		= 0;
+	uint32_t listeners	= 0;
+	uint64_t packets	= 0;
+	uint64_t forwarded	= 0;
+	uint64_t dropped	= 0;
+	uint64_t rewritten	= 0;
+};
+
+/*
+ * RTPLayerFanout
+ *  Forwards an incoming encoding to groups of listeners by selected spatial and temporal layers. Each group
+ *  runs the layer selection once per packet and renumbers the packets it forwards, so the transponders
+ *  listening to it forward all layers and only do their own per subscriber header rewrite. Groups are
+ *  created on demand and kept until the fanout is stopped. Rewritten packets are created on the packet
+ *  pool of the endpoint, if any.
+ */
+class RTPLayerFanout :
+	public RTPIncomingMediaStream::Listener
+{
+public:
+	class Group :
+		public RTPIncomingMediaStream
+	{
+	public:
+		Group(TimeService& timeService, const std::shared_ptr<PacketPool>& packetPool, DWORD ssrc, BYTE spatialLayerId, BYTE temporalLayerId) :
+			timeService(timeService),
+			packetPool(packetPool),
+			ssrc(ssrc),
+			spatialLayerId(spatialLayerId),
+			temporalLayerId(temporalLayerId)
+		{
+		}
+
+		virtual ~Group() = default;
+
+		virtual void AddListener(RTPIncomingMediaStream::Listener* listener) override
+		{
+			ScopedLock lock(mutex);
+			listeners.insert(listener);
+		}
+
+		virtual void RemoveListener(RTPIncomingMediaStream::Listener* listener) override
+		{
+			ScopedLock lock(mutex);
+			listeners.erase(listener);
+		}
+
+		virtual DWORD GetMediaSSRC() const override	{ return ssrc;		}
+		virtual TimeService& GetTimeService() override	{ return timeService;	}
+		virtual void Mute(bool muting) override		{ muted = muting;	}
+
+	private:
+		friend class RTPLayerFanout;
+
+		void OnRTP(const RTPPacket::shared& packet)
+		{
+			ScopedLock lock(mutex);
+			//Nothing to do if nobody is listening
+			if (listeners.empty() || muted)
+				return;
+
+			//Create selector for codec on first packet or if it changes
+			if (packet->GetMediaType() == MediaFrame::Video && (!selector || selector->GetCodec() != packet->GetCodec()))
+			{
+				selector.reset(VideoLayerSelector::Create(static_cast<VideoCodec::Type>(packet->GetCodec())));
+				if (selector)
+				{
+					selector->SelectSpatialLayer(spatialLayerId);
+					selector->SelectTemporalLayer(temporalLayerId);
+				}
+			}
+
+			//Select layers once for all the group
+			bool mark = packet->GetMark();
+			if (selector && !selector->Select(packet, mark))
+			{
+				//Next forwarded packets must be renumbered to hide the gap
+				skipped++;
+				dropped++;
+				return;
+			}
+
+			//Reuse same packet if nothing has to be changed
+			RTPPacket::shared forwarded = packet;
+			if (skipped || mark != packet->GetMark())
+			{
+				//Copy it, only the header is changed
+				forwarded = packetPool ? packetPool->MakeShared<RTPPacket>(*packet) : packet->Clone();
+				forwarded->SetExtSeqNum(packet->GetExtSeqNum() - skipped);
+				forwarded->SetMark(mark);
+				rewritten++;
+			}
+			this->forwarded++;
+
+			//Deliver to all group listeners
+			for (auto listener : listeners)
+				listener->onRTP(this, forwarded);
+		}
+
+		void OnBye()
+		{
+			ScopedLock lock(mutex);
+			for (auto listener : listeners)
+				listener->onBye(this);
+		}
+
+		void OnEnded()
+		{
+			std::set<RTPIncomingMediaStream::Listener*> ended;
+			{
+				ScopedLock lock(mutex);
+				ended.swap(listeners);
+			}
+			//Listeners may remove themselves
+			for (auto listener : ended)
+				listener->onEnded(this);
+		}
+
+		size_t GetListeners()
+		{
+			ScopedLock lock(mutex);
+			return listeners.size();
+		}
+
+	private:
+		Mutex mutex;
+		TimeService& timeService;
+		std::shared_ptr<PacketPool> packetPool;
+		DWORD ssrc;
+		BYTE spatialLayerId;
+		BYTE temporalLayerId;
+		std::set<RTPIncomingMediaStream::Listener*> listeners;
+		std::unique_ptr<VideoLayerSelector> selector;
+		uint64_t skipped = 0;
+		volatile bool muted = false;
+		std::atomic<uint64_t> forwarded = 0;
+		std::atomic<uint64_t> dropped = 0;
+		std::atomic<uint64_t> rewritten = 0;
+	};
+
+public:
+	static std::shared_ptr<RTPLayerFanout> Create(const RTPIncomingMediaStream::shared& incoming, const std::shared_ptr<PacketPool>& packetPool)
+	{
+		if (!incoming)
+			return nullptr;
+		auto fanout = std::shared_ptr<RTPLayerFanout>(new RTPLayerFanout(incoming, packetPool));
+		incoming->AddListener(fanout.get());
+		return fanout;
+	}
+
+	virtual ~RTPLayerFanout()
+	{
+		Stop();
+	}
+
+	/*
+	 * GetGroup
+	 *  Get the stream forwarding up to the selected layers, creating it if needed
+	 */
+	RTPIncomingMediaStream::shared GetGroup(BYTE spatialLayerId, BYTE temporalLayerId)
+	{
+		ScopedLock lock(mutex);
+		auto& group = groups[{spatialLayerId, temporalLayerId}];
+		if (!group)
+			group = std::make_shared<Group>(timeService, packetPool, ssrc, spatialLayerId, temporalLayerId);
+		return group;
+	}
+
+	void Stop()
+	{
+		RTPIncomingMediaStream::shared stopped;
+		{
+			ScopedLock lock(mutex);
+			stopped = std::move(incoming);
+		}
+		//Stop listening
+		if (stopped)
+			stopped->RemoveListener(this);
+		//End groups
+		ScopedLock lock(mutex);
+		for (auto& [layers, group] : groups)
+			group->OnEnded();
+		groups.clear();
+	}
+
+	RTPLayerFanoutStats GetStats()
+	{
+		ScopedLock lock(mutex);
+		RTPLayerFanoutStats stats;
+		stats.packets	= packets;
+		stats.groups	= groups.size();
+		for (const auto& [layers, group] : groups)
+		{
+			stats.listeners	+= group->GetListeners();
+			stats.forwarded	+= group->forwarded;
+			stats.dropped	+= group->dropped;
+			stats.rewritten	+= group->rewritten;
+		}
+		return stats;
+	}
+
+	virtual void onRTP(const RTPIncomingMediaStream* stream, const RTPPacket::shared& packet) override
+	{
+		ScopedLock lock(mutex);
+		packets++;
+		for (auto& [layers, group] : groups)
+			group->OnRTP(packet);
+	}
+
+	virtual void onBye(const RTPIncomingMediaStream* stream) override
+	{
+		ScopedLock lock(mutex);
+		for (auto& [layers, group] : groups)
+			group->OnBye();
+	}
+
+	virtual void onEnded(const RTPIncomingMediaStream* stream) override
+	{
+		ScopedLock lock(mutex);
+		//Source is gone, don't remove us on stop
+		incoming.reset();
+		for (auto& [layers, group] : groups)
+			group->OnEnded();
+	}
+
+private:
+	RTPLayerFanout(const RTPIncomingMediaStream::shared& incoming, const std::shared_ptr<PacketPool>& packetPool) :
+		incoming(incoming),
+		timeService(incoming->GetTimeService()),
+		packetPool(packetPool),
+		ssrc(incoming->GetMediaSSRC())
+	{
+	}
+
+private:
+	Mutex mutex;
+	RTPIncomingMediaStream::shared incoming;
+	TimeService& timeService;
+	std::shared_ptr<PacketPool> packetPool;
+	DWORD ssrc;
+	std::map<std::pair<BYTE, BYTE>, std::shared_ptr<Group>> groups;
+	uint64_t packets = 0;
+};
+%}
+
+%nodefaultctor RTPLayerFanoutStats;
+struct RTPLayerFanoutStats
+{
+	uint32_t groups;
+	uint32_t listeners;
+	uint64_t packets;
+	uint64_t forwarded;
+	uint64_t dropped;
+	uint64_t rewritten;
+};
+
+%nodefaultctor RTPLayerFanout;
+class RTPLayerFanout
+{
+public:
+	RTPIncomingMediaStreamShared GetGroup(BYTE spatialLayerId, BYTE temporalLayerId);
+	void Stop();
+	RTPLayerFanoutStats GetStats();
+};
+
+SHARED_PTR_BEGIN(RTPLayerFanout)
+{
+	RTPLayerFanoutShared(const RTPIncomingMediaStreamShared& incoming, const PacketPoolShared& packetPool)
+	{
+		return new std::shared_ptr<RTPLayerFanout>(RTPLayerFanout::Create(incoming, packetPool));
+	}
+}
+SHARED_PTR_END(RTPLayerFanout)
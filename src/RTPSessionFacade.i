@@ -1,25 +1,226 @@
 %include "RTPSender.i"
 %include "RTPReceiver.i"
+%include "SPSCRing.i"
+%include "BatchedUDPSocket.i"
 
 %{
+#include <array>
+#include <thread>
+
+struct RTPSessionSendQueueStats
+{
+	size_t producers	= 0;
+	size_t capacity		= 0;
+	size_t depth		= 0;
+	size_t maxDepth		= 0;
+	uint64_t enqueued	= 0;
+	uint64_t sent		= 0;
+	uint64_t dropped	= 0;
+	uint64_t batches	= 0;
+};
+
+struct RTPSessionBatchingStats
+{
+	bool enabled		= false;
+	size_t batchSize	= 0;
+	uint32_t batchLatency	= 0;
+	uint64_t latencyFlushes	= 0;
+	uint64_t rtcpPackets	= 0;
+	uint64_t retransmissions = 0;
+	BatchedUDPSocketStats socket;
+};
+
+/*
+ * RTPSessionFacade
+ *  Plain rtp session. Packets enqueued by the transponders are queued on a lock-free ring and sent in order
+ *  from the session loop, which is woken up once for all the packets queued before it drains them, so the
+ *  media pipeline never blocks on the socket. Each loop sending to the session gets its own ring on its first
+ *  packet, so producers never lock. Packets are dropped if the ring is full.
+ *  When not batching, drained packets are sent one by one through the session transport, which keeps the
+ *  RTX and NACK handling of the native session.
+ *  When batching, the facade owns the socket instead of the session transport, so it also sends the RTCP
+ *  reports and PLIs and answers NACKs by resending the original packet from the sent history (no RTX).
+ */
 class RTPSessionFacade : 	
 	public RTPSession,
 	public RTPSender,
-	public RTPReceiver
+	public RTPReceiver,
+	public std::enable_shared_from_this<RTPSessionFacade>
 {
 public:
-	RTPSessionFacade(MediaFrame::Type media) : RTPSession(media,NULL)
+	//Max packets sent from each loop on each wake up of the session loop
+	static constexpr size_t MaxSendBatch = 64;
+	//Max number of loops sending to the same session
+	static constexpr size_t MaxProducers = 64;
+	//Sent packets kept for retransmission when batching
+	static constexpr size_t HistorySize = 512;
+	//Interval of the reports sent when batching
+	static constexpr std::chrono::milliseconds ReportInterval = std::chrono::seconds(1);
+
+public:
+	RTPSessionFacade(MediaFrame::Type media, size_t sendQueueSize) :
+		RTPSession(media,NULL),
+		sendQueueSize(std::max<size_t>(sendQueueSize, 1)),
+		sendSeqNum(rand())
 	{
 		//Delegate to group
 		delegate = true;
 		//Start group dispatch
 		GetIncomingSourceGroup()->Start();
 	}
-	virtual ~RTPSessionFacade() = default;
-	//TODO: Make async
-	virtual int Enqueue(const RTPPacket::shared& packet)  { return SendPacket(packet); }
-	virtual int SendPLI(DWORD ssrc)				 { return RequestFPU();}
+	virtual ~RTPSessionFacade()
+	{
+		//Stop receiving before the session is destroyed
+		if (batched)
+			batched->Close();
+	}
+
+	/*
+	 * SetBatching
+	 *  Send and receive rtp using sendmmsg/recvmmsg (and UDP GSO if available) on a socket owned by the facade.
+	 *  Must be called before SetLocalPort. Packets are sent with a single call once batchSize of them are
+	 *  queued, a partial batch is held on the session loop for up to batchLatency ms (or sent right away if 0).
+	 */
+	bool SetBatching(size_t batchSize, uint32_t batchLatency)
+	{
+		//Only before binding
+		if (batched && batched->GetLocalPort())
+			return Error("-RTPSessionFacade::SetBatching() socket already bound\n");
+		//Disable or create socket
+		if (batchSize <= 1)
+		{
+			batched.reset();
+		} else {
+			this->batchSize = std::min(batchSize, MaxSendBatch);
+			this->batchLatency = std::chrono::milliseconds(batchLatency);
+			batched = std::make_unique<BatchedUDPSocket>(this->batchSize);
+			//Packets are serialized directly in the history slot of their sequence number
+			history.resize(HistorySize * BatchedUDPSocket::MaxDatagramSize);
+			historySizes.assign(HistorySize, 0);
+			datagrams.reserve(this->batchSize);
+		}
+		return true;
+	}
+
+	int SetLocalPort(int recvPort)
+	{
+		//If not batching use session transport
+		if (!batched)
+			return RTPSession::SetLocalPort(recvPort);
+		//Bind batched socket, received packets are handled on the session loop
+		int port = batched->Bind(recvPort, [this](const std::vector<iovec>& received) {
+			OnReceived(received);
+		});
+		//Send reports periodically
+		if (port)
+		{
+			GetTimeService().Async([weak = weak_from_this()](std::chrono::milliseconds) {
+				auto session = weak.lock();
+				if (!session)
+					return;
+				session->rtcpTimer = session->GetTimeService().CreateTimer(ReportInterval, ReportInterval, [weak](std::chrono::milliseconds now) {
+					if (auto session = weak.lock())
+						session->SendReport(now.count());
+				});
+			});
+		}
+		return port;
+	}
+
+	int GetLocalPort()
+	{
+		return batched ? batched->GetLocalPort() : RTPSession::GetLocalPort();
+	}
+
+	int SetRemotePort(char *ip, int sendPort)
+	{
+		//If not batching use session transport
+		if (!batched)
+			return RTPSession::SetRemotePort(ip, sendPort);
+		return batched->SetRemote(ip, sendPort);
+	}
+
+	virtual int Enqueue(const RTPPacket::shared& packet)
+	{
+		//Get the queue of the calling loop
+		auto queue = sending ? GetSendQueue() : nullptr;
+		//If ended or too many loops
+		if (!queue)
+		{
+			dropped++;
+			return 0;
+		}
+		//Queue it for the session loop
+		return queue->Push(RTPPacket::shared(packet), weak_from_this());
+	}
+
+	virtual int SendPLI(DWORD ssrc)
+	{
+		//If not batching the session transport sends it
+		if (!batched)
+			return RequestFPU();
+		//Send it from the session loop
+		GetTimeService().Async([weak = weak_from_this()](std::chrono::milliseconds) {
+			if (auto session = weak.lock())
+				session->SendPictureLossIndication();
+		});
+		return 1;
+	}
 	virtual int Reset(DWORD ssrc)				 { return 1;}
+
+	int End()
+	{
+		//Stop accepting packets
+		sending = false;
+		//Stop reports
+		GetTimeService().Async([weak = weak_from_this()](std::chrono::milliseconds) {
+			if (auto session = weak.lock())
+			{
+				if (session->rtcpTimer)
+					session->rtcpTimer->Cancel();
+				session->rtcpTimer.reset();
+				//Send the held batch
+				if (session->batched)
+					session->SendDatagrams();
+				session->latencyTimer.reset();
+			}
+		});
+		//Call parent
+		return RTPSession::End();
+	}
+
+	RTPSessionSendQueueStats GetSendQueueStats() const
+	{
+		RTPSessionSendQueueStats stats;
+		stats.producers	= numProducers.load(std::memory_order_acquire);
+		stats.capacity	= SPSCRing<RTPPacket::shared>::RoundUp(sendQueueSize);
+		stats.dropped	= dropped;
+		stats.batches	= batches;
+		for (size_t i = 0; i < stats.producers; ++i)
+		{
+			const auto& queue = *producers[i].queue;
+			stats.depth	+= queue.GetSize();
+			stats.maxDepth	 = std::max(stats.maxDepth, queue.GetMaxDepth());
+			stats.enqueued	+= queue.GetPushed();
+			stats.sent	+= queue.GetDelivered();
+			stats.dropped	+= queue.GetDropped();
+		}
+		return stats;
+	}
+
+	RTPSessionBatchingStats GetBatchingStats() const
+	{
+		RTPSessionBatchingStats stats;
+		stats.enabled		= !!batched;
+		stats.batchSize		= batched ? batchSize : 0;
+		stats.batchLatency	= batched ? batchLatency.count() : 0;
+		stats.latencyFlushes	= latencyFlushes;
+		stats.rtcpPackets	= rtcpPackets;
+		stats.retransmissions	= retransmissions;
+		if (batched)
+			stats.socket	= batched->GetStats();
+		return stats;
+	}
 	
 	int Init(const Properties &properties)
 	{
@@ -56,7 +257,16 @@ public:
 			BYTE type = it->GetProperty("pt",0);
 			//ADD it
 			rtp.SetCodecForType(type, codec);
+			//Keep reverse mapping for batched sending
+			sendTypes[codec] = type;
 		}
+
+		//Get header extensions, only used for batched sending as the session transport has its own
+		std::vector<Properties> extensions;
+		properties.GetChildrenArray("ext",extensions);
+		//For each extension
+		for (const auto& extension : extensions)
+			sendExtMap.SetCodecForType(extension.GetProperty("id",0), RTPHeaderExtension::GetExtensionForName(extension.GetProperty("uri")));
 	
 		//Set local 
 		RTPSession::SetSendingRTPMap(rtp,apt);
@@ -64,19 +274,315 @@ public:
 		
 		//Set properties
 		RTPSession::SetProperties(properties.GetChildren("properties"));
+		//Reports are sent by us when batching
+		useRTCP = properties.GetProperty("properties.useRTCP", true);
 		
+		//Bind batched socket on any port if not done yet
+		if (batched && !batched->GetLocalPort() && !SetLocalPort(0))
+			return 0;
+
 		//Call parent
 		return RTPSession::Init();
 	}
+
+private:
+	friend class SPSCAsyncQueue<RTPPacket::shared>;
+
+	/*
+	 * GetSendQueue
+	 *  Get the queue of the calling loop, creating it on its first packet
+	 */
+	SPSCAsyncQueue<RTPPacket::shared>* GetSendQueue()
+	{
+		auto thread = std::this_thread::get_id();
+		//Published queues never change, so they can be looked up without locking
+		size_t num = numProducers.load(std::memory_order_acquire);
+		for (size_t i = 0; i < num; ++i)
+			if (producers[i].thread == thread)
+				return producers[i].queue.get();
+		//Only this loop can add its own queue, lock against other new ones
+		ScopedLock lock(registering);
+		num = numProducers.load(std::memory_order_relaxed);
+		if (num == MaxProducers)
+			return nullptr;
+		producers[num].thread = thread;
+		producers[num].queue = std::make_unique<SPSCAsyncQueue<RTPPacket::shared>>(GetTimeService(), sendQueueSize, MaxSendBatch);
+		numProducers.store(num + 1, std::memory_order_release);
+		return producers[num].queue.get();
+	}
+
+	/*
+	 * Drain
+	 *  Called on the session loop only, drains the queues of all the loops
+	 */
+	void Drain()
+	{
+		size_t num = 0;
+		size_t count = numProducers.load(std::memory_order_acquire);
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto& queue = *producers[i].queue;
+			//If not using batched socket
+			if (!batched)
+			{
+				num += queue.Drain(weak_from_this(), [this](RTPPacket::shared& packet) {
+					SendPacket(packet);
+				});
+			} else {
+				num += queue.Drain(weak_from_this(), [this](RTPPacket::shared& packet) {
+					SerializeDatagram(packet);
+					//Send full batches
+					if (datagrams.size() == batchSize)
+						SendDatagrams();
+				});
+			}
+		}
+		//Send the rest now or when the batch latency expires
+		if (batched)
+			HoldDatagrams();
+		if (num)
+			batches++;
+	}
+
+	void HoldDatagrams()
+	{
+		if (datagrams.empty())
+			return;
+		//No latency allowed
+		if (!batchLatency.count())
+			return SendDatagrams();
+		//Already waiting for the first held packet
+		if (latencyTimer && latencyTimer->IsScheduled())
+			return;
+		if (!latencyTimer)
+			latencyTimer = GetTimeService().CreateTimer([weak = weak_from_this()](std::chrono::milliseconds) {
+				auto session = weak.lock();
+				if (!session || session->datagrams.empty())
+					return;
+				session->latencyFlushes++;
+				session->SendDatagrams();
+			});
+		latencyTimer->Reschedule(batchLatency, std::chrono::milliseconds(0));
+	}
+
+	void SerializeDatagram(const RTPPacket::shared& packet)
+	{
+		//Get payload type for codec
+		auto it = sendTypes.find(packet->GetCodec());
+		if (it == sendTypes.end())
+			return;
+		auto& source = GetOutgoingSourceGroup()->media;
+		//Rewrite header for this session
+		packet->SetPayloadType(it->second);
+		packet->SetSSRC(source.ssrc);
+		packet->SetSeqNum(sendSeqNum++);
+		//Serialize it in the history so it can be resent
+		size_t slot = packet->GetSeqNum() % HistorySize;
+		BYTE* buffer = history.data() + slot * BatchedUDPSocket::MaxDatagramSize;
+		DWORD len = packet->Serialize(buffer, BatchedUDPSocket::MaxDatagramSize, sendExtMap);
+		historySizes[slot] = len;
+		if (!len)
+			return;
+		datagrams.push_back({ buffer, len });
+		//Update outgoing stats so RTCP reports are consistent
+		source.Update(getTimeMS(), packet->GetRTPHeader(), len);
+	}
+
+	void SendDatagrams()
+	{
+		if (datagrams.empty())
+			return;
+		batched->Send(datagrams);
+		datagrams.clear();
+		//Nothing held anymore
+		if (latencyTimer)
+			latencyTimer->Cancel();
+	}
+
+	struct ReceivedBatch
+	{
+		std::vector<BYTE> data;
+		std::vector<DWORD> sizes;
+	};
+
+	/*
+	 * OnReceived
+	 *  Called on the receiving thread of the batched socket, copies the datagrams and hands them to the session loop
+	 */
+	void OnReceived(const std::vector<iovec>& received)
+	{
+		auto batch = std::make_shared<ReceivedBatch>();
+		batch->sizes.reserve(received.size());
+		for (const auto& datagram : received)
+		{
+			const BYTE* data = (const BYTE*)datagram.iov_base;
+			batch->data.insert(batch->data.end(), data, data + datagram.iov_len);
+			batch->sizes.push_back(datagram.iov_len);
+		}
+		GetTimeService().Async([weak = weak_from_this(), batch](std::chrono::milliseconds) {
+			auto session = weak.lock();
+			if (!session)
+				return;
+			const BYTE* data = batch->data.data();
+			for (auto size : batch->sizes)
+			{
+				//Check if it is rtcp
+				if (size >= 2 && data[1] >= 192 && data[1] <= 223)
+					session->OnRTCP(data, size);
+				else
+					session->RTPSession::onRTPPacket(data, size);
+				data += size;
+			}
+		});
+	}
+
+	void OnRTCP(const BYTE* data, DWORD size)
+	{
+		//Update session stats and events
+		RTPSession::onRTCPPacket(data, size);
+		//Resend nacked packets ourselves, the session has not sent them
+		auto rtcp = RTCPCompoundPacket::Parse(data, size);
+		if (!rtcp)
+			return;
+		for (DWORD i = 0; i < rtcp->GetPacketCount(); ++i)
+		{
+			auto packet = rtcp->GetPacket(i);
+			if (packet->GetType() != RTCPPacket::RTPFeedback)
+				continue;
+			auto feedback = std::static_pointer_cast<RTCPRTPFeedback>(packet);
+			if (feedback->GetFeedBackType() != RTCPRTPFeedback::NACK)
+				continue;
+			for (BYTE j = 0; j < feedback->GetFieldCount(); ++j)
+			{
+				auto field = feedback->GetField<RTCPRTPFeedback::NACKField>(j);
+				Retransmit(field->pid);
+				for (WORD k = 0; k < 16; ++k)
+					if (field->blp & (1 << k))
+						Retransmit(field->pid + k + 1);
+			}
+		}
+	}
+
+	void Retransmit(WORD seq)
+	{
+		size_t slot = seq % HistorySize;
+		BYTE* data = history.data() + slot * BatchedUDPSocket::MaxDatagramSize;
+		DWORD size = historySizes[slot];
+		//Check it has not been overwritten
+		if (size < 4 || get2(data, 2) != seq)
+			return;
+		//Same packet in the same stream
+		if (batched->Send({ { data, size } }))
+			retransmissions++;
+	}
+
+	void SendReport(QWORD now)
+	{
+		//If disabled by properties
+		if (!useRTCP)
+			return;
+		auto& outgoing = GetOutgoingSourceGroup()->media;
+		auto& incoming = GetIncomingSourceGroup()->media;
+		auto rtcp = RTCPCompoundPacket::Create();
+		//Sender report if we have sent anything, receiver report otherwise
+		if (outgoing.numPackets)
+		{
+			auto sr = outgoing.CreateSenderReport(now);
+			if (incoming.numPackets)
+				sr->AddReport(incoming.CreateReport(now));
+			rtcp->AddPacket(sr);
+		} else {
+			auto rr = RTCPReceiverReport::Create(outgoing.ssrc);
+			if (incoming.numPackets)
+				rr->AddReport(incoming.CreateReport(now));
+			rtcp->AddPacket(rr);
+		}
+		SendRTCP(rtcp);
+	}
+
+	void SendPictureLossIndication()
+	{
+		auto rtcp = RTCPCompoundPacket::Create();
+		rtcp->AddPacket(RTCPPayloadFeedback::Create(RTCPPayloadFeedback::PictureLossIndication, GetOutgoingSourceGroup()->media.ssrc, GetIncomingSourceGroup()->media.ssrc));
+		SendRTCP(rtcp);
+	}
+
+	void SendRTCP(const RTCPCompoundPacket::shared& rtcp)
+	{
+		DWORD len = rtcp->Serialize(rtcpBuffer, sizeof(rtcpBuffer));
+		if (len && batched->Send({ { rtcpBuffer, len } }))
+			rtcpPackets++;
+	}
+
+private:
+	struct Producer
+	{
+		std::thread::id thread;
+		std::unique_ptr<SPSCAsyncQueue<RTPPacket::shared>> queue;
+	};
+
+	const size_t sendQueueSize;
+	//Queues of the loops sending to the session, only the first numProducers ones are in use
+	std::array<Producer, MaxProducers> producers;
+	std::atomic<size_t> numProducers = 0;
+	Mutex registering;
+	std::atomic<bool> sending = true;
+	std::atomic<uint64_t> dropped = 0;
+	std::atomic<uint64_t> batches = 0;
+	//Batched socket, only used from the session loop once bound
+	std::unique_ptr<BatchedUDPSocket> batched;
+	size_t batchSize = 1;
+	std::chrono::milliseconds batchLatency = std::chrono::milliseconds(0);
+	Timer::shared latencyTimer;
+	std::atomic<uint64_t> latencyFlushes = 0;
+	std::vector<BYTE> history;
+	std::vector<DWORD> historySizes;
+	std::vector<iovec> datagrams;
+	std::map<BYTE, BYTE> sendTypes;
+	RTPMap sendExtMap;
+	//Random initial sequence number, as the session outgoing source does
+	WORD sendSeqNum;
+	//Reports sent by the facade when batching
+	std::atomic<bool> useRTCP = true;
+	Timer::shared rtcpTimer;
+	BYTE rtcpBuffer[BatchedUDPSocket::MaxDatagramSize];
+	std::atomic<uint64_t> rtcpPackets = 0;
+	std::atomic<uint64_t> retransmissions = 0;
 };
 %}
 
+%nodefaultctor RTPSessionSendQueueStats;
+struct RTPSessionSendQueueStats
+{
+	size_t producers;
+	size_t capacity;
+	size_t depth;
+	size_t maxDepth;
+	uint64_t enqueued;
+	uint64_t sent;
+	uint64_t dropped;
+	uint64_t batches;
+};
+
+%nodefaultctor RTPSessionBatchingStats;
+struct RTPSessionBatchingStats
+{
+	bool enabled;
+	size_t batchSize;
+	uint32_t batchLatency;
+	uint64_t latencyFlushes;
+	uint64_t rtcpPackets;
+	uint64_t retransmissions;
+	BatchedUDPSocketStats socket;
+};
+
 
+%nodefaultctor RTPSessionFacade;
 class RTPSessionFacade
 {
 public:
-	RTPSessionFacade(MediaFrameType media);
 	int Init(const Properties &properties);
+	bool SetBatching(size_t batchSize, uint32_t batchLatency);
 	int SetLocalPort(int recvPort);
 	int GetLocalPort();
 	int SetRemotePort(char *ip,int sendPort);
@@ -85,15 +591,17 @@ public:
 	int End();
 	virtual int SendPLI(DWORD ssrc);
 	virtual int Reset(DWORD ssrc);
+	RTPSessionSendQueueStats GetSendQueueStats() const;
+	RTPSessionBatchingStats GetBatchingStats() const;
 	TimeService& GetTimeService();
 };
 
 
 SHARED_PTR_BEGIN(RTPSessionFacade)
 {
-	RTPSessionFacadeShared(MediaFrameType type)
+	RTPSessionFacadeShared(MediaFrameType type, size_t sendQueueSize)
 	{
-		return new std::shared_ptr<RTPSessionFacade>(new RTPSessionFacade(type));
+		return new std::shared_ptr<RTPSessionFacade>(new RTPSessionFacade(type, sendQueueSize));
 	}
 
 	SHARED_PTR_TO(RTPReceiver)
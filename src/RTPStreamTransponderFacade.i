@@ -30,6 +30,10 @@ public:
 
 	virtual void onREMB(const RTPOutgoingSourceGroup* group,DWORD ssrc, DWORD bitrate) override
 	{
+		PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
+		//Track all estimations, even the ones not forwarded to js
+		TRACE_COUNTER("node.transponder", perfetto::CounterTrack("RTPStreamTransponderFacade::REMB", perfetto::Track(ssrc)), bitrate);
+
 		//Check we have not send an update too recently (1s)
 		if (getTimeDiff(last)/1000<period)
 			//Do nothing
@@ -38,8 +42,12 @@ public:
 		//Update it
 		last = getTime();
 		
+		TRACE_EVENT_INSTANT("node.transponder", "RTPStreamTransponderFacade::onREMB", "ssrc", ssrc, "bitrate", bitrate);
+
 		//Run function on main node thread
 		MediaServer::Async([=,cloned=persistent](){
+			PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
+			TRACE_EVENT("node.transponder", "RTPStreamTransponderFacade::onremb", "ssrc", ssrc, "bitrate", bitrate);
 			Nan::HandleScope scope;
 			int i = 0;
 			v8::Local<v8::Value> argv[1];
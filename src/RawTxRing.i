@@ -0,0 +1,260 @@
+%{
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include <sys/mman.h>
+#include <system_error>
+
+struct RawTxRingStats
+{
+	uint32_t frames		= 0;
+	uint32_t pending	= 0;
+	uint32_t maxBatch	= 0;
+	uint64_t queued		= 0;
+	uint64_t flushes	= 0;
+	uint64_t ringFull	= 0;
+	uint64_t sendErrors	= 0;
+	uint64_t wrongFormat	= 0;
+};
+
+/*
+ * RawTxRing
+ *  Sends udp datagrams through an AF_PACKET socket with a PACKET_TX_RING memory mapped ring,
+ *  bypassing the kernel udp/ip stack. Datagrams are written to the ring frames with the prebuilt
+ *  ethernet/ip/udp headers of their route and handed to the kernel all at once on Flush().
+ *  Not thread safe, must be used from a single sending thread.
+ */
+class RawTxRing
+{
+public:
+	static constexpr size_t FrameSize	= 2048;
+	static constexpr size_t BlockSize	= 64 * 1024;
+	static constexpr size_t HeadersSize	= sizeof(ether_header) + sizeof(iphdr) + sizeof(udphdr);
+	static constexpr size_t DataOffset	= TPACKET_ALIGN(sizeof(tpacket2_hdr));
+	static constexpr size_t MaxPayloadSize	= FrameSize - DataOffset - HeadersSize;
+
+	//Prebuilt headers for a destination
+	struct Route
+	{
+		BYTE headers[HeadersSize] = {};
+	};
+
+public:
+	/*
+	 * Create the ring on the interface, throws std::system_error on failure.
+	 * sndbuf is the socket send buffer (0 to keep the default), skipQdisc bypasses the interface
+	 * queueing discipline and frames is the minimum number of frames of the ring.
+	 */
+	RawTxRing(int ifindex, unsigned int sndbuf, bool skipQdisc, size_t frames)
+	{
+		//Create socket, protocol 0 so it never receives
+		fd = socket(AF_PACKET, SOCK_RAW, 0);
+		if (fd < 0)
+			throw std::system_error(errno, std::generic_category(), "could not create AF_PACKET socket");
+
+		try
+		{
+			int version = TPACKET_V2;
+			if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+				throw std::system_error(errno, std::generic_category(), "could not set TPACKET_V2");
+			if (sndbuf && setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) < 0)
+				throw std::system_error(errno, std::generic_category(), "could not set send buffer");
+			int bypass = skipQdisc;
+			if (bypass && setsockopt(fd, SOL_PACKET, PACKET_QDISC_BYPASS, &bypass, sizeof(bypass)) < 0)
+				throw std::system_error(errno, std::generic_category(), "could not bypass qdisc");
+
+			//Set up ring, blocks must be page aligned and hold a whole number of frames
+			size_t framesPerBlock = BlockSize / FrameSize;
+			tpacket_req req = {};
+			req.tp_block_size	= BlockSize;
+			req.tp_frame_size	= FrameSize;
+			req.tp_block_nr		= std::max<size_t>((frames + framesPerBlock - 1) / framesPerBlock, 1);
+			req.tp_frame_nr		= req.tp_block_nr * framesPerBlock;
+			if (setsockopt(fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) < 0)
+				throw std::system_error(errno, std::generic_category(), "could not set PACKET_TX_RING");
+			numFrames = req.tp_frame_nr;
+			ringSize = req.tp_block_size * req.tp_block_nr;
+
+			//Map it
+			void* mapped = mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (mapped == MAP_FAILED)
+				throw std::system_error(errno, std::generic_category(), "could not map tx ring");
+			ring = static_cast<BYTE*>(mapped);
+
+			//Bind to interface
+			sockaddr_ll addr = {};
+			addr.sll_family		= AF_PACKET;
+			addr.sll_protocol	= htons(ETH_P_IP);
+			addr.sll_ifindex	= ifindex;
+			if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0)
+				throw std::system_error(errno, std::generic_category(), "could not bind AF_PACKET socket");
+		}
+		catch (...)
+		{
+			if (ring)
+				munmap(ring, ringSize);
+			close(fd);
+			throw;
+		}
+
+		Log("-RawTxRing::RawTxRing() [ifindex:%d,frames:%zu,sndbuf:%u,skipQdisc:%d]\n", ifindex, numFrames, sndbuf, skipQdisc);
+	}
+
+	~RawTxRing()
+	{
+		//Send anything pending
+		Flush();
+		munmap(ring, ringSize);
+		close(fd);
+	}
+
+	/*
+	 * Build the route headers for a destination, ip addresses and ports in host order
+	 */
+	static bool SetRoute(Route& route, const std::string& selfLladdr, uint32_t selfAddr, const std::string& dstLladdr, uint16_t srcPort, uint32_t dstAddr, uint16_t dstPort)
+	{
+		ether_header eth = {};
+		if (!ParseMac(selfLladdr, eth.ether_shost) || !ParseMac(dstLladdr, eth.ether_dhost))
+			return Error("-RawTxRing::SetRoute() invalid mac address [self:%s,dst:%s]\n", selfLladdr.c_str(), dstLladdr.c_str());
+		eth.ether_type = htons(ETHERTYPE_IP);
+
+		iphdr ip = {};
+		ip.version	= 4;
+		ip.ihl		= sizeof(iphdr) / 4;
+		ip.frag_off	= htons(IP_DF);
+		ip.ttl		= 64;
+		ip.protocol	= IPPROTO_UDP;
+		ip.saddr	= htonl(selfAddr);
+		ip.daddr	= htonl(dstAddr);
+
+		udphdr udp = {};
+		udp.source	= htons(srcPort);
+		udp.dest	= htons(dstPort);
+
+		//Store template
+		memcpy(route.headers, &eth, sizeof(eth));
+		memcpy(route.headers + sizeof(eth), &ip, sizeof(ip));
+		memcpy(route.headers + sizeof(eth) + sizeof(ip), &udp, sizeof(udp));
+		return true;
+	}
+
+	/*
+	 * Queue
+	 *  Write datagram with the route headers on the next ring frame, returns false if ring is full or it does not fit
+	 */
+	bool Queue(const Route& route, const BYTE* data, size_t size)
+	{
+		if (size > MaxPayloadSize)
+			return false;
+
+		//Get next frame
+		auto frame = reinterpret_cast<tpacket2_hdr*>(ring + current * FrameSize);
+		uint32_t status = __atomic_load_n(&frame->tp_status, __ATOMIC_ACQUIRE);
+		//Check previous send failed
+		if (status == TP_STATUS_WRONG_FORMAT)
+		{
+			stats.wrongFormat++;
+			status = TP_STATUS_AVAILABLE;
+		}
+		//If the kernel has not sent it yet
+		if (status != TP_STATUS_AVAILABLE)
+		{
+			stats.ringFull++;
+			return false;
+		}
+
+		//Write headers and payload
+		BYTE* packet = reinterpret_cast<BYTE*>(frame) + DataOffset;
+		memcpy(packet, route.headers, HeadersSize);
+		memcpy(packet + HeadersSize, data, size);
+
+		//Fill lengths, id and checksum
+		auto ip = reinterpret_cast<iphdr*>(packet + sizeof(ether_header));
+		auto udp = reinterpret_cast<udphdr*>(packet + sizeof(ether_header) + sizeof(iphdr));
+		ip->tot_len	= htons(sizeof(iphdr) + sizeof(udphdr) + size);
+		ip->id		= htons(id++);
+		ip->check	= 0;
+		ip->check	= Checksum(ip, sizeof(iphdr));
+		//Udp checksum is optional on ipv4
+		udp->len	= htons(sizeof(udphdr) + size);
+		udp->check	= 0;
+
+		//Hand it to the kernel
+		frame->tp_len = HeadersSize + size;
+		__atomic_store_n(&frame->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+
+		//Next
+		current = (current + 1) % numFrames;
+		stats.pending++;
+		stats.queued++;
+		return true;
+	}
+
+	/*
+	 * Flush
+	 *  Send all the queued frames with a single syscall
+	 */
+	bool Flush()
+	{
+		if (!stats.pending)
+			return true;
+		stats.maxBatch = std::max(stats.maxBatch, stats.pending);
+		stats.pending = 0;
+		stats.flushes++;
+		//Kick the kernel, it will send all frames on SEND_REQUEST status
+		if (send(fd, nullptr, 0, MSG_DONTWAIT) < 0 && errno != EAGAIN && errno != ENOBUFS)
+		{
+			stats.sendErrors++;
+			return Error("-RawTxRing::Flush() send failed [errno:%d]\n", errno);
+		}
+		return true;
+	}
+
+	RawTxRingStats GetStats() const
+	{
+		RawTxRingStats copy = stats;
+		copy.frames = numFrames;
+		return copy;
+	}
+
+private:
+	static bool ParseMac(const std::string& str, uint8_t* mac)
+	{
+		return sscanf(str.c_str(), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]) == 6;
+	}
+
+	static uint16_t Checksum(const void* data, size_t size)
+	{
+		const uint16_t* words = static_cast<const uint16_t*>(data);
+		uint32_t sum = 0;
+		for (size_t i = 0; i < size / 2; ++i)
+			sum += words[i];
+		while (sum >> 16)
+			sum = (sum & 0xFFFF) + (sum >> 16);
+		return ~sum;
+	}
+
+private:
+	int fd = -1;
+	BYTE* ring = nullptr;
+	size_t ringSize = 0;
+	size_t numFrames = 0;
+	size_t current = 0;
+	uint16_t id = 0;
+	RawTxRingStats stats;
+};
+%}
+
+%nodefaultctor RawTxRingStats;
+struct RawTxRingStats
+{
+	uint32_t frames;
+	uint32_t pending;
+	uint32_t maxBatch;
+	uint64_t queued;
+	uint64_t flushes;
+	uint64_t ringFull;
+	uint64_t sendErrors;
+	uint64_t wrongFormat;
+};
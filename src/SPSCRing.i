@@ -0,0 +1,364 @@
+%include "shared_ptr.i"
+
+%{
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/*
+ * SPSCRing
+ *  Bounded lock-free single producer single consumer ring buffer.
+ *  Capacity is rounded up to a power of two and allocated once.
+ */
+template<typename T>
+class SPSCRing
+{
+public:
+	explicit SPSCRing(size_t capacity) :
+		capacity(RoundUp(capacity)),
+		mask(this->capacity - 1),
+		buffer(this->capacity)
+	{
+	}
+
+	bool Push(T&& item)
+	{
+		size_t current = tail.load(std::memory_order_relaxed);
+		//Check if full
+		if (current - head.load(std::memory_order_acquire) == capacity)
+			return false;
+		buffer[current & mask] = std::move(item);
+		tail.store(current + 1, std::memory_order_seq_cst);
+		return true;
+	}
+
+	bool Pop(T& item)
+	{
+		size_t current = head.load(std::memory_order_relaxed);
+		//Check if empty
+		if (current == tail.load(std::memory_order_seq_cst))
+			return false;
+		item = std::move(buffer[current & mask]);
+		head.store(current + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool IsEmpty() const	{ return head.load(std::memory_order_acquire) == tail.load(std::memory_order_seq_cst); }
+	size_t GetSize() const	{ return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+	size_t GetCapacity() const { return capacity; }
+
+	static size_t RoundUp(size_t size)
+	{
+		size_t power = 1;
+		while (power < size)
+			power <<= 1;
+		return power;
+	}
+
+private:
+	const size_t capacity;
+	const size_t mask;
+	std::vector<T> buffer;
+	//Keep producer and consumer indexes on different cache lines
+	alignas(64) std::atomic<size_t> head = 0;
+	alignas(64) std::atomic<size_t> tail = 0;
+};
+
+/*
+ * SPSCAsyncQueue
+ *  Hands items from a producer to a loop. Items are pushed on an SPSCRing and the loop is woken up once
+ *  for all the items queued before it drains them, calling Drain() on the owner if it is still alive.
+ *  Each drain delivers at most maxDrain items and schedules another one if there are more left, so a
+ *  busy producer does not starve the loop. Owners must make Drain() accessible to the queue.
+ *  Items are dropped if the ring is full, unless a backlog is set, in which case they are kept on the
+ *  producer and moved to the ring in order as soon as the loop has made room for them.
+ */
+template<typename T>
+class SPSCAsyncQueue
+{
+public:
+	SPSCAsyncQueue(TimeService& timeService, size_t capacity, size_t maxDrain) :
+		timeService(timeService),
+		ring(std::max<size_t>(capacity, 1)),
+		maxDrain(maxDrain)
+	{
+	}
+
+	/*
+	 * SetBacklog
+	 *  Keep up to maxBacklog items on the producer while the ring is full instead of dropping them. The
+	 *  producer must run on its own loop, which is woken up to move them once the ring has room. Must be
+	 *  called before pushing.
+	 */
+	void SetBacklog(TimeService& producer, size_t maxBacklog)
+	{
+		this->producer = &producer;
+		this->maxBacklog = maxBacklog;
+	}
+
+	/*
+	 * Push
+	 *  Called by a single producer at a time, returns false and counts the item as dropped if it can't be queued
+	 */
+	template<typename Owner>
+	bool Push(T&& item, const std::weak_ptr<Owner>& owner)
+	{
+		//Keep order with the items already waiting
+		if (!backlog.empty())
+			Flush(owner);
+
+		if (backlog.empty() && ring.Push(std::move(item)))
+		{
+			Pushed(1, owner);
+			return true;
+		}
+
+		//Wait until there is room
+		if (backlog.size() < maxBacklog)
+		{
+			backlog.push_back(std::move(item));
+			backlogSize = backlog.size();
+			deferred++;
+			//Loop may have drained the ring before seeing the backlog
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (ring.GetSize() < ring.GetCapacity())
+				Flush(owner);
+			return true;
+		}
+
+		dropped++;
+		return false;
+	}
+
+	/*
+	 * Drain
+	 *  Called on the loop only, delivers the queued items in order to the callback
+	 */
+	template<typename Owner, typename Callback>
+	size_t Drain(const std::weak_ptr<Owner>& owner, Callback&& callback)
+	{
+		//Clear flag before popping, so items pushed after last pop schedule a new drain
+		scheduled = false;
+
+		T item;
+		size_t num = 0;
+		while (num < maxDrain && ring.Pop(item))
+		{
+			callback(item);
+			//Release it before the next one
+			item = {};
+			num++;
+		}
+		delivered += num;
+
+		//If there are still pending items, keep on draining later
+		if (!ring.IsEmpty())
+			Schedule(owner);
+
+		//Wake up producer to move the items waiting for room
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (num && backlogSize && !flushScheduled.exchange(true))
+			producer->Async([this, owner](std::chrono::milliseconds) {
+				//We are owned by it, keep it alive while flushing
+				if (auto shared = owner.lock())
+					Flush(owner);
+			});
+		return num;
+	}
+
+	/*
+	 * DropBacklog
+	 *  Called by the producer only, drops the waiting items matching the predicate
+	 */
+	template<typename Predicate>
+	size_t DropBacklog(Predicate&& predicate)
+	{
+		size_t size = backlog.size();
+		backlog.erase(std::remove_if(backlog.begin(), backlog.end(), predicate), backlog.end());
+		backlogSize = backlog.size();
+		size_t num = size - backlog.size();
+		dropped += num;
+		return num;
+	}
+
+	void CountDropped()		{ dropped++;			}
+
+	bool IsBacklogFull() const	{ return maxBacklog && backlog.size() >= maxBacklog; }
+
+	TimeService& GetTimeService()	{ return timeService;		}
+	bool IsEmpty() const		{ return ring.IsEmpty();	}
+	size_t GetCapacity() const	{ return ring.GetCapacity();	}
+	size_t GetSize() const		{ return ring.GetSize();	}
+	size_t GetMaxDepth() const	{ return maxDepth;		}
+	size_t GetBacklogSize() const	{ return backlogSize;		}
+	uint64_t GetPushed() const	{ return pushed;		}
+	uint64_t GetDelivered() const	{ return delivered;		}
+	uint64_t GetDeferred() const	{ return deferred;		}
+	uint64_t GetDropped() const	{ return dropped;		}
+	uint64_t GetWakeups() const	{ return wakeups;		}
+
+private:
+	/*
+	 * Flush
+	 *  Called by the producer only, moves the waiting items that fit on the ring
+	 */
+	template<typename Owner>
+	void Flush(const std::weak_ptr<Owner>& owner)
+	{
+		//Clear flag before moving, so a drain after this schedules a new flush
+		flushScheduled = false;
+
+		size_t num = 0;
+		while (!backlog.empty() && ring.Push(std::move(backlog.front())))
+		{
+			backlog.pop_front();
+			num++;
+		}
+		backlogSize = backlog.size();
+		if (num)
+			Pushed(num, owner);
+	}
+
+	template<typename Owner>
+	void Pushed(size_t num, const std::weak_ptr<Owner>& owner)
+	{
+		pushed += num;
+
+		//Update max ring depth, only written by the producer
+		size_t depth = ring.GetSize();
+		if (depth > maxDepth)
+			maxDepth = depth;
+
+		//Wake up loop if it is not already going to drain the ring
+		Schedule(owner);
+	}
+
+	template<typename Owner>
+	void Schedule(const std::weak_ptr<Owner>& owner)
+	{
+		if (scheduled.exchange(true))
+			return;
+		wakeups++;
+		timeService.Async([owner](std::chrono::milliseconds) {
+			if (auto shared = owner.lock())
+				shared->Drain();
+		});
+	}
+
+private:
+	TimeService& timeService;
+	SPSCRing<T> ring;
+	const size_t maxDrain;
+	std::atomic<bool> scheduled = false;
+	std::atomic<bool> flushScheduled = false;
+	//Only used by the producer
+	TimeService* producer = nullptr;
+	size_t maxBacklog = 0;
+	std::deque<T> backlog;
+	std::atomic<size_t>   backlogSize = 0;
+	std::atomic<size_t>   maxDepth = 0;
+	std::atomic<uint64_t> pushed = 0;
+	std::atomic<uint64_t> delivered = 0;
+	std::atomic<uint64_t> deferred = 0;
+	std::atomic<uint64_t> dropped = 0;
+	std::atomic<uint64_t> wakeups = 0;
+};
+
+/*
+ * SPSCAsyncQueueTester
+ *  Pushes sequence numbers from a producer loop to a consumer loop, so the drop and backlog paths
+ *  can be tested by blocking the consumer
+ */
+class SPSCAsyncQueueTester :
+	public std::enable_shared_from_this<SPSCAsyncQueueTester>
+{
+public:
+	static std::shared_ptr<SPSCAsyncQueueTester> Create(TimeService& producer, TimeService& consumer, size_t capacity, size_t maxBacklog)
+	{
+		return std::shared_ptr<SPSCAsyncQueueTester>(new SPSCAsyncQueueTester(producer, consumer, capacity, maxBacklog));
+	}
+
+	void Block(DWORD ms)
+	{
+		queue.GetTimeService().Async([ms](std::chrono::milliseconds) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+		});
+	}
+
+	void Push(DWORD num)
+	{
+		producer.Async([weak = weak_from_this(), num](std::chrono::milliseconds) {
+			auto tester = weak.lock();
+			if (!tester)
+				return;
+			for (DWORD i = 0; i < num; ++i)
+				tester->queue.Push(tester->next++, weak);
+		});
+	}
+
+	uint64_t GetDelivered() const	{ return queue.GetDelivered();		}
+	uint64_t GetDeferred() const	{ return queue.GetDeferred();		}
+	uint64_t GetDropped() const	{ return queue.GetDropped();		}
+	size_t GetBacklogSize() const	{ return queue.GetBacklogSize();	}
+	size_t GetSize() const		{ return queue.GetSize();		}
+	bool IsOrdered() const		{ return ordered;			}
+
+private:
+	friend class SPSCAsyncQueue<uint32_t>;
+
+	SPSCAsyncQueueTester(TimeService& producer, TimeService& consumer, size_t capacity, size_t maxBacklog) :
+		producer(producer),
+		queue(consumer, capacity, 64)
+	{
+		queue.SetBacklog(producer, maxBacklog);
+	}
+
+	void Drain()
+	{
+		queue.Drain(weak_from_this(), [this](uint32_t& num) {
+			//Dropped ones leave gaps, but never go back
+			if (received && num < last)
+				ordered = false;
+			received = true;
+			last = num;
+		});
+	}
+
+private:
+	TimeService& producer;
+	SPSCAsyncQueue<uint32_t> queue;
+	//Only used on the producer
+	uint32_t next = 0;
+	//Only used on the consumer
+	uint32_t last = 0;
+	bool received = false;
+	std::atomic<bool> ordered = true;
+};
+%}
+
+%nodefaultctor SPSCAsyncQueueTester;
+class SPSCAsyncQueueTester
+{
+public:
+	void Block(DWORD ms);
+	void Push(DWORD num);
+	uint64_t GetDelivered() const;
+	uint64_t GetDeferred() const;
+	uint64_t GetDropped() const;
+	size_t GetBacklogSize() const;
+	size_t GetSize() const;
+	bool IsOrdered() const;
+};
+
+SHARED_PTR_BEGIN(SPSCAsyncQueueTester)
+{
+	SPSCAsyncQueueTesterShared(TimeService& producer, TimeService& consumer, size_t capacity, size_t maxBacklog)
+	{
+		return new std::shared_ptr<SPSCAsyncQueueTester>(SPSCAsyncQueueTester::Create(producer, consumer, capacity, maxBacklog));
+	}
+}
+SHARED_PTR_END(SPSCAsyncQueueTester)
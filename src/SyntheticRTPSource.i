@@ -0,0 +1,164 @@
+%include "EventLoop.i"
+%include "RTPReceiver.i"
+%include "RTPIncomingSourceGroup.i"
+%include "PacketPool.i"
+
+%{
+/*
+ * SyntheticRTPSource
+ *  Generates rtp packets at a constant rate into incoming source groups, for benchmarking.
+ *  Each payload carries the monotonic generation time in microseconds at offset 1 so it can be
+ *  read back by RTPLatencyProbe after going through the pipeline. First byte is an opus toc.
+ */
+class SyntheticRTPSource :
+	public RTPReceiver
+{
+public:
+	static constexpr size_t MinPayloadSize = 9;
+	static constexpr size_t MaxPayloadSize = 1200;
+
+public:
+	SyntheticRTPSource(DWORD rate, DWORD size) :
+		rate(std::max<DWORD>(rate, 1)),
+		payload(std::clamp<size_t>(size, MinPayloadSize, MaxPayloadSize))
+	{
+		//Opus toc, rest is overwritten on each packet
+		payload[0] = 0xFC;
+		//Start generation thread
+		loop.Start();
+	}
+
+	virtual ~SyntheticRTPSource()
+	{
+		Stop();
+		loop.Stop();
+	}
+
+	virtual int SendPLI(DWORD ssrc) override	{ return 1; }
+	virtual int Reset(DWORD ssrc) override		{ return 1; }
+
+	bool AddIncomingSourceGroup(const RTPIncomingSourceGroupShared& group, const char* codecName)
+	{
+		if (!group)
+			return false;
+		//Get codec
+		BYTE codec = group->type==MediaFrame::Audio
+			? (BYTE)AudioCodec::GetCodecForName(codecName)
+			: (BYTE)VideoCodec::GetCodecForName(codecName);
+		loop.Future([&](std::chrono::milliseconds) {
+			streams.push_back({ group, codec, 0, 0 });
+		}).wait();
+		return true;
+	}
+
+	void Start()
+	{
+		loop.Async([this](std::chrono::milliseconds now) {
+			//Restart counting
+			start = std::chrono::steady_clock::now();
+			sent = 0;
+			//Generate on each ms, sending all packets due since start
+			timer = loop.CreateTimer(std::chrono::milliseconds(1), std::chrono::milliseconds(1), [this](std::chrono::milliseconds now) {
+				Generate(now);
+			});
+		});
+	}
+
+	void Stop()
+	{
+		loop.Future([this](std::chrono::milliseconds) {
+			if (timer)
+				timer->Cancel();
+			timer.reset();
+		}).wait();
+	}
+
+	void Clear()
+	{
+		Stop();
+		loop.Future([this](std::chrono::milliseconds) {
+			streams.clear();
+		}).wait();
+	}
+
+	uint64_t GetGenerated() const	{ return generated;	}
+	TimeService& GetTimeService()	{ return loop;		}
+	PacketPoolStats GetPacketPoolStats() const { return packetPool->GetStats(); }
+
+private:
+	struct Stream
+	{
+		RTPIncomingSourceGroupShared group;
+		BYTE codec;
+		WORD seqNum;
+		DWORD timestamp;
+	};
+
+	void Generate(std::chrono::milliseconds now)
+	{
+		//Get number of rounds that should have been sent by now
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		uint64_t due = elapsed * rate / 1000000;
+
+		//Send pending rounds
+		for (; sent < due; ++sent)
+		{
+			//Get generation time
+			uint64_t ts = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			//For each stream
+			for (auto& stream : streams)
+			{
+				RTPHeader header;
+				header.ssrc		= stream.group->media.ssrc;
+				header.sequenceNumber	= stream.seqNum++;
+				header.timestamp	= stream.timestamp;
+				header.payloadType	= 0;
+				//20ms of 48khz audio, or 90khz video on each round
+				stream.timestamp	+= stream.group->type==MediaFrame::Audio ? 960 : 90000 / rate;
+				//Create packet
+				auto packet = packetPool->MakeShared<RTPPacket>(stream.group->type, stream.codec, header, RTPHeaderExtension());
+				//Set generation time and payload
+				set8(payload.data(), 1, ts);
+				packet->SetPayload(payload.data(), payload.size());
+				//Deliver it
+				stream.group->AddPacket(packet, payload.size() + 12, now.count());
+				generated++;
+			}
+		}
+	}
+
+private:
+	EventLoop loop;
+	DWORD rate;
+	std::vector<BYTE> payload;
+	Timer::shared timer;
+	std::vector<Stream> streams;
+	std::chrono::steady_clock::time_point start;
+	uint64_t sent = 0;
+	std::atomic<uint64_t> generated = 0;
+	std::shared_ptr<PacketPool> packetPool = PacketPool::Create(PacketPool::RTPPacketBlockSize, 0, 0);
+};
+%}
+
+class SyntheticRTPSource
+{
+public:
+	SyntheticRTPSource(DWORD rate, DWORD size);
+	bool AddIncomingSourceGroup(const RTPIncomingSourceGroupShared& group, const char* codecName);
+	void Start();
+	void Stop();
+	void Clear();
+	uint64_t GetGenerated() const;
+	TimeService& GetTimeService();
+	PacketPoolStats GetPacketPoolStats() const;
+};
+
+SHARED_PTR_BEGIN(SyntheticRTPSource)
+{
+	SyntheticRTPSourceShared(DWORD rate, DWORD size)
+	{
+		return new std::shared_ptr<SyntheticRTPSource>(new SyntheticRTPSource(rate, size));
+	}
+	SHARED_PTR_TO(RTPReceiver)
+}
+SHARED_PTR_END(SyntheticRTPSource)
@@ -0,0 +1,426 @@
+%{
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <random>
+#include <vector>
+
+/*
+ * TimerWheel
+ *  Hierarchical timer wheel with 1ms resolution. Timers are intrusive nodes linked on the slot of their
+ *  deadline, so scheduling and cancelling are O(1). The first level has a slot per ms for the current 256ms,
+ *  and each upper level has 64 slots each one covering a whole lower level. When the current time enters
+ *  the range of an upper slot its timers are moved down, so timers are expired in deadline order, and in
+ *  scheduling order for the same deadline. Timers already due are expired on the current ms, and the ones
+ *  beyond the wheel range are parked on the last slot and placed again when it is reached.
+ *  Not thread safe.
+ */
+class TimerWheel
+{
+public:
+	static constexpr size_t Levels		= 5;
+	static constexpr size_t FirstBits	= 8;
+	static constexpr size_t LevelBits	= 6;
+	static constexpr uint64_t FirstSize	= 1 << FirstBits;
+	static constexpr uint64_t LevelSize	= 1 << LevelBits;
+	static constexpr uint64_t Range		= 1ull << (FirstBits + LevelBits * (Levels - 1));
+
+private:
+	struct Slot;
+
+public:
+	class Node
+	{
+	public:
+		bool IsLinked() const		{ return slot;		}
+		uint64_t GetDeadline() const	{ return deadline;	}
+	private:
+		friend class TimerWheel;
+		Node* prev = nullptr;
+		Node* next = nullptr;
+		Slot* slot = nullptr;
+		size_t level = 0;
+		uint64_t deadline = 0;
+	};
+
+public:
+	TimerWheel(uint64_t now = 0) :
+		current(now)
+	{
+	}
+
+	void Insert(Node* node, uint64_t deadline)
+	{
+		if (node->slot)
+			Remove(node);
+		node->deadline = deadline;
+		Place(node);
+		size++;
+	}
+
+	void Remove(Node* node)
+	{
+		if (!node->slot)
+			return;
+		Unlink(node);
+		size--;
+	}
+
+	/*
+	 * PopExpired
+	 *  Get next timer with deadline not after time, moving the wheel forward up to it
+	 */
+	Node* PopExpired(uint64_t time)
+	{
+		while (size)
+		{
+			//Check current slot
+			Slot& slot = wheel[0][current & (FirstSize - 1)];
+			if (slot.head)
+			{
+				Node* node = slot.head;
+				Unlink(node);
+				size--;
+				return node;
+			}
+			//Nothing more due
+			if (current >= time)
+				return nullptr;
+			//Skip to the start of next slot of the first non empty level
+			size_t level = 0;
+			while (level < Levels - 1 && !counts[level])
+				level++;
+			uint64_t mask = (1ull << GetShift(level)) - 1;
+			current = std::min((current | mask) + 1, time);
+			//Move timers down if entering a new block
+			if (!(current & (FirstSize - 1)))
+				Cascade();
+		}
+		//Empty, just move
+		if (time > current)
+			current = time;
+		return nullptr;
+	}
+
+	/*
+	 * GetNextDeadline
+	 *  Get deadline of the next timer to expire, or 0 if empty. Not O(1), scans the first non empty slot of the
+ *  lower levels, or all the timers on the last level.
+	 */
+	uint64_t GetNextDeadline() const
+	{
+		if (!size)
+			return 0;
+		//Check current block in order
+		if (counts[0])
+			for (uint64_t tick = current; ; ++tick)
+				if (const Node* node = wheel[0][tick & (FirstSize - 1)].head)
+					return std::max(node->deadline, current);
+		//Get min on first non empty slot of the upper levels
+		for (size_t level = 1; level < Levels - 1; ++level)
+		{
+			if (!counts[level])
+				continue;
+			size_t shift = GetShift(level);
+			for (uint64_t index = (current >> shift) + 1; ; ++index)
+			{
+				const Slot& slot = wheel[level][index & (LevelSize - 1)];
+				if (!slot.head)
+					continue;
+				uint64_t min = slot.head->deadline;
+				for (const Node* node = slot.head; node; node = node->next)
+					min = std::min(min, node->deadline);
+				return std::max(min, current);
+			}
+		}
+		//Parked timers may be on any slot of the last level, so check all of them
+		uint64_t min = std::numeric_limits<uint64_t>::max();
+		for (const Slot& slot : wheel[Levels - 1])
+			for (const Node* node = slot.head; node; node = node->next)
+				min = std::min(min, node->deadline);
+		return std::max(min, current);
+	}
+
+	size_t GetSize() const		{ return size;		}
+	uint64_t GetCurrent() const	{ return current;	}
+
+private:
+	struct Slot
+	{
+		Node* head = nullptr;
+		Node* tail = nullptr;
+	};
+
+	static size_t GetShift(size_t level)
+	{
+		return level ? FirstBits + LevelBits * (level - 1) : 0;
+	}
+
+	void Place(Node* node)
+	{
+		//Due ones expire now, far ones are parked on the last slot
+		uint64_t deadline = std::clamp(node->deadline, current, current + Range - 1);
+		//Find first level where the deadline shares the upper slot with current time
+		size_t level = 0;
+		while (level < Levels - 1 && (deadline >> GetShift(level + 1)) != (current >> GetShift(level + 1)))
+			level++;
+		uint64_t mask = level ? LevelSize - 1 : FirstSize - 1;
+		Link(node, level, wheel[level][(deadline >> GetShift(level)) & mask]);
+	}
+
+	void Link(Node* node, size_t level, Slot& slot)
+	{
+		//Append, so same deadline timers keep their order
+		node->prev = slot.tail;
+		node->next = nullptr;
+		if (slot.tail)
+			slot.tail->next = node;
+		else
+			slot.head = node;
+		slot.tail = node;
+		node->slot = &slot;
+		node->level = level;
+		counts[level]++;
+	}
+
+	void Unlink(Node* node)
+	{
+		Slot& slot = *node->slot;
+		if (node->prev)
+			node->prev->next = node->next;
+		else
+			slot.head = node->next;
+		if (node->next)
+			node->next->prev = node->prev;
+		else
+			slot.tail = node->prev;
+		node->prev = node->next = nullptr;
+		node->slot = nullptr;
+		counts[node->level]--;
+	}
+
+	void Cascade()
+	{
+		//Move down the slot of each level we have entered
+		for (size_t level = 1; level < Levels; ++level)
+		{
+			size_t shift = GetShift(level);
+			Slot& slot = wheel[level][(current >> shift) & (LevelSize - 1)];
+			//Get list and place again in order
+			Node* node = slot.head;
+			while (node)
+			{
+				Node* next = node->next;
+				Unlink(node);
+				Place(node);
+				node = next;
+			}
+			//Upper levels only change when this one wraps
+			if ((current >> shift) & (LevelSize - 1))
+				break;
+		}
+	}
+
+private:
+	uint64_t current;
+	size_t size = 0;
+	std::array<size_t, Levels> counts = {};
+	std::array<std::array<Slot, FirstSize>, Levels> wheel = {};
+};
+
+/*
+ * TimerWheelTester
+ *  Timer wheel with timers identified by index, so it can be checked against a reference implementation
+ */
+class TimerWheelTester
+{
+public:
+	TimerWheelTester(DWORD timers, uint64_t now) :
+		wheel(now),
+		nodes(timers)
+	{
+	}
+
+	void Schedule(DWORD id, uint64_t deadline)
+	{
+		if (id < nodes.size())
+			wheel.Insert(&nodes[id], deadline);
+	}
+
+	void Cancel(DWORD id)
+	{
+		if (id < nodes.size())
+			wheel.Remove(&nodes[id]);
+	}
+
+	//Get id of next expired timer, or -1 if none
+	int PopExpired(uint64_t time)
+	{
+		TimerWheel::Node* node = wheel.PopExpired(time);
+		return node ? node - nodes.data() : -1;
+	}
+
+	bool IsScheduled(DWORD id) const	{ return id < nodes.size() && nodes[id].IsLinked();	}
+	uint64_t GetNextDeadline() const	{ return wheel.GetNextDeadline();			}
+	size_t GetSize() const			{ return wheel.GetSize();				}
+	uint64_t GetCurrent() const		{ return wheel.GetCurrent();				}
+
+private:
+	TimerWheel wheel;
+	std::vector<TimerWheel::Node> nodes;
+};
+
+struct TimerBenchmarkResult
+{
+	uint32_t timers		= 0;
+	uint64_t operations	= 0;
+	uint64_t expired	= 0;
+	double scheduleNs	= 0;
+	double cancelNs		= 0;
+	double expireNs		= 0;
+};
+
+/*
+ * TimerBenchmark
+ *  Compares the timer wheel against an ordered multimap, the container used before by the time services
+ *  implemented on the bindings, under rtcp/nack like churn: a population of timers is kept scheduled,
+ *  half of them are rescheduled or cancelled and scheduled again each ms and the due ones are expired.
+ */
+class TimerBenchmark
+{
+public:
+	static TimerBenchmarkResult RunWheel(DWORD timers, DWORD duration, DWORD maxTimeout)
+	{
+		TimerWheel wheel;
+		std::vector<TimerWheel::Node> nodes(timers);
+		return Run(timers, duration, maxTimeout,
+			[&](size_t i, uint64_t deadline) { wheel.Insert(&nodes[i], deadline); },
+			[&](size_t i) { wheel.Remove(&nodes[i]); },
+			[&](uint64_t now) {
+				size_t num = 0;
+				while (wheel.PopExpired(now))
+					num++;
+				return num;
+			});
+	}
+
+	static TimerBenchmarkResult RunMultimap(DWORD timers, DWORD duration, DWORD maxTimeout)
+	{
+		using Map = std::multimap<uint64_t, size_t>;
+		Map map;
+		std::vector<Map::iterator> its(timers, map.end());
+		return Run(timers, duration, maxTimeout,
+			[&](size_t i, uint64_t deadline) {
+				if (its[i] != map.end())
+					map.erase(its[i]);
+				its[i] = map.emplace(deadline, i);
+			},
+			[&](size_t i) {
+				if (its[i] == map.end())
+					return;
+				map.erase(its[i]);
+				its[i] = map.end();
+			},
+			[&](uint64_t now) {
+				size_t num = 0;
+				while (!map.empty() && map.begin()->first <= now)
+				{
+					its[map.begin()->second] = map.end();
+					map.erase(map.begin());
+					num++;
+				}
+				return num;
+			});
+	}
+
+private:
+	template<typename Schedule, typename Cancel, typename Expire>
+	static TimerBenchmarkResult Run(DWORD timers, DWORD duration, DWORD maxTimeout, Schedule&& schedule, Cancel&& cancel, Expire&& expire)
+	{
+		using Clock = std::chrono::steady_clock;
+		TimerBenchmarkResult result;
+		result.timers = timers;
+		if (!timers || !maxTimeout)
+			return result;
+
+		//Same sequence for all containers
+		std::mt19937 rand(timers);
+		std::uniform_int_distribution<size_t> pick(0, timers - 1);
+		std::uniform_int_distribution<uint64_t> timeout(1, maxTimeout);
+
+		Clock::duration scheduling = {}, cancelling = {}, expiring = {};
+		uint64_t scheduled = 0, cancelled = 0;
+
+		//Initial population
+		auto start = Clock::now();
+		for (size_t i = 0; i < timers; ++i)
+			schedule(i, timeout(rand));
+		scheduling += Clock::now() - start;
+		scheduled += timers;
+
+		//Run each ms
+		size_t churn = std::max<size_t>(timers / 2, 1);
+		for (uint64_t now = 1; now <= duration; ++now)
+		{
+			//Cancel a quarter
+			start = Clock::now();
+			for (size_t j = 0; j < churn / 2; ++j)
+				cancel(pick(rand));
+			cancelling += Clock::now() - start;
+			cancelled += churn / 2;
+
+			//Reschedule the rest
+			start = Clock::now();
+			for (size_t j = 0; j < churn; ++j)
+				schedule(pick(rand), now + timeout(rand));
+			scheduling += Clock::now() - start;
+			scheduled += churn;
+
+			//Expire due ones
+			start = Clock::now();
+			result.expired += expire(now);
+			expiring += Clock::now() - start;
+		}
+
+		result.operations	= scheduled + cancelled;
+		result.scheduleNs	= (double)std::chrono::duration_cast<std::chrono::nanoseconds>(scheduling).count() / scheduled;
+		result.cancelNs		= (double)std::chrono::duration_cast<std::chrono::nanoseconds>(cancelling).count() / std::max<uint64_t>(cancelled, 1);
+		result.expireNs		= (double)std::chrono::duration_cast<std::chrono::nanoseconds>(expiring).count() / std::max<uint64_t>(result.expired, 1);
+		return result;
+	}
+};
+%}
+
+class TimerWheelTester
+{
+public:
+	TimerWheelTester(DWORD timers, uint64_t now);
+	void Schedule(DWORD id, uint64_t deadline);
+	void Cancel(DWORD id);
+	int PopExpired(uint64_t time);
+	bool IsScheduled(DWORD id) const;
+	uint64_t GetNextDeadline() const;
+	size_t GetSize() const;
+	uint64_t GetCurrent() const;
+};
+
+%nodefaultctor TimerBenchmarkResult;
+struct TimerBenchmarkResult
+{
+	uint32_t timers;
+	uint64_t operations;
+	uint64_t expired;
+	double scheduleNs;
+	double cancelNs;
+	double expireNs;
+};
+
+%nodefaultctor TimerBenchmark;
+class TimerBenchmark
+{
+public:
+	static TimerBenchmarkResult RunWheel(DWORD timers, DWORD duration, DWORD maxTimeout);
+	static TimerBenchmarkResult RunMultimap(DWORD timers, DWORD duration, DWORD maxTimeout);
+};
@@ -0,0 +1,176 @@
+%{
+#include <sstream>
+
+/*
+ * TracingFacade
+ *  Controls the in-process Perfetto backend so traces can be captured on demand, without
+ *  the tracing daemon. Only one in-process session can be active at a time.
+ */
+class TracingFacade
+{
+public:
+	/*
+	 * Start
+	 *  Start writing a trace to the file descriptor. Categories is a comma separated list of
+	 *  enabled track event categories (all if empty), buffer size is in KB and duration in ms
+	 *  (0 means until stopped). The object onstopped method is called once the trace is written.
+	 */
+	static bool Start(v8::Local<v8::Object> object, int fd, const std::string& categories, uint32_t bufferSize, uint32_t duration)
+	{
+#ifdef MEDOOZE_NO_PERFETTO
+		return Error("-TracingFacade::Start() built without perfetto\n");
+#else
+		//Only one session at a time
+		if (session)
+			return Error("-TracingFacade::Start() tracing session already active\n");
+
+		//Ensure the in-process backend is available
+		Initialize();
+
+		//Enable requested categories only
+		perfetto::protos::gen::TrackEventConfig trackEvent;
+		std::istringstream stream(categories);
+		std::string category;
+		while (std::getline(stream, category, ','))
+			if (!category.empty())
+				trackEvent.add_enabled_categories(category);
+		//If any was requested, disable the rest
+		if (trackEvent.enabled_categories_size())
+			trackEvent.add_disabled_categories("*");
+
+		perfetto::TraceConfig config;
+		config.add_buffers()->set_size_kb(bufferSize);
+		//Stop by itself after duration
+		if (duration)
+			config.set_duration_ms(duration);
+		auto dataSource = config.add_data_sources()->mutable_config();
+		dataSource->set_name("track_event");
+		dataSource->set_track_event_config_raw(trackEvent.SerializeAsString());
+
+		//Create in-process session
+		session = perfetto::Tracing::NewTrace(perfetto::kInProcessBackend);
+		if (!session)
+			return Error("-TracingFacade::Start() could not create tracing session\n");
+
+		//Notify js when trace has been written, called from the perfetto thread
+		session->SetOnStopCallback([persistent = MediaServer::MakeSharedPersistent(object)]() {
+			MediaServer::Async([cloned = persistent]() {
+				Nan::HandleScope scope;
+				//Session is finished
+				TracingFacade::session.reset();
+				//Call object method
+				MakeCallback(cloned, "onstopped");
+			});
+		});
+
+		//Write to file descriptor
+		session->Setup(config, fd);
+		session->StartBlocking();
+
+		Log("-TracingFacade::Start() [fd:%d,categories:%s,bufferSize:%u,duration:%u]\n", fd, categories.c_str(), bufferSize, duration);
+
+		return true;
+#endif
+	}
+
+	/*
+	 * Stop
+	 *  Flush and stop the active session asynchronously, onstopped will be called when done
+	 */
+	static bool Stop()
+	{
+#ifndef MEDOOZE_NO_PERFETTO
+		if (!session)
+			return false;
+		Log("-TracingFacade::Stop()\n");
+		//Stop it, data sources are flushed before the callback is called
+		session->Stop();
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	static bool IsActive()
+	{
+#ifndef MEDOOZE_NO_PERFETTO
+		return !!session;
+#else
+		return false;
+#endif
+	}
+
+	/*
+	 * Js events
+	 *  Written on the track of the calling thread, so they show on the Node.js main thread track
+	 */
+	static bool IsEnabled()
+	{
+		PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
+		return TRACE_EVENT_CATEGORY_ENABLED("node.js");
+	}
+
+	static void Begin(const std::string& name)
+	{
+		PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
+		TRACE_EVENT_BEGIN("node.js", perfetto::DynamicString{name});
+	}
+
+	static void End()
+	{
+		PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
+		TRACE_EVENT_END("node.js");
+	}
+
+	static void Instant(const std::string& name)
+	{
+		PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
+		TRACE_EVENT_INSTANT("node.js", perfetto::DynamicString{name});
+	}
+
+	static void Counter(const std::string& name, double value)
+	{
+		PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(medooze_node);
+		TRACE_COUNTER("node.js", perfetto::CounterTrack(perfetto::DynamicString{name}), value);
+	}
+
+	/*
+	 * Initialize
+	 *  Initialize perfetto with in-process backend if it was not done at load time
+	 */
+	static void Initialize()
+	{
+#ifndef MEDOOZE_NO_PERFETTO
+		if (perfetto::Tracing::IsInitialized())
+			return;
+		perfetto::TracingInitArgs args;
+		args.backends |= perfetto::kInProcessBackend;
+		perfetto::Tracing::Initialize(args);
+		MedoozeTrackEventRegister();
+		medooze_node::TrackEvent::Register();
+#endif
+	}
+
+#ifndef MEDOOZE_NO_PERFETTO
+private:
+	static std::unique_ptr<perfetto::TracingSession> session;
+#endif
+};
+
+#ifndef MEDOOZE_NO_PERFETTO
+std::unique_ptr<perfetto::TracingSession> TracingFacade::session;
+#endif
+%}
+
+class TracingFacade
+{
+public:
+	static bool Start(v8::Local<v8::Object> object, int fd, const std::string& categories, uint32_t bufferSize, uint32_t duration);
+	static bool Stop();
+	static bool IsActive();
+	static bool IsEnabled();
+	static void Begin(const std::string& name);
+	static void End();
+	static void Instant(const std::string& name);
+	static void Counter(const std::string& name, double value);
+};
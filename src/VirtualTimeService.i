@@ -0,0 +1,342 @@
+%include "EventLoop.i"
+%include "TimerWheel.i"
+
+%{
+#include <condition_variable>
+#include <future>
+#include <deque>
+
+/*
+ * VirtualTimeService
+ *  Time service whose clock only moves when it is explicitly advanced by its owner.
+ *  Timers fire in deadline order (and creation order on ties) so runs are deterministic
+ *  and can go as fast as the cpu allows. All callbacks are executed on the thread
+ *  calling RunPending/AdvanceTo. Timers are kept on a timer wheel, so scheduling and
+ *  cancelling them is O(1) regardless of how many there are.
+ */
+class VirtualTimeService : public TimeService
+{
+private:
+	class VirtualTimer :
+		public Timer,
+		public TimerWheel::Node,
+		public std::enable_shared_from_this<VirtualTimer>
+	{
+	public:
+		VirtualTimer(VirtualTimeService& timeService, const std::chrono::milliseconds& repeat, const std::function<void(std::chrono::milliseconds)>& callback) :
+			timeService(timeService),
+			repeat(repeat),
+			callback(callback)
+		{
+		}
+
+		virtual ~VirtualTimer()
+		{
+			//Remove it from the wheel
+			timeService.Unschedule(this);
+		}
+
+		virtual void Cancel() override
+		{
+			timeService.Unschedule(this);
+		}
+
+		virtual void Again(const std::chrono::milliseconds& ms) override
+		{
+			timeService.Schedule(shared_from_this(), timeService.GetNow() + ms);
+		}
+
+		virtual void Reschedule(const std::chrono::milliseconds& ms, const std::chrono::milliseconds& repeat) override
+		{
+			this->repeat = repeat;
+			Again(ms);
+		}
+
+		virtual bool IsScheduled()				const override { return scheduled;	}
+		virtual std::chrono::milliseconds GetNextTick()		const override { return next;		}
+		virtual std::chrono::milliseconds GetRepeat()		const override { return repeat;		}
+		virtual void SetName(const std::string& name)		override { this->name = name;		}
+		virtual const std::string& GetName()			const override { return name;		}
+
+	private:
+		friend class VirtualTimeService;
+
+		VirtualTimeService& timeService;
+		std::chrono::milliseconds repeat;
+		std::function<void(std::chrono::milliseconds)> callback;
+		std::chrono::milliseconds next = std::chrono::milliseconds(0);
+		bool scheduled = false;
+		std::string name;
+	};
+
+public:
+	VirtualTimeService(const std::chrono::milliseconds& start = std::chrono::milliseconds(getTimeMS())) :
+		now(start),
+		timers(start.count())
+	{
+	}
+
+	virtual ~VirtualTimeService() = default;
+
+	virtual const std::chrono::milliseconds GetNow() const override
+	{
+		return now.load();
+	}
+
+	virtual Timer::shared CreateTimer(const std::function<void(std::chrono::milliseconds)>& callback) override
+	{
+		return std::make_shared<VirtualTimer>(*this, std::chrono::milliseconds(0), callback);
+	}
+
+	virtual Timer::shared CreateTimer(const std::chrono::milliseconds& ms, const std::function<void(std::chrono::milliseconds)>& callback) override
+	{
+		return CreateTimer(ms, std::chrono::milliseconds(0), callback);
+	}
+
+	virtual Timer::shared CreateTimer(const std::chrono::milliseconds& ms, const std::chrono::milliseconds& repeat, const std::function<void(std::chrono::milliseconds)>& callback) override
+	{
+		auto timer = std::make_shared<VirtualTimer>(*this, repeat, callback);
+		//Schedule it
+		Schedule(timer, GetNow() + ms);
+		//Done
+		return timer;
+	}
+
+	virtual void Async(const std::function<void(std::chrono::milliseconds)>& func) override
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			//Enqueue task
+			tasks.push_back(func);
+		}
+		//Wake up owner
+		cond.notify_one();
+	}
+
+	virtual std::future<void> Future(const std::function<void(std::chrono::milliseconds)>& func) override
+	{
+		auto promise = std::make_shared<std::promise<void>>();
+		//If we are already on the running thread
+		if (std::this_thread::get_id() == owner)
+		{
+			//Execute now
+			func(GetNow());
+			promise->set_value();
+		} else {
+			//Execute it on next run
+			Async([func, promise](std::chrono::milliseconds now) {
+				func(now);
+				promise->set_value();
+			});
+		}
+		return promise->get_future();
+	}
+
+	/*
+	 * SetOwner
+	 *  Set thread that runs the tasks and timers
+	 */
+	void SetOwner(std::thread::id id)
+	{
+		owner = id;
+	}
+
+	/*
+	 * RunPending
+	 *  Run all the queued async tasks at current time
+	 */
+	size_t RunPending()
+	{
+		size_t num = 0;
+		std::deque<std::function<void(std::chrono::milliseconds)>> pending;
+		//Run until no more tasks have been queued by the executed ones
+		while (true)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				pending.swap(tasks);
+			}
+			if (pending.empty())
+				return num;
+			for (auto& task : pending)
+				task(GetNow());
+			num += pending.size();
+			pending.clear();
+		}
+	}
+
+	/*
+	 * AdvanceTo
+	 *  Move the clock forward, firing all timers due on the way at their scheduled time
+	 */
+	void AdvanceTo(const std::chrono::milliseconds& time)
+	{
+		//Run anything queued before moving the clock
+		RunPending();
+		//Fire timers in order
+		while (auto timer = PopExpired(time))
+		{
+			//Timer time becomes the current time
+			if (timer->next > now.load())
+				now = timer->next;
+			//Reschedule repetitive timers before firing so they can cancel themselves
+			if (timer->repeat.count())
+				Schedule(timer, timer->next + timer->repeat);
+			//Fire it
+			timer->callback(GetNow());
+			//Run tasks generated by the timer
+			RunPending();
+		}
+		//Never go backwards
+		if (time > now.load())
+			now = time;
+	}
+
+	/*
+	 * GetNextTimeout
+	 *  Get deadline of next scheduled timer, or 0 if none
+	 */
+	std::chrono::milliseconds GetNextTimeout()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return std::chrono::milliseconds(timers.GetNextDeadline());
+	}
+
+	/*
+	 * Wait
+	 *  Block the owner thread until a task is queued or Signal is called
+	 */
+	void Wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cond.wait(lock, [this] { return signaled || !tasks.empty(); });
+		signaled = false;
+	}
+
+	void Signal()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			signaled = true;
+		}
+		cond.notify_one();
+	}
+
+private:
+	void Schedule(const std::shared_ptr<VirtualTimer>& timer, const std::chrono::milliseconds& when)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		//Insert at the end of the timers with same deadline, removing previous schedule
+		timer->next = when;
+		timers.Insert(timer.get(), when.count());
+		timer->scheduled = true;
+	}
+
+	void Unschedule(VirtualTimer* timer)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		//If not scheduled
+		if (!timer->scheduled)
+			return;
+		timers.Remove(timer);
+		timer->scheduled = false;
+		timer->next = std::chrono::milliseconds(0);
+	}
+
+	std::shared_ptr<VirtualTimer> PopExpired(const std::chrono::milliseconds& time)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while (auto node = timers.PopExpired(time.count()))
+		{
+			auto expired = static_cast<VirtualTimer*>(node);
+			expired->scheduled = false;
+			//Skip timers being released, they can't be fired
+			if (auto timer = expired->weak_from_this().lock())
+				return timer;
+		}
+		return nullptr;
+	}
+
+private:
+	std::atomic<std::chrono::milliseconds> now;
+	std::thread::id owner;
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool signaled = false;
+	std::deque<std::function<void(std::chrono::milliseconds)>> tasks;
+	TimerWheel timers;
+};
+
+/*
+ * TimerOrderTester
+ *  Creates timers on a time service and records the order in which they fire and how long after
+ *  their creation, so tests can check that virtual time replays fire them at their deadline
+ */
+class TimerOrderTester
+{
+public:
+	TimerOrderTester(TimeService& timeService) :
+		timeService(timeService),
+		fired(std::make_shared<Fired>())
+	{
+	}
+
+	~TimerOrderTester()
+	{
+		for (auto& timer : timers)
+			timer->Cancel();
+	}
+
+	void Schedule(DWORD id, DWORD ms)
+	{
+		//Timers are created on the time service thread
+		timeService.Future([&](std::chrono::milliseconds) {
+			auto created = timeService.GetNow();
+			//Fired timers may outlive us
+			timers.push_back(timeService.CreateTimer(std::chrono::milliseconds(ms), [fired = fired, id, created](std::chrono::milliseconds now) {
+				std::lock_guard<std::mutex> lock(fired->mutex);
+				fired->timers.emplace_back(id, (now - created).count());
+			}));
+		}).wait();
+	}
+
+	DWORD GetFired()
+	{
+		std::lock_guard<std::mutex> lock(fired->mutex);
+		return fired->timers.size();
+	}
+
+	int GetFiredId(DWORD i)
+	{
+		std::lock_guard<std::mutex> lock(fired->mutex);
+		return i < fired->timers.size() ? fired->timers[i].first : -1;
+	}
+
+	uint64_t GetFiredDelay(DWORD i)
+	{
+		std::lock_guard<std::mutex> lock(fired->mutex);
+		return i < fired->timers.size() ? fired->timers[i].second : 0;
+	}
+
+private:
+	struct Fired
+	{
+		std::mutex mutex;
+		std::vector<std::pair<DWORD, uint64_t>> timers;
+	};
+
+	TimeService& timeService;
+	std::shared_ptr<Fired> fired;
+	std::vector<Timer::shared> timers;
+};
+%}
+
+class TimerOrderTester
+{
+public:
+	TimerOrderTester(TimeService& timeService);
+	void Schedule(DWORD id, DWORD ms);
+	DWORD GetFired();
+	int GetFiredId(DWORD i);
+	uint64_t GetFiredDelay(DWORD i);
+};
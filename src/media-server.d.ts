@@ -35,6 +35,493 @@ export  class MediaServer {
   constructor();
 }
 
+export  class TracingFacade {
+
+ static Start(object: any, fd: number, categories: string, bufferSize: number, duration: number): boolean;
+
+ static Stop(): boolean;
+
+ static IsActive(): boolean;
+
+ static IsEnabled(): boolean;
+
+ static Begin(name: string): void;
+
+ static End(): void;
+
+ static Instant(name: string): void;
+
+ static Counter(name: string, value: number): void;
+
+  constructor();
+}
+
+export  class SyntheticRTPSource {
+
+  constructor(rate: number, size: number);
+
+  AddIncomingSourceGroup(group: RTPIncomingSourceGroupShared, codecName: string): boolean;
+
+  Start(): void;
+
+  Stop(): void;
+
+  Clear(): void;
+
+  GetGenerated(): number;
+
+  GetTimeService(): TimeService;
+
+  GetPacketPoolStats(): PacketPoolStats;
+}
+
+export  class SyntheticRTPSourceShared {
+
+  constructor(rate: number, size: number);
+
+  toRTPReceiver(): RTPReceiverShared;
+
+  get(): SyntheticRTPSource;
+}
+
+export  class PacketPoolStats {
+
+  capacity: number;
+
+  maxSize: number;
+
+  outstanding: number;
+
+  highWaterMark: number;
+
+  hits: number;
+
+  misses: number;
+
+  grows: number;
+
+  overflows: number;
+}
+
+export  class PacketPool {
+
+  GetStats(): PacketPoolStats;
+}
+
+export  class PacketPoolShared {
+
+  constructor(size: number, maxSize: number);
+
+  get(): PacketPool;
+}
+
+export  class PacketPoolTester {
+
+  constructor(pool: PacketPoolShared);
+
+  Allocate(num: number): boolean;
+
+  Release(num: number): void;
+
+  ReleaseOnThread(num: number): void;
+
+  GetAllocated(): number;
+}
+
+export  class RTPLatencyProbeStats {
+
+  packets: number;
+
+  overflow: number;
+
+  min: number;
+
+  p50: number;
+
+  p90: number;
+
+  p99: number;
+
+  p999: number;
+
+  max: number;
+}
+
+export  class RTPLatencyProbe {
+
+  constructor();
+
+  AddIncoming(incoming: RTPIncomingMediaStream): void;
+
+  RemoveIncoming(incoming: RTPIncomingMediaStream): void;
+
+  Reset(): void;
+
+  GetStats(): RTPLatencyProbeStats;
+}
+
+export  class LayerSelection {
+
+  position: number;
+
+  index: number;
+
+  minPosition: number;
+
+  minIndex: number;
+}
+
+export  class LayerSelector {
+
+  constructor();
+
+  Clear(): void;
+
+  AddLayer(bitrate: number, targetBitrate: number, spatialLayerId: number, temporalLayerId: number, simulcastIdx: number, width: number, height: number): void;
+
+  Prepare(traversal: number, maxSpatialLayerId: number, maxTemporalLayerId: number, maxWidth: number, maxHeight: number): number;
+
+  GetSize(id: number): number;
+
+  GetIndex(id: number, position: number): number;
+
+  Select(id: number, target: number): LayerSelection;
+}
+
+export  class RTPLayerFanoutStats {
+
+  groups: number;
+
+  listeners: number;
+
+  packets: number;
+
+  forwarded: number;
+
+  dropped: number;
+
+  rewritten: number;
+}
+
+export  class RTPLayerFanout {
+
+  GetGroup(spatialLayerId: number, temporalLayerId: number): RTPIncomingMediaStreamShared;
+
+  Stop(): void;
+
+  GetStats(): RTPLayerFanoutStats;
+}
+
+export  class RTPLayerFanoutShared {
+
+  constructor(incoming: RTPIncomingMediaStreamShared, packetPool: PacketPoolShared);
+
+  get(): RTPLayerFanout;
+}
+
+export  class SPSCAsyncQueueTester {
+
+  Block(ms: number): void;
+
+  Push(num: number): void;
+
+  GetDelivered(): number;
+
+  GetDeferred(): number;
+
+  GetDropped(): number;
+
+  GetBacklogSize(): number;
+
+  GetSize(): number;
+
+  IsOrdered(): boolean;
+}
+
+export  class SPSCAsyncQueueTesterShared {
+
+  constructor(producer: TimeService, consumer: TimeService, capacity: number, maxBacklog: number);
+
+  get(): SPSCAsyncQueueTester;
+}
+
+export  class MediaFrameMirrorStats {
+
+  capacity: number;
+
+  depth: number;
+
+  maxDepth: number;
+
+  backlog: number;
+
+  pushed: number;
+
+  delivered: number;
+
+  deferred: number;
+
+  dropped: number;
+
+  wakeups: number;
+}
+
+export  class MediaFrameHub {
+
+  GetMirrors(): number;
+
+  GetFrames(): number;
+}
+
+export  class MediaFrameHubShared {
+
+  constructor(producer: MediaFrameProducerShared, timeService: TimeService);
+
+  get(): MediaFrameHub;
+}
+
+export  class MediaFrameMirror extends MediaFrameProducer {
+
+  Stop(): void;
+
+  GetStats(): MediaFrameMirrorStats;
+}
+
+export  class MediaFrameMirrorShared {
+
+  constructor(hub: MediaFrameHubShared, timeService: TimeService, capacity: number);
+
+  toMediaFrameProducer(): MediaFrameProducerShared;
+
+  get(): MediaFrameMirror;
+}
+
+export  class MediaFrameMirrorTester {
+
+  Block(ms: number): void;
+
+  Push(num: number, interval: number): void;
+
+  Stop(): void;
+
+  GetStats(): MediaFrameMirrorStats;
+
+  GetReceived(): number;
+
+  GetIntras(): number;
+
+  GetUndecodable(): number;
+
+  GetLast(): number;
+}
+
+export  class MediaFrameMirrorTesterShared {
+
+  constructor(origin: TimeService, timeService: TimeService, capacity: number);
+
+  get(): MediaFrameMirrorTester;
+}
+
+export  class RTPLoopChannelStats {
+
+  bridges: number;
+
+  capacity: number;
+
+  depth: number;
+
+  maxDepth: number;
+
+  backlog: number;
+
+  pushed: number;
+
+  delivered: number;
+
+  deferred: number;
+
+  dropped: number;
+
+  wakeups: number;
+}
+
+export  class RTPIncomingMediaStreamBridge extends RTPIncomingMediaStream {
+
+  Stop(): void;
+
+  GetChannelStats(): RTPLoopChannelStats;
+
+  GetDropped(): number;
+}
+
+export  class RTPIncomingMediaStreamBridgeShared {
+
+  constructor(incomingMediaStream: RTPIncomingMediaStreamShared, timeService: TimeService | EventLoop, capacity: number);
+
+  toRTPIncomingMediaStream(): RTPIncomingMediaStreamShared;
+
+  get(): RTPIncomingMediaStreamBridge;
+}
+
+export  class EventLoopPoolStats {
+
+  size: number;
+
+  borrowed: number;
+
+  minLoad: number;
+
+  maxLoad: number;
+}
+
+export  class EventLoopPool {
+
+  constructor(size: number, firstCore: number, name: string);
+
+  Borrow(): TimeService;
+
+  Return(timeService: TimeService): boolean;
+
+  Owns(timeService: TimeService): boolean;
+
+  Stop(): void;
+
+  GetSize(): number;
+
+  GetLoad(index: number): number;
+
+  GetStats(): EventLoopPoolStats;
+}
+
+export  class TimerWheelTester {
+
+  constructor(timers: number, now: number);
+
+  Schedule(id: number, deadline: number): void;
+
+  Cancel(id: number): void;
+
+  PopExpired(time: number): number;
+
+  IsScheduled(id: number): boolean;
+
+  GetNextDeadline(): number;
+
+  GetSize(): number;
+
+  GetCurrent(): number;
+}
+
+export  class TimerBenchmarkResult {
+
+  timers: number;
+
+  operations: number;
+
+  expired: number;
+
+  scheduleNs: number;
+
+  cancelNs: number;
+
+  expireNs: number;
+}
+
+export  class TimerBenchmark {
+
+  static RunWheel(timers: number, duration: number, maxTimeout: number): TimerBenchmarkResult;
+
+  static RunMultimap(timers: number, duration: number, maxTimeout: number): TimerBenchmarkResult;
+}
+
+export  class EventLoopLoadStats {
+
+  period: number;
+
+  samples: number;
+
+  elapsed: number;
+
+  busy: number;
+
+  idle: number;
+
+  load: number;
+
+  wakeups: number;
+
+  preemptions: number;
+
+  timerLagAvg: number;
+
+  timerLagMax: number;
+
+  asyncDelay: number;
+
+  asyncDelayMax: number;
+
+  asyncPending: number;
+}
+
+export  class EventLoopMonitor {
+
+  Stop(): void;
+
+  GetStats(): EventLoopLoadStats;
+
+  GetTimerLagBuckets(): number;
+
+  GetTimerLagBound(index: number): number;
+
+  GetTimerLagCount(index: number): number;
+}
+
+export  class EventLoopMonitorShared {
+
+  constructor(timeService: TimeService, period: number);
+
+  get(): EventLoopMonitor;
+}
+
+export  class DTLSHandshakeStats {
+
+  started: number;
+
+  connected: number;
+
+  failed: number;
+
+  aborted: number;
+
+  pending: number;
+
+  maxPending: number;
+
+  latencyLast: number;
+
+  latencyAvg: number;
+
+  latencyMax: number;
+}
+
+export  class DTLSHandshakeMonitor {
+
+  GetStats(): DTLSHandshakeStats;
+
+  GetLatencyBuckets(): number;
+
+  GetLatencyBound(index: number): number;
+
+  GetLatencyCount(index: number): number;
+}
+
+export  class DTLSHandshakeMonitorShared {
+
+  constructor();
+
+  get(): DTLSHandshakeMonitor;
+}
+
 export  class ActiveSpeakerDetectorFacade {
 
   constructor(object: any);
@@ -413,6 +900,8 @@ export  class RTPIncomingSourceGroupShared {
 export  class DTLSICETransportListener {
 
   constructor(object: any);
+
+  SetHandshakeMonitor(monitor: DTLSHandshakeMonitorShared): void;
 }
 
 export  class DTLSICETransportListenerShared {
@@ -538,6 +1027,25 @@ export  class MediaFrameReaderShared {
   get(): MediaFrameReader;
 }
 
+export  class MP4RecorderTimeShiftStats {
+
+  capacity: number;
+
+  used: number;
+
+  highWaterMark: number;
+
+  frames: number;
+
+  maxFrames: number;
+
+  window: number;
+
+  evicted: number;
+
+  dropped: number;
+}
+
 export  class MP4RecorderFacade extends MediaFrameListener {
 
   constructor(object: any);
@@ -550,7 +1058,9 @@ export  class MP4RecorderFacade extends MediaFrameListener {
 
   Close(): boolean;
 
-  SetTimeShiftDuration(duration: number): void;
+  SetTimeShiftDuration(duration: number, bitrate: number): void;
+
+  GetTimeShiftStats(): MP4RecorderTimeShiftStats;
 
   SetH264ParameterSets(sprops: string): boolean;
 
@@ -581,6 +1091,42 @@ export abstract class UDPReader {
   Close(): boolean;
 }
 
+export  class MMapPCAPReader extends UDPReader {
+
+  constructor();
+
+  Open(filename: string): boolean;
+
+  Next(): number;
+
+  GetUDPData(): any;
+
+  GetUDPSize(): number;
+
+  Seek(time: number): number;
+
+  Rewind(): void;
+
+  Close(): boolean;
+
+  GetIndexSize(): number;
+
+  IsIndexReused(): boolean;
+}
+
+export  class TimerOrderTester {
+
+  constructor(timeService: TimeService);
+
+  Schedule(id: number, ms: number): void;
+
+  GetFired(): number;
+
+  GetFiredId(i: number): number;
+
+  GetFiredDelay(i: number): number;
+}
+
 export  class PCAPTransportEmulator {
 
   constructor();
@@ -604,6 +1150,54 @@ export  class PCAPTransportEmulator {
   Close(): boolean;
 
   GetTimeService(): TimeService;
+
+  OpenMapped(filename: string): boolean;
+}
+
+export  class PCAPVirtualTransportEmulator {
+
+  constructor(object: any);
+
+  SetRemoteProperties(properties: any): void;
+
+  AddIncomingSourceGroup(group: RTPIncomingSourceGroupShared): boolean;
+
+  RemoveIncomingSourceGroup(group: RTPIncomingSourceGroupShared): boolean;
+
+  Open(filename: string): boolean;
+
+  SetReader(reader: UDPReader): boolean;
+
+  Play(): boolean;
+
+  Seek(time: number): number;
+
+  Stop(): boolean;
+
+  Close(): boolean;
+
+  SetAffinity(cpu: number): boolean;
+
+  SetThreadName(name: string): boolean;
+
+  GetReplayedPackets(): number;
+
+  GetVirtualTime(): number;
+
+  SetPacketPoolSize(size: number, maxSize: number): void;
+
+  GetPacketPoolStats(): PacketPoolStats;
+
+  GetTimeService(): TimeService;
+}
+
+export  class PCAPVirtualTransportEmulatorShared {
+
+  constructor(object: any);
+
+  toRTPReceiver(): RTPReceiverShared;
+
+  get(): PCAPVirtualTransportEmulator;
 }
 
 export  class PlayerFacade {
@@ -669,12 +1263,65 @@ export  class Properties {
 export  class RemoteRateEstimatorListener {
 }
 
-export  class RTPSessionFacade {
+export  class BatchedUDPSocketStats {
+
+  sendCalls: number;
+
+  sentPackets: number;
+
+  gsoSends: number;
+
+  sendErrors: number;
+
+  recvCalls: number;
+
+  recvPackets: number;
+
+  gso: boolean;
+}
+
+export  class RTPSessionSendQueueStats {
+
+  producers: number;
+
+  capacity: number;
+
+  depth: number;
 
-  constructor(media: MediaFrameType);
+  maxDepth: number;
+
+  enqueued: number;
+
+  sent: number;
+
+  dropped: number;
+
+  batches: number;
+}
+
+export  class RTPSessionBatchingStats {
+
+  enabled: boolean;
+
+  batchSize: number;
+
+  batchLatency: number;
+
+  latencyFlushes: number;
+
+  rtcpPackets: number;
+
+  retransmissions: number;
+
+  socket: BatchedUDPSocketStats;
+}
+
+export  class RTPSessionFacade {
 
   Init(properties: Properties): number;
 
+  SetBatching(batchSize: number, batchLatency: number): boolean;
+
   SetLocalPort(recvPort: number): number;
 
   GetLocalPort(): number;
@@ -691,12 +1338,16 @@ export  class RTPSessionFacade {
 
   Reset(ssrc: number): number;
 
+  GetSendQueueStats(): RTPSessionSendQueueStats;
+
+  GetBatchingStats(): RTPSessionBatchingStats;
+
   GetTimeService(): TimeService;
 }
 
 export  class RTPSessionFacadeShared {
 
-  constructor(type: MediaFrameType);
+  constructor(type: MediaFrameType, sendQueueSize: number);
 
   toRTPReceiver(): RTPReceiverShared;
 
@@ -721,6 +1372,25 @@ export  class RTPIncomingMediaStreamMultiplexerShared {
   get(): RTPIncomingMediaStreamMultiplexer;
 }
 
+export  class RawTxRingStats {
+
+  frames: number;
+
+  pending: number;
+
+  maxBatch: number;
+
+  queued: number;
+
+  flushes: number;
+
+  ringFull: number;
+
+  sendErrors: number;
+
+  wrongFormat: number;
+}
+
 export  class RTPBundleTransportConnection {
 
   transport: DTLSICETransportShared;
@@ -778,6 +1448,45 @@ export  class RTPBundleTransport {
   GetTimeService(): TimeService;
 }
 
+export  class RTPBundleTransportRawTxStats {
+
+  enabled: boolean;
+
+  ring: RawTxRingStats;
+}
+
+export  class RTPBundleTransportCandidateRawTxStats {
+
+  raw: boolean;
+
+  rawPackets: number;
+
+  udpPackets: number;
+
+  dropped: number;
+}
+
+export  class RTPBundleTransportFacade extends RTPBundleTransport {
+
+  constructor(packetPoolSize: number, maxPacketPoolSize: number);
+
+  GetPacketPool(): PacketPoolShared;
+
+  GetPacketPoolStats(): PacketPoolStats;
+
+  SetRawTx(ifindex: number, sndbuf: number, skipQdisc: boolean, selfLladdr: string, defaultSelfAddr: number, defaultDstLladdr: string, port: number): void;
+
+  ClearRawTx(): void;
+
+  SetCandidateRawTxData(ip: string, port: number, selfAddr: number, dstLladdr: string): void;
+
+  ClearCandidateRawTxData(ip: string, port: number): void;
+
+  GetRawTxStats(): RTPBundleTransportRawTxStats;
+
+  GetCandidateRawTxStats(ip: string, port: number): RTPBundleTransportCandidateRawTxStats;
+}
+
 export  class RTPIncomingMediaStreamDepacketizer extends MediaFrameProducer {
 
   constructor(incomingSource: RTPIncomingMediaStreamShared);
@@ -1,7 +1,18 @@
 %module medooze
 %{
+#ifndef MEDOOZE_NO_PERFETTO
 #include <perfetto.h>
 #include "MedoozeTracing.h"
+#else
+//Built without perfetto, binding trace points are no-ops
+#define PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(ns)
+#define TRACE_EVENT_CATEGORY_ENABLED(...)	false
+#define TRACE_EVENT(...)
+#define TRACE_EVENT_BEGIN(...)
+#define TRACE_EVENT_END(...)
+#define TRACE_EVENT_INSTANT(...)
+#define TRACE_COUNTER(...)
+#endif
 #include <stdlib.h>
 	
 #include <string>
@@ -27,6 +38,18 @@
 #include "SimulcastMediaFrameListener.h"
 #include "../external/srtp/gcm_aes_backend.h"
 
+#ifndef MEDOOZE_NO_PERFETTO
+//Track event categories of the binding layer, kept on their own namespace so they don't clash with the media server ones
+PERFETTO_DEFINE_CATEGORIES_IN_NAMESPACE(medooze_node,
+	perfetto::Category("node.async").SetDescription("Tasks posted from media threads to the Node.js event loop"),
+	perfetto::Category("node.reader").SetDescription("Frames delivered to js by MediaFrameReader"),
+	perfetto::Category("node.speaker").SetDescription("Active speaker detection events"),
+	perfetto::Category("node.transponder").SetDescription("Transponder bandwidth estimation events"),
+	perfetto::Category("node.js").SetDescription("Events emitted from js code")
+);
+PERFETTO_TRACK_EVENT_STATIC_STORAGE_IN_NAMESPACE(medooze_node);
+#endif
+
 template<typename T>
 struct CopyablePersistentTraits {
 public:
@@ -101,16 +124,31 @@ using Persistent = Nan::Persistent<T,NonCopyablePersistentTraits<T>>;
 %include "SimulcastMediaFrameListener.i"
 %include "MediaFrameListenerBridge.i"
 %include "FrameDispatchCoordinator.i"
+%include "Tracing.i"
+%include "SyntheticRTPSource.i"
+%include "RTPLatencyProbe.i"
+%include "LayerSelector.i"
+%include "RTPLayerFanout.i"
+%include "MediaFrameMirror.i"
+%include "RTPIncomingMediaStreamBridge.i"
+%include "EventLoopPool.i"
+%include "EventLoopMonitor.i"
+%include "DTLSHandshakeMonitor.i"
 
 %init %{
+#ifndef MEDOOZE_NO_PERFETTO
 	auto tracingVar = getenv("MEDOOZE_TRACING");
 	if (tracingVar && std::string(tracingVar) == "1") {
 		perfetto::TracingInitArgs args;
-		//args.backends |= perfetto::kInProcessBackend;
+		//In-process backend is also enabled so traces can be started from js
+		args.backends |= perfetto::kInProcessBackend;
 		args.backends |= perfetto::kSystemBackend;
 		perfetto::Tracing::Initialize(args);
 		MedoozeTrackEventRegister();
+		medooze_node::TrackEvent::Register();
 	}
+	//Otherwise perfetto will be initialized with the in-process backend on first TracingFacade::Start
+#endif
 
 	AesGcmSrtpBackend_Register();
 
@@ -0,0 +1,123 @@
+const tap		= require("tap");
+const MediaServer	= require("../index");
+const Native		= require("../lib/Native");
+const FileSystem	= require("fs");
+const Path		= require("path");
+const OS		= require("os");
+const {
+	writeAudioCapture,
+	createRTPPacket,
+	createRTCPSenderReport,
+} = require("./fixtures/pcap");
+
+const {
+	MediaInfo,
+	CodecInfo,
+	StreamInfo,
+	TrackInfo,
+} = require("semantic-sdp");
+
+MediaServer.enableLog(false);
+MediaServer.enableDebug(false);
+MediaServer.enableUltraDebug(false);
+
+const tmp = FileSystem.mkdtempSync(Path.join(OS.tmpdir(), 'tap-'));
+
+//Create RTP properties
+const rtp = {
+	audio :  new MediaInfo("audio","audio"),
+};
+rtp.audio.addCodec(new CodecInfo("opus",96));
+
+const ssrc = 0x1234;
+
+function createAudioStream(/** @type {import("../lib/EmulatedTransport")} */ transport)
+{
+	const streamInfo = new StreamInfo("stream0");
+	const track = new TrackInfo("audio", "track0");
+	track.addSSRC(ssrc);
+	streamInfo.addTrack(track);
+	return transport.createIncomingStream(streamInfo);
+}
+
+Promise.all([
+tap.test("EmulatedTransport",async function(suite){
+
+	suite.test("virtual clock replay",async function(test){
+		//10s of audio, with rtcp and an unknown ssrc that must be ignored
+		const pcap = Path.join(tmp,"audio.pcap");
+		writeAudioCapture(pcap, {
+			ssrc,
+			payloadType	: 96,
+			packets		: 500,
+			extra		: [
+				{ time: 1000000, data: createRTCPSenderReport(ssrc) },
+				{ time: 2000000, data: createRTPPacket(0x5678, 96, 0, 0) },
+			]
+		});
+
+		const transport = MediaServer.createEmulatedTransport(pcap, { virtualClock: true });
+		transport.setRemoteProperties(rtp);
+		const incomingStream = createAudioStream(transport);
+		test.same(incomingStream.getAudioTracks().length, 1);
+
+		//Timers on the replay clock, with ties, a due one and one beyond the capture end
+		const native = /** @type {Native.PCAPVirtualTransportEmulator} */ (/** @type {any} */ (transport).transport);
+		const timers = new Native.TimerOrderTester(native.GetTimeService());
+		const delays = [ 500, 100, 3000, 100, 0, 20000, 9980, 250 ];
+		for (const [id, delay] of delays.entries())
+			timers.Schedule(id, delay);
+		const start = native.GetVirtualTime();
+
+		const began = Date.now();
+		const [ , packets, time] = await new Promise(resolve => {
+			transport.once("ended", (...args) => resolve(args));
+			transport.play();
+		});
+		const elapsed = Date.now() - began;
+
+		//Only known rtp is replayed, and clock ends at last packet capture time
+		test.same(packets, 500);
+		test.same(time - start, 499 * 20);
+		//Much faster than realtime
+		test.ok(elapsed < 2000, `replayed 10s in ${elapsed}ms`);
+
+		//Fired in deadline order, ties on creation order, and exactly at their deadline
+		const fired = [];
+		for (let i = 0; i < timers.GetFired(); ++i)
+			fired.push([timers.GetFiredId(i), timers.GetFiredDelay(i)]);
+		test.same(fired, [[4, 0], [1, 100], [3, 100], [7, 250], [0, 500], [2, 3000], [6, 9980]]);
+
+		transport.stop();
+		FileSystem.unlinkSync(pcap);
+		test.end();
+	});
+
+	suite.test("virtual clock replays are deterministic",async function(test){
+		const pcap = Path.join(tmp,"audio2.pcap");
+		writeAudioCapture(pcap, { ssrc, payloadType: 96, packets: 200 });
+
+		const results = [];
+		//Several transports replaying in parallel, each one on its own thread
+		const transports = [0, 1, 2].map(() => MediaServer.createEmulatedTransport(pcap, { virtualClock: true }));
+		await Promise.all(transports.map(async (transport) => {
+			transport.setRemoteProperties(rtp);
+			createAudioStream(transport);
+			const native = /** @type {Native.PCAPVirtualTransportEmulator} */ (/** @type {any} */ (transport).transport);
+			const start = native.GetVirtualTime();
+			const [ , packets, time] = await new Promise(resolve => {
+				transport.once("ended", (...args) => resolve(args));
+				transport.play();
+			});
+			results.push([packets, time - start]);
+			transport.stop();
+		}));
+		test.same(results, [[200, 3980], [200, 3980], [200, 3980]]);
+
+		FileSystem.unlinkSync(pcap);
+		test.end();
+	});
+
+	suite.end();
+})
+]).then(()=>MediaServer.terminate ());
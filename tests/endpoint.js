@@ -35,6 +35,24 @@ tap.test("Endpoint::create",async function(suite){
 		//Ok
 		test.end();
 	});
+
+	await suite.test("packet pool stats",async function(test){
+		//Create UDP server endpoint with a bounded pool on each shard
+		const endpoint = MediaServer.createEndpoint("127.0.0.1",{packetPoolSize:1024,maxPacketPoolSize:2048,shards:2});
+		const stats = endpoint.getPacketPoolStats();
+		test.same(stats.length,2);
+		for (const shard of stats)
+		{
+			test.same(shard.capacity,1024);
+			test.same(shard.maxSize,2048);
+			test.same(shard.outstanding,0);
+			test.same(shard.overflows,0);
+		}
+		//Stop it
+		endpoint.stop();
+		//Ok
+		test.end();
+	});
 	
 	
 	await suite.test("candidate",async function(test){
@@ -62,6 +80,99 @@ tap.test("Endpoint::create",async function(suite){
 		test.end();
 	});
 	
+	await suite.test("shards",async function(test){
+		//Create sharded UDP server endpoint
+		const endpoint = MediaServer.createEndpoint("127.0.0.1",{shards:4});
+		test.same(endpoint.getShards(),4);
+		//Each shard has its own port
+		const ports = endpoint.getLocalPorts();
+		test.same(new Set(ports).size,4);
+		//Create transports
+		for (let i=0; i<8; ++i)
+		{
+			const offer = endpoint.createOffer({ audio : { codecs : ["opus"] } });
+			//Candidates are announced for the shard of the ICE username
+			test.ok(ports.includes(offer.getCandidates()[0].getPort()));
+			//Create transport for it
+			const transport = endpoint.createTransport({
+				dtls		: new SemanticSDP.DTLSInfo(SemanticSDP.Setup.ACTIVE,"sha-256",endpoint.getDTLSFingerprint()),
+				ice		: SemanticSDP.ICEInfo.generate(true),
+			}, offer);
+			//Same shard as the offer
+			test.same(transport.getLocalCandidates()[0].getPort(),offer.getCandidates()[0].getPort());
+		}
+		//Set affinity on all shards
+		test.ok(endpoint.setAffinity(-1));
+		//Stop it
+		endpoint.stop();
+		//Ok
+		test.end();
+	});
+	
+	await suite.test("provided candidates",async function(test){
+		//Create UDP server endpoint
+		const endpoint = MediaServer.createEndpoint("127.0.0.1");
+		//Local info with its own candidates
+		const candidate = new SemanticSDP.CandidateInfo("1", 1, "UDP", 1, "192.168.0.1", 5000, "host");
+		const transport = endpoint.createTransport({
+			dtls		: new SemanticSDP.DTLSInfo(SemanticSDP.Setup.ACTIVE,"sha-256",endpoint.getDTLSFingerprint()),
+			ice		: SemanticSDP.ICEInfo.generate(true),
+		}, {
+			dtls		: new SemanticSDP.DTLSInfo(SemanticSDP.Setup.PASSIVE,"sha-256",endpoint.getDTLSFingerprint()),
+			ice		: SemanticSDP.ICEInfo.generate(true),
+			candidates	: [candidate],
+		});
+		//Not overriden when not sharded
+		test.same(transport.getLocalCandidates().length,1);
+		test.same(transport.getLocalCandidates()[0].getAddress(),"192.168.0.1");
+		//Stop it
+		endpoint.stop();
+		//Ok
+		test.end();
+	});
+	
+	await suite.test("load stats",async function(test){
+		//Create sharded UDP server endpoint
+		const endpoint = MediaServer.createEndpoint("127.0.0.1",{shards:2});
+		//Start sampling every 10ms
+		test.same(endpoint.getLoadStats(10).length,2);
+		//Wait some samples
+		await new Promise(resolve => setTimeout(resolve, 200));
+		for (const stats of endpoint.getLoadStats())
+		{
+			test.same(stats.period,10);
+			test.ok(stats.samples>0);
+			test.ok(stats.elapsed>=stats.busy);
+			test.ok(stats.load>=0 && stats.load<=1);
+			//Histogram accounts for all samples
+			test.same(stats.timerLag.reduce((total, bucket) => total + bucket.count, 0),stats.samples);
+		}
+		//Stop it
+		endpoint.stop();
+		//Ok
+		test.end();
+	});
+	
+	await suite.test("dtls handshake stats",async function(test){
+		//Create sharded UDP server endpoint
+		const endpoint = MediaServer.createEndpoint("127.0.0.1",{shards:2});
+		const stats = endpoint.getDTLSHandshakeStats();
+		test.same(stats.length,2);
+		for (const shard of stats)
+		{
+			//No handshakes yet
+			test.same(shard.started,0);
+			test.same(shard.pending,0);
+			test.same(shard.latencyAvg,0);
+			test.same(shard.latency.length,10);
+			test.same(shard.latency[shard.latency.length-1].bound,0);
+		}
+		//Stop it
+		endpoint.stop();
+		//Ok
+		test.end();
+	});
+	
 	await suite.test("setAffinity",async function(test){
 		//Create UDP server endpoint
 		const endpoint = MediaServer.createEndpoint("127.0.0.1");
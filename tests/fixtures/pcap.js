@@ -0,0 +1,114 @@
+const FileSystem	= require("fs");
+
+/**
+ * Capture time of the first packet of the fixtures, in microseconds
+ */
+const CaptureStart = 1700000000 * 1000000;
+
+/**
+ * Write udp packets on a little endian microsecond pcap file with ethernet link type
+ * @param {string} filename
+ * @param {Array<{ time: number, data: Buffer }>} packets Udp payloads with their capture time in microseconds
+ */
+function writePCAP(filename, packets)
+{
+	//Global header
+	const header = Buffer.alloc(24);
+	header.writeUInt32LE(0xa1b2c3d4, 0);
+	header.writeUInt16LE(2, 4);
+	header.writeUInt16LE(4, 6);
+	header.writeUInt32LE(65535, 16);
+	header.writeUInt32LE(1, 20);
+
+	const records = [header];
+	for (const { time, data } of packets)
+	{
+		const length = 14 + 20 + 8 + data.length;
+		const record = Buffer.alloc(16 + length);
+		//Record header
+		record.writeUInt32LE(Math.floor(time / 1000000), 0);
+		record.writeUInt32LE(time % 1000000, 4);
+		record.writeUInt32LE(length, 8);
+		record.writeUInt32LE(length, 12);
+		//Ethernet
+		record.writeUInt16BE(0x0800, 16 + 12);
+		//IPv4 from and to localhost
+		const ip = 16 + 14;
+		record[ip] = 0x45;
+		record.writeUInt16BE(20 + 8 + data.length, ip + 2);
+		record[ip + 8] = 64;
+		record[ip + 9] = 17;
+		record.writeUInt32BE(0x7f000001, ip + 12);
+		record.writeUInt32BE(0x7f000001, ip + 16);
+		//UDP
+		const udp = ip + 20;
+		record.writeUInt16BE(5000, udp);
+		record.writeUInt16BE(5004, udp + 2);
+		record.writeUInt16BE(8 + data.length, udp + 4);
+		data.copy(record, udp + 8);
+		records.push(record);
+	}
+	FileSystem.writeFileSync(filename, Buffer.concat(records));
+}
+
+/**
+ * Create an RTP packet with a dummy payload
+ * @param {number} ssrc
+ * @param {number} payloadType
+ * @param {number} seqNum
+ * @param {number} timestamp
+ * @param {number} [payloadSize]
+ */
+function createRTPPacket(ssrc, payloadType, seqNum, timestamp, payloadSize = 20)
+{
+	const packet = Buffer.alloc(12 + payloadSize, 0xAA);
+	packet[0] = 0x80;
+	packet[1] = payloadType & 0x7F;
+	packet.writeUInt16BE(seqNum & 0xFFFF, 2);
+	packet.writeUInt32BE(timestamp >>> 0, 4);
+	packet.writeUInt32BE(ssrc >>> 0, 8);
+	return packet;
+}
+
+/**
+ * Create an RTCP sender report without report blocks
+ * @param {number} ssrc
+ */
+function createRTCPSenderReport(ssrc)
+{
+	const packet = Buffer.alloc(28);
+	packet[0] = 0x80;
+	packet[1] = 200;
+	packet.writeUInt16BE(6, 2);
+	packet.writeUInt32BE(ssrc >>> 0, 4);
+	return packet;
+}
+
+/**
+ * Create a capture of an audio stream with a packet each 20ms
+ * @param {string} filename
+ * @param {Object} params
+ * @param {number} params.ssrc
+ * @param {number} params.payloadType
+ * @param {number} params.packets Number of rtp packets
+ * @param {Array<{ time: number, data: Buffer }>} [params.extra] Other packets to add to the capture, with time relative to the capture start in microseconds
+ */
+function writeAudioCapture(filename, { ssrc, payloadType, packets, extra = [] })
+{
+	const records = [];
+	for (let i = 0; i < packets; ++i)
+		records.push({ time: CaptureStart + i * 20000, data: createRTPPacket(ssrc, payloadType, i, i * 960) });
+	for (const { time, data } of extra)
+		records.push({ time: CaptureStart + time, data });
+	//Keep capture order
+	records.sort((a, b) => a.time - b.time);
+	writePCAP(filename, records);
+}
+
+module.exports = {
+	CaptureStart,
+	writePCAP,
+	createRTPPacket,
+	createRTCPSenderReport,
+	writeAudioCapture,
+};
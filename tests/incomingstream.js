@@ -367,6 +367,53 @@ tap.test("IncomingMediaStream::create",async function(suite){
 		removedTrack.stop();
 	});
 
+	await suite.test("mirror shared frames",async function(test){
+		//Create stream
+		const streamInfo = new StreamInfo("stream9");
+		//Create track
+		const track = new TrackInfo("audio", "track1");
+		//Add ssrc
+		track.addSSRC(ssrc++);
+		//Add it
+		streamInfo.addTrack(track);
+		//Create new incoming stream
+		const incomingStream = transport.createIncomingStream(streamInfo);
+		const incomingStreamTrack = incomingStream.getAudioTracks()[0];
+
+		//Mirror it on two endpoints
+		const other = MediaServer.createEndpoint("127.0.0.1");
+		const mirrored = endpoint.mirrorIncomingStreamTrack(incomingStreamTrack);
+		const mirrored2 = other.mirrorIncomingStreamTrack(incomingStreamTrack);
+
+		//Both mirrors share the frames of the original encoding
+		const encoding = incomingStreamTrack.getDefaultEncoding();
+		test.ok(encoding.frames);
+		test.same(2,encoding.frames.GetMirrors());
+
+		//Check stats
+		const stats = mirrored.getMirrorStats()[encoding.id];
+		test.ok(stats);
+		test.ok(stats.capacity>0);
+		test.same(0,stats.dropped);
+		test.same(0,stats.backlog);
+		test.same(0,mirrored2.getMirrorStats()[encoding.id].pushed);
+
+		//Each endpoint loop gets its own packet channel
+		const bridge = mirrored.getBridgeStats()[encoding.id];
+		test.ok(bridge.bridges>=1);
+		test.ok(bridge.capacity>0);
+		test.same(0,bridge.dropped);
+		test.same(0,bridge.backlog);
+		test.same(1,mirrored2.getBridgeStats()[encoding.id].bridges);
+
+		//Stop one mirror
+		mirrored2.stop();
+		test.same(1,encoding.frames.GetMirrors());
+
+		incomingStream.stop();
+		other.stop();
+	});
+
 	suite.end();
 })
 ]).then(()=>MediaServer.terminate ());
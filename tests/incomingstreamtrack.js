@@ -333,6 +333,45 @@ tap.test("IncomingMediaStream::stats",async function(suite){
 		test.end();
 		
 	});
+
+	await suite.test("shared active layers",async function(test){
+		let ssrc = 200;
+		//Create stream
+		const streamInfo = new StreamInfo("stream2");
+		//Create track
+		let track = new TrackInfo("video", "track1");
+		//Add ssrc to track
+		track.addSSRC(ssrc);
+		//Add it
+		streamInfo.addTrack(track);
+		//Create new incoming stream
+		const incomingStream = transport.createIncomingStream(streamInfo);
+		//Get new track
+		const videoTrack = incomingStream.getVideoTracks()[0];
+		//Get shared active layers
+		const layers = videoTrack.getSharedActiveLayers();
+		test.ok(layers);
+		test.same(layers.version,videoTrack.getStatsVersion());
+		//Stats are cached, so same table is returned
+		test.equal(videoTrack.getSharedActiveLayers(),layers);
+		//It can't be modified
+		test.ok(Object.isFrozen(layers));
+		test.ok(Object.isFrozen(layers.layers));
+		//Public ones are a copy callers can modify
+		const copy = videoTrack.getActiveLayers();
+		test.not(copy,layers);
+		test.notOk(Object.isFrozen(copy));
+		test.same(copy.layers,layers.layers);
+		copy.layers.push(/** @type {any} */ ({}));
+		test.not(copy.layers.length,layers.layers.length);
+		//Wait until stats are refreshed
+		await new Promise(resolve=>setTimeout(resolve,150));
+		//Get them again
+		const refreshed = await videoTrack.getSharedActiveLayersAsync();
+		test.not(refreshed,layers);
+		test.ok(refreshed.version>layers.version);
+		test.end();
+	});
 	
 	transport.stop();
 	suite.end();
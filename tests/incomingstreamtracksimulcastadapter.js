@@ -75,6 +75,14 @@ tap.test("IncomingStream",function(suite){
 		ice  : SemanticSDP.ICEInfo.generate()
 	});
 
+	suite.test("event loop pool stats before start",function(test){
+		//Nothing has borrowed a loop yet, so the pool is not started by getting its stats
+		const stats = MediaServer.getEventLoopPoolStats();
+		test.same(stats,{size:0,borrowed:0,minLoad:0,maxLoad:0,loads:[]});
+		test.same(MediaServer.getEventLoopPoolStats().size,0);
+		test.end();
+	});
+
 	suite.test("create+stop emtpy simulcast adapter",function(test){
 		test.plan(2);
 		//Create simulcast adapter
@@ -90,6 +98,42 @@ tap.test("IncomingStream",function(suite){
 		test.end();
 	});
 
+	suite.test("shared event loops",function(test){
+		const borrowed = MediaServer.getEventLoopPoolStats().borrowed;
+		//Create simulcast adapters
+		const simulcastTrack1 = MediaServer.createIncomingStreamTrackSimulcastAdapter("video");
+		const simulcastTrack2 = MediaServer.createIncomingStreamTrackSimulcastAdapter("video");
+		//Both borrow a loop from the pool
+		const stats = MediaServer.getEventLoopPoolStats();
+		test.same(borrowed+2,stats.borrowed);
+		test.same(stats.size,stats.loads.length);
+		test.ok(stats.maxLoad-stats.minLoad<=1);
+		//Loops are returned on stop
+		simulcastTrack1.stop();
+		simulcastTrack2.stop();
+		test.same(borrowed,MediaServer.getEventLoopPoolStats().borrowed);
+		test.end();
+	});
+
+	suite.test("event loop borrow/return balance",function(test){
+		const before = MediaServer.getEventLoopPoolStats();
+		//Create simulcast adapter
+		const simulcastTrack = MediaServer.createIncomingStreamTrackSimulcastAdapter("video");
+		test.same(MediaServer.getEventLoopPoolStats().borrowed,before.borrowed+1);
+		//Stop it twice, the loop must be returned only once
+		simulcastTrack.stop();
+		simulcastTrack.stop();
+		const after = MediaServer.getEventLoopPoolStats();
+		test.same(after.borrowed,before.borrowed);
+		test.same(after.loads,before.loads);
+		//A loop can't be returned more times than borrowed
+		const loop = MediaServer.borrowEventLoop();
+		test.ok(MediaServer.returnEventLoop(loop));
+		test.notOk(MediaServer.returnEventLoop(loop));
+		test.same(MediaServer.getEventLoopPoolStats().borrowed,before.borrowed);
+		test.end();
+	});
+
 	suite.test("create+stop simulcast adapter",function(test){
 		test.plan(4);
 		//Create simulcast adapter
@@ -0,0 +1,99 @@
+const tap		= require("tap");
+const MediaServer	= require("../index");
+const Native		= require("../lib/Native");
+const SharedPointer	= require("../lib/SharedPointer");
+
+MediaServer.enableLog(false);
+MediaServer.enableDebug(false);
+MediaServer.enableUltraDebug(false);
+
+const sleep = (/** @type {number} */ ms) => new Promise(resolve => setTimeout(resolve, ms));
+
+async function withLoops(/** @type {(origin: Native.EventLoop, mirror: Native.EventLoop) => Promise<void>} */ run)
+{
+	const origin = new Native.EventLoop();
+	const mirror = new Native.EventLoop();
+	origin.Start();
+	mirror.Start();
+	try {
+		await run(origin, mirror);
+	} finally {
+		origin.Stop();
+		mirror.Stop();
+	}
+}
+
+Promise.all([
+tap.test("MediaFrameMirror",async function(suite){
+
+	suite.test("no loss while the mirror keeps up",async function(test){
+		await withLoops(async (origin, mirror) => {
+			const tester = SharedPointer(new Native.MediaFrameMirrorTesterShared(origin, mirror, 16));
+			for (let i = 0; i < 10; ++i)
+			{
+				tester.Push(100, 30);
+				await sleep(5);
+			}
+			await sleep(200);
+			const stats = tester.GetStats();
+			test.same(tester.GetReceived(), 1000);
+			test.same(tester.GetUndecodable(), 0);
+			test.same(stats.delivered, 1000);
+			test.same(stats.dropped, 0);
+			test.same(stats.backlog, 0);
+			tester.Stop();
+		});
+		test.end();
+	});
+
+	suite.test("backlog keeps frames while the mirror is blocked",async function(test){
+		await withLoops(async (origin, mirror) => {
+			const tester = SharedPointer(new Native.MediaFrameMirrorTesterShared(origin, mirror, 16));
+			tester.Block(200);
+			tester.Push(500, 100);
+			await sleep(50);
+			let stats = tester.GetStats();
+			test.same(stats.depth, 16);
+			test.same(stats.backlog, 484);
+			test.same(stats.deferred, 484);
+			test.same(stats.dropped, 0);
+			await sleep(400);
+			stats = tester.GetStats();
+			test.same(tester.GetReceived(), 500);
+			test.same(tester.GetLast(), 499);
+			test.same(tester.GetUndecodable(), 0);
+			test.same(stats.backlog, 0);
+			tester.Stop();
+		});
+		test.end();
+	});
+
+	suite.test("key frame replaces the backlog when full",async function(test){
+		await withLoops(async (origin, mirror) => {
+			const tester = SharedPointer(new Native.MediaFrameMirrorTesterShared(origin, mirror, 16));
+			tester.Block(300);
+			//Overflows ring and backlog several times, with a key frame every 100
+			tester.Push(3000, 100);
+			await sleep(800);
+			const stats = tester.GetStats();
+			//Frames on the ring, and the ones since the last key frame that replaced the backlog
+			test.same(tester.GetReceived(), 16 + 800);
+			test.same(tester.GetIntras(), 9);
+			test.same(tester.GetLast(), 2999);
+			//Delta frames are never delivered after a lost one
+			test.same(tester.GetUndecodable(), 0);
+			test.same(stats.delivered + stats.dropped, 3000);
+			test.same(stats.backlog, 0);
+			//Recovers once the mirror is not blocked anymore
+			tester.Push(100, 100);
+			await sleep(200);
+			test.same(tester.GetReceived(), 916);
+			test.same(tester.GetUndecodable(), 0);
+			tester.Stop();
+		});
+		test.end();
+	});
+
+	suite.end();
+})
+]).then(()=>MediaServer.terminate ());
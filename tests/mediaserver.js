@@ -2,6 +2,7 @@ const tap		= require("tap");
 const MediaServer	= require("../index");
 const FS		= require("fs");
 const Path		= require("path");
+const OS		= require("os");
 
 
 MediaServer.enableLog(false);
@@ -35,6 +36,30 @@ tap.test("MediaServer",async function(suite){
 		//Done
 		test.end();
 	});
+	suite.test("tracing",async function(test){
+		//Create temp trace file
+		const tmp = FS.mkdtempSync(Path.join(OS.tmpdir(),"media-server-test-"));
+		const fd = FS.openSync(Path.join(tmp,"trace.pftrace"),"w");
+		//Remove it when done
+		test.teardown(()=>FS.rmSync(tmp,{recursive:true,force:true}));
+		//Start in-process tracing
+		test.ok(MediaServer.tracing.start(fd,{categories:["rtp","node.js"],bufferSize:1024}));
+		test.ok(MediaServer.tracing.isActive());
+		//Only one at a time
+		test.notOk(MediaServer.tracing.start(fd));
+		//Js events
+		test.ok(MediaServer.tracing.isEnabled());
+		MediaServer.tracing.begin("test");
+		MediaServer.tracing.instant("instant");
+		MediaServer.tracing.counter("counter",1);
+		MediaServer.tracing.end();
+		//Wait until written
+		await MediaServer.tracing.stop();
+		test.notOk(MediaServer.tracing.isActive());
+		FS.closeSync(fd);
+		//Done
+		test.end();
+	});
 	
 }),
 tap.test("setCertificate",async function(suite){
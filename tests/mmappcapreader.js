@@ -0,0 +1,127 @@
+const tap		= require("tap");
+const MediaServer	= require("../index");
+const Native		= require("../lib/Native");
+const FileSystem	= require("fs");
+const Path		= require("path");
+const OS		= require("os");
+const {
+	CaptureStart,
+	writeAudioCapture,
+} = require("./fixtures/pcap");
+
+MediaServer.enableLog(false);
+MediaServer.enableDebug(false);
+MediaServer.enableUltraDebug(false);
+
+const tmp = FileSystem.mkdtempSync(Path.join(OS.tmpdir(), 'tap-'));
+
+function open(/** @type {string} */ pcap)
+{
+	const reader = new Native.MMapPCAPReader();
+	if (!reader.Open(pcap))
+		throw new Error("Could not open " + pcap);
+	return reader;
+}
+
+Promise.all([
+tap.test("MMapPCAPReader",async function(suite){
+
+	suite.test("read",async function(test){
+		const pcap = Path.join(tmp,"read.pcap");
+		writeAudioCapture(pcap, { ssrc: 1, payloadType: 96, packets: 10 });
+		const reader = open(pcap);
+		let num = 0;
+		for (let ts = reader.Next(); ts; ts = reader.Next())
+		{
+			test.same(ts, CaptureStart + num * 20000);
+			//Rtp header and dummy payload
+			test.same(reader.GetUDPSize(), 32);
+			num++;
+		}
+		test.same(num, 10);
+		//Start again
+		reader.Rewind();
+		test.same(reader.Next(), CaptureStart);
+		reader.Close();
+		//Not a capture
+		test.notOk(new Native.MMapPCAPReader().Open(__filename));
+		test.end();
+	});
+
+	suite.test("seek",async function(test){
+		const pcap = Path.join(tmp,"seek.pcap");
+		writeAudioCapture(pcap, { ssrc: 1, payloadType: 96, packets: 1000 });
+		const reader = open(pcap);
+		//Exact packet time, returned again by next read
+		test.same(reader.Seek(5000), CaptureStart + 5000000);
+		test.same(reader.Next(), CaptureStart + 5000000);
+		test.same(reader.Next(), CaptureStart + 5020000);
+		//First packet after the requested time
+		test.same(reader.Seek(5010), CaptureStart + 5020000);
+		//Backwards, across index entries
+		test.same(reader.Seek(0), CaptureStart);
+		test.same(reader.Next(), CaptureStart);
+		test.same(reader.Seek(19980), CaptureStart + 19980000);
+		//Beyond capture end
+		test.same(reader.Seek(30000), 0);
+		test.same(reader.Next(), 0);
+		reader.Close();
+		FileSystem.unlinkSync(pcap + ".idx");
+		test.end();
+	});
+
+	suite.test("index sidecar",async function(test){
+		const pcap = Path.join(tmp,"index.pcap");
+		const idx = pcap + ".idx";
+		writeAudioCapture(pcap, { ssrc: 1, payloadType: 96, packets: 1000 });
+
+		//Created lazily on first seek
+		let reader = open(pcap);
+		test.notOk(FileSystem.existsSync(idx));
+		test.same(reader.Seek(1000), CaptureStart + 1000000);
+		test.ok(FileSystem.existsSync(idx));
+		//Written on a temp file renamed over the final one
+		test.same(FileSystem.readdirSync(tmp).filter(name => name.includes(".idx.tmp.")), []);
+		test.notOk(reader.IsIndexReused());
+		const entries = reader.GetIndexSize();
+		test.ok(entries > 1);
+		reader.Close();
+
+		//Reused by next reader of the same capture
+		reader = open(pcap);
+		test.same(reader.Seek(1000), CaptureStart + 1000000);
+		test.ok(reader.IsIndexReused());
+		test.same(reader.GetIndexSize(), entries);
+		reader.Close();
+
+		//Stale once the capture changes size
+		writeAudioCapture(pcap, { ssrc: 1, payloadType: 96, packets: 2000 });
+		reader = open(pcap);
+		test.same(reader.Seek(30000), CaptureStart + 30000000);
+		test.notOk(reader.IsIndexReused());
+		test.ok(reader.GetIndexSize() > entries);
+		reader.Close();
+
+		//Stale once the capture is modified, even if it keeps its size
+		writeAudioCapture(pcap, { ssrc: 2, payloadType: 96, packets: 2000 });
+		const stat = FileSystem.statSync(pcap);
+		FileSystem.utimesSync(pcap, stat.atime, new Date(stat.mtimeMs + 5000));
+		reader = open(pcap);
+		test.same(reader.Seek(30000), CaptureStart + 30000000);
+		test.notOk(reader.IsIndexReused());
+		reader.Close();
+
+		//And then reused again
+		reader = open(pcap);
+		reader.Seek(30000);
+		test.ok(reader.IsIndexReused());
+		reader.Close();
+
+		FileSystem.unlinkSync(idx);
+		FileSystem.unlinkSync(pcap);
+		test.end();
+	});
+
+	suite.end();
+})
+]).then(()=>MediaServer.terminate ());
@@ -0,0 +1,83 @@
+const tap		= require("tap");
+const MediaServer	= require("../index");
+const Native		= require("../lib/Native");
+const SharedPointer	= require("../lib/SharedPointer");
+
+MediaServer.enableLog(false);
+MediaServer.enableDebug(false);
+MediaServer.enableUltraDebug(false);
+
+Promise.all([
+tap.test("PacketPool",async function(suite){
+
+	suite.test("preallocate",async function(test){
+		const pool = SharedPointer(new Native.PacketPoolShared(16, 32));
+		const stats = pool.GetStats();
+		test.same(stats.capacity, 16);
+		test.same(stats.maxSize, 32);
+		test.same(stats.outstanding, 0);
+		test.same(stats.grows, 0);
+		test.end();
+	});
+
+	suite.test("alloc+release",async function(test){
+		const pool = SharedPointer(new Native.PacketPoolShared(16, 32));
+		const tester = new Native.PacketPoolTester(pool);
+		//From preallocated blocks
+		test.ok(tester.Allocate(10));
+		let stats = pool.GetStats();
+		test.same(stats.outstanding, 10);
+		test.same(stats.highWaterMark, 10);
+		test.same(stats.grows, 0);
+		test.ok(stats.hits > 0);
+		test.ok(stats.misses > 0);
+		//Grow up to max size and overflow past it
+		test.ok(tester.Allocate(30));
+		stats = pool.GetStats();
+		test.same(stats.outstanding, 40);
+		test.same(stats.capacity, 32);
+		test.same(stats.grows, 1);
+		test.same(stats.overflows, 8);
+		//Release all
+		tester.Release(40);
+		stats = pool.GetStats();
+		test.same(tester.GetAllocated(), 0);
+		test.same(stats.outstanding, 0);
+		test.same(stats.highWaterMark, 40);
+		test.end();
+	});
+
+	suite.test("unbounded",async function(test){
+		const pool = SharedPointer(new Native.PacketPoolShared(0, 0));
+		const tester = new Native.PacketPoolTester(pool);
+		test.ok(tester.Allocate(1000));
+		const stats = pool.GetStats();
+		test.ok(stats.capacity >= 1000);
+		test.ok(stats.grows > 0);
+		test.same(stats.overflows, 0);
+		tester.Release(1000);
+		test.same(pool.GetStats().outstanding, 0);
+		test.end();
+	});
+
+	suite.test("cross-thread release",async function(test){
+		const pool = SharedPointer(new Native.PacketPoolShared(32, 32));
+		const tester = new Native.PacketPoolTester(pool);
+		//Use the whole pool and release it from another thread
+		test.ok(tester.Allocate(32));
+		tester.ReleaseOnThread(32);
+		let stats = pool.GetStats();
+		test.same(stats.outstanding, 0);
+		//Blocks are back on the shared free list, so they are reused instead of overflowing
+		test.ok(tester.Allocate(32));
+		stats = pool.GetStats();
+		test.same(stats.outstanding, 32);
+		test.same(stats.capacity, 32);
+		test.same(stats.overflows, 0);
+		tester.Release(32);
+		test.end();
+	});
+
+	suite.end();
+})
+]).then(()=>MediaServer.terminate ());
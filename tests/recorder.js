@@ -138,12 +138,19 @@ Promise.all([
 			
 			//Get temp file
 			const file = Path.join(tmp,"test2.mp4");
-			//Create 
-			const recorder = MediaServer.createRecorder(file,{timeShift:10000});
+			//Create
+			const recorder = MediaServer.createRecorder(file,{timeShift:10000,timeShiftBitrate:1000000});
 			//Record it
 			recorder.record(incomingStream);
 			//Check file doesn't exist
 			test.notOk(FileSystem.existsSync(file));
+			//Get time shift buffer stats
+			const stats = recorder.getTimeShiftStats();
+			//Buffer is preallocated for 10s at 1Mbps plus margin
+			test.same(stats.capacity, 1562500);
+			test.same(stats.used, 0);
+			test.same(stats.frames, 0);
+			test.ok(stats.maxFrames);
 			//Flush it
 			recorder.flush();
 			//Check file exist
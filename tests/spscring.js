@@ -0,0 +1,85 @@
+const tap		= require("tap");
+const MediaServer	= require("../index");
+const Native		= require("../lib/Native");
+const SharedPointer	= require("../lib/SharedPointer");
+
+MediaServer.enableLog(false);
+MediaServer.enableDebug(false);
+MediaServer.enableUltraDebug(false);
+
+const sleep = (/** @type {number} */ ms) => new Promise(resolve => setTimeout(resolve, ms));
+
+async function withLoops(/** @type {(producer: Native.EventLoop, consumer: Native.EventLoop) => Promise<void>} */ run)
+{
+	const producer = new Native.EventLoop();
+	const consumer = new Native.EventLoop();
+	producer.Start();
+	consumer.Start();
+	try {
+		await run(producer, consumer);
+	} finally {
+		producer.Stop();
+		consumer.Stop();
+	}
+}
+
+Promise.all([
+tap.test("SPSCAsyncQueue",async function(suite){
+
+	suite.test("drop when full",async function(test){
+		await withLoops(async (producer, consumer) => {
+			const tester = SharedPointer(new Native.SPSCAsyncQueueTesterShared(producer, consumer, 16, 0));
+			tester.Block(200);
+			tester.Push(100);
+			await sleep(400);
+			//Only the ones that fit on the ring
+			test.same(tester.GetDelivered(), 16);
+			test.same(tester.GetDropped(), 84);
+			test.same(tester.GetDeferred(), 0);
+			test.ok(tester.IsOrdered());
+		});
+		test.end();
+	});
+
+	suite.test("backlog",async function(test){
+		await withLoops(async (producer, consumer) => {
+			const tester = SharedPointer(new Native.SPSCAsyncQueueTesterShared(producer, consumer, 16, 32));
+			tester.Block(300);
+			tester.Push(100);
+			await sleep(100);
+			//Ring and backlog are full while the consumer is blocked
+			test.same(tester.GetSize(), 16);
+			test.same(tester.GetBacklogSize(), 32);
+			test.same(tester.GetDeferred(), 32);
+			test.same(tester.GetDropped(), 52);
+			test.same(tester.GetDelivered(), 0);
+			await sleep(400);
+			//Backlog is moved to the ring as it is drained
+			test.same(tester.GetDelivered(), 48);
+			test.same(tester.GetBacklogSize(), 0);
+			test.same(tester.GetSize(), 0);
+			test.ok(tester.IsOrdered());
+		});
+		test.end();
+	});
+
+	suite.test("no loss while the consumer keeps up",async function(test){
+		await withLoops(async (producer, consumer) => {
+			const tester = SharedPointer(new Native.SPSCAsyncQueueTesterShared(producer, consumer, 16, 4096));
+			for (let i = 0; i < 20; ++i)
+			{
+				tester.Push(100);
+				await sleep(5);
+			}
+			await sleep(200);
+			test.same(tester.GetDelivered(), 2000);
+			test.same(tester.GetDropped(), 0);
+			test.same(tester.GetBacklogSize(), 0);
+			test.ok(tester.IsOrdered());
+		});
+		test.end();
+	});
+
+	suite.end();
+})
+]).then(()=>MediaServer.terminate ());
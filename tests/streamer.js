@@ -1,6 +1,7 @@
 const tap		= require("tap");
 const MediaServer	= require("../index");
 const SemanticSDP	= require("semantic-sdp");
+const dgram		= require("dgram");
 
 MediaServer.enableLog(false);
 MediaServer.enableDebug(false);
@@ -17,6 +18,81 @@ const {
 	TrackEncodingInfo,
 } = require("semantic-sdp");
 
+function sleep(ms) {
+	return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+/**
+ * Poll until the condition is met or the timeout expires, returns if it was met
+ */
+async function waitFor(condition, timeout = 2000)
+{
+	const end = Date.now() + timeout;
+	while (!condition())
+	{
+		if (Date.now() > end)
+			return false;
+		await sleep(10);
+	}
+	return true;
+}
+
+function createOpusInfo()
+{
+	const media = new MediaInfo("audio","audio");
+	media.addCodec(new CodecInfo("opus",111));
+	return media;
+}
+
+function createRTPPacket(seqNum)
+{
+	const packet = Buffer.alloc(12 + 20);
+	packet[0] = 0x80;
+	packet[1] = 111;
+	packet.writeUInt16BE(seqNum, 2);
+	packet.writeUInt32BE(seqNum * 960, 4);
+	packet.writeUInt32BE(0x1234, 8);
+	return packet;
+}
+
+/**
+ * Forward a burst of packets from a socket to a session to a sink through a transponder
+ */
+async function forwardBurst(streamer, num, params)
+{
+	//Sink of the forwarded packets
+	const sink = dgram.createSocket("udp4");
+	const received = [];
+	sink.on("message", (msg) => received.push(msg.readUInt16BE(2)));
+	await new Promise(resolve => sink.bind(0, "127.0.0.1", resolve));
+
+	//Receive packets on one session and forward them to the other
+	const input = streamer.createSession(createOpusInfo(),{noRTCP:true});
+	const output = streamer.createSession(createOpusInfo(),Object.assign({noRTCP:true,remote:{ip:"127.0.0.1",port:sink.address().port}},params));
+	const transponder = output.getOutgoingStreamTrack().attachTo(input.getIncomingStreamTrack());
+
+	//Send burst
+	const source = dgram.createSocket("udp4");
+	for (let i=0; i<num; ++i)
+		source.send(createRTPPacket(i), input.getLocalPort(), "127.0.0.1");
+
+	//Until all forwarded packets are either dropped or sent and received
+	await waitFor(() => {
+		const stats = output.getSendQueueStats();
+		return stats.enqueued + stats.dropped == num && !stats.depth && received.length == stats.sent;
+	});
+
+	const stats = output.getSendQueueStats();
+
+	transponder.stop();
+	input.stop();
+	output.stop();
+	source.close();
+	sink.close();
+
+	return { received, stats };
+}
+
 Promise.all([
 tap.test("Sreamer::create",async function(suite){
 	
@@ -39,6 +115,209 @@ tap.test("Sreamer::create",async function(suite){
 	});
 	
 
+	suite.test("sendQueueStats",async function(test){
+		//Create new streamer
+		const streamer = MediaServer.createStreamer();
+		const session = streamer.createSession(new MediaInfo("video","video"),{noRTCP:true,sendQueueSize:100});
+		//Get send queue stats
+		const stats = session.getSendQueueStats();
+		//Rounded up to power of two
+		test.same(stats.capacity,128);
+		//No loop has sent anything yet
+		test.same(stats.producers,0);
+		test.same(stats.depth,0);
+		test.same(stats.dropped,0);
+		session.stop();
+		streamer.stop();
+		test.end();
+	});
+
+	suite.test("send order",async function(test){
+		const streamer = MediaServer.createStreamer();
+		const { received, stats } = await forwardBurst(streamer, 100, {sendQueueSize:1024});
+		//All sent from the session loop, queued by the transponder loop
+		test.same(stats.producers,1);
+		test.same(stats.enqueued,100);
+		test.same(stats.sent,100);
+		test.same(stats.dropped,0);
+		test.same(stats.depth,0);
+		test.ok(stats.batches>0 && stats.batches<=stats.sent);
+		//In order
+		test.same(received.length,100);
+		for (let i=1; i<received.length; ++i)
+			test.same((received[i] - received[i-1]) & 0xFFFF, 1);
+		streamer.stop();
+		test.end();
+	});
+
+	suite.test("send queue drops",async function(test){
+		const streamer = MediaServer.createStreamer();
+		const { received, stats } = await forwardBurst(streamer, 500, {sendQueueSize:2});
+		test.same(stats.capacity,2);
+		//Every forwarded packet is either sent or dropped
+		test.same(stats.enqueued + stats.dropped,500);
+		test.same(stats.sent,stats.enqueued);
+		test.same(received.length,stats.sent);
+		//Still in order, with gaps where packets were dropped
+		for (let i=1; i<received.length; ++i)
+		{
+			const delta = (received[i] - received[i-1]) & 0xFFFF;
+			test.ok(delta>=1 && delta<0x8000);
+		}
+		streamer.stop();
+		test.end();
+	});
+
+	suite.test("batching",async function(test){
+		//Create new streamer
+		const streamer = MediaServer.createStreamer();
+		const session = streamer.createSession(new MediaInfo("video","video"),{noRTCP:true,batchSize:16,local:{port:0}});
+		//Get batching stats
+		const stats = session.getBatchingStats();
+		test.ok(stats.enabled);
+		test.same(stats.batchSize,16);
+		test.same(stats.sentPackets,0);
+		//Bound on any free port
+		test.ok(session.getLocalPort()>0);
+		session.stop();
+		streamer.stop();
+		test.end();
+	});
+
+	suite.test("batching receive, rtcp and nack",async function(test){
+		//Create new streamer
+		const streamer = MediaServer.createStreamer();
+		//Sink of the forwarded packets
+		const sink = dgram.createSocket("udp4");
+		const received = [];
+		let rtcp = 0;
+		let ssrc = 0;
+		sink.on("message", (msg) => {
+			if (msg[1]>=192 && msg[1]<=223)
+				return rtcp++;
+			ssrc = msg.readUInt32BE(8);
+			received.push(msg.readUInt16BE(2));
+		});
+		await new Promise(resolve => sink.bind(0, "127.0.0.1", resolve));
+
+		//Both sessions batched, only the output one sends reports
+		const input = streamer.createSession(createOpusInfo(),{noRTCP:true,batchSize:16});
+		const output = streamer.createSession(createOpusInfo(),{batchSize:16,remote:{ip:"127.0.0.1",port:sink.address().port}});
+		const transponder = output.getOutgoingStreamTrack().attachTo(input.getIncomingStreamTrack());
+
+		//Send burst
+		const source = dgram.createSocket("udp4");
+		for (let i=0; i<10; ++i)
+			source.send(createRTPPacket(i), input.getLocalPort(), "127.0.0.1");
+		await waitFor(() => received.length==10);
+
+		test.same(input.getBatchingStats().recvPackets,10);
+		test.same(received.length,10);
+
+		//Nack the first forwarded packet
+		const nack = Buffer.alloc(16);
+		nack[0] = 0x81;
+		nack[1] = 205;
+		nack.writeUInt16BE(3, 2);
+		nack.writeUInt32BE(1, 4);
+		nack.writeUInt32BE(ssrc, 8);
+		nack.writeUInt16BE(received[0], 12);
+		sink.send(nack, output.getLocalPort(), "127.0.0.1");
+		//Until resent and the first report is sent
+		await waitFor(() => received.length==11 && rtcp>0, 3000);
+
+		const stats = output.getBatchingStats();
+		//Resent in the same stream
+		test.same(stats.retransmissions,1);
+		test.same(received.length,11);
+		test.same(received[10],received[0]);
+		//Reports sent through the batched socket
+		test.ok(stats.rtcpPackets>0);
+		test.ok(rtcp>0);
+		test.same(input.getBatchingStats().rtcpPackets,0);
+
+		transponder.stop();
+		input.stop();
+		output.stop();
+		source.close();
+		sink.close();
+		streamer.stop();
+		test.end();
+	});
+
+	suite.test("batching latency",async function(test){
+		//Create new streamer
+		const streamer = MediaServer.createStreamer();
+		//Sink of the forwarded packets
+		const sink = dgram.createSocket("udp4");
+		const received = [];
+		sink.on("message", (msg) => received.push(msg.readUInt16BE(2)));
+		await new Promise(resolve => sink.bind(0, "127.0.0.1", resolve));
+
+		//Partial batches are held for up to 50ms
+		const input = streamer.createSession(createOpusInfo(),{noRTCP:true});
+		const output = streamer.createSession(createOpusInfo(),{noRTCP:true,batchSize:16,batchLatency:50,remote:{ip:"127.0.0.1",port:sink.address().port}});
+		const transponder = output.getOutgoingStreamTrack().attachTo(input.getIncomingStreamTrack());
+		test.same(output.getBatchingStats().batchLatency,50);
+
+		//Send less than a batch
+		const source = dgram.createSocket("udp4");
+		for (let i=0; i<3; ++i)
+			source.send(createRTPPacket(i), input.getLocalPort(), "127.0.0.1");
+
+		//Sent together once the latency expires
+		test.ok(await waitFor(() => received.length==3));
+		const stats = output.getBatchingStats();
+		test.ok(stats.latencyFlushes>=1);
+		test.ok(stats.sendCalls<=stats.latencyFlushes);
+		for (let i=1; i<received.length; ++i)
+			test.same((received[i] - received[i-1]) & 0xFFFF, 1);
+
+		transponder.stop();
+		input.stop();
+		output.stop();
+		source.close();
+		sink.close();
+		streamer.stop();
+		test.end();
+	});
+
+	suite.test("batching ipv6 remote",async function(test){
+		//Skip if ipv6 is not available
+		const sink = dgram.createSocket("udp6");
+		try {
+			await new Promise((resolve, reject) => { sink.once("error", reject); sink.bind(0, "::1", resolve); });
+		} catch (e) {
+			test.comment("ipv6 not available");
+			return test.end();
+		}
+		const received = [];
+		sink.on("message", (msg) => received.push(msg.readUInt16BE(2)));
+
+		//Create new streamer
+		const streamer = MediaServer.createStreamer();
+		const input = streamer.createSession(createOpusInfo(),{noRTCP:true});
+		const output = streamer.createSession(createOpusInfo(),{noRTCP:true,batchSize:16,remote:{ip:"::1",port:sink.address().port}});
+		const transponder = output.getOutgoingStreamTrack().attachTo(input.getIncomingStreamTrack());
+
+		//Send burst
+		const source = dgram.createSocket("udp4");
+		for (let i=0; i<10; ++i)
+			source.send(createRTPPacket(i), input.getLocalPort(), "127.0.0.1");
+		await waitFor(() => received.length==10 || output.getBatchingStats().sendErrors>0);
+
+		test.same(received.length,10);
+		test.same(output.getBatchingStats().sendErrors,0);
+
+		transponder.stop();
+		input.stop();
+		output.stop();
+		source.close();
+		sink.close();
+		streamer.stop();
+		test.end();
+	});
+
 	suite.test("maxWaitTime",async function(test){
 		//Create new streamer
 		const streamer = MediaServer.createStreamer();
@@ -0,0 +1,213 @@
+const tap		= require("tap");
+const MediaServer	= require("../index");
+const Native		= require("../lib/Native");
+
+MediaServer.enableLog(false);
+MediaServer.enableDebug(false);
+MediaServer.enableUltraDebug(false);
+
+//Wheel range, timers beyond it are parked
+const Range = 2 ** 32;
+
+/**
+ * Ordered multimap of timers, expiring by deadline and then by scheduling order
+ */
+class Reference
+{
+	constructor()
+	{
+		this.timers = new Map();
+		this.seq = 0;
+	}
+	schedule(/** @type {number} */ id, /** @type {number} */ deadline)
+	{
+		this.timers.set(id, { deadline, seq: this.seq++ });
+	}
+	cancel(/** @type {number} */ id)
+	{
+		this.timers.delete(id);
+	}
+	next()
+	{
+		let next = null;
+		for (const [id, timer] of this.timers)
+			if (!next || timer.deadline < next.deadline || (timer.deadline == next.deadline && timer.seq < next.seq))
+				next = { id, ...timer };
+		return next;
+	}
+	popExpired(/** @type {number} */ time)
+	{
+		const next = this.next();
+		if (!next || next.deadline > time)
+			return -1;
+		this.timers.delete(next.id);
+		return next.id;
+	}
+	getNextDeadline()
+	{
+		const next = this.next();
+		return next ? next.deadline : 0;
+	}
+}
+
+/**
+ * Deterministic random generator
+ */
+function createRandom(/** @type {number} */ seed)
+{
+	return (/** @type {number} */ max) => {
+		seed = (Math.imul(seed, 1103515245) + 12345) >>> 0;
+		return Math.floor(seed / 2 ** 32 * max);
+	};
+}
+
+function schedule(wheel, reference, id, deadline)
+{
+	wheel.Schedule(id, deadline);
+	//Due timers expire on the current time of the wheel
+	reference.schedule(id, Math.max(deadline, wheel.GetCurrent()));
+}
+
+function expire(wheel, time)
+{
+	const expired = [];
+	for (let id = wheel.PopExpired(time); id >= 0; id = wheel.PopExpired(time))
+		expired.push(id);
+	return expired;
+}
+
+Promise.all([
+tap.test("TimerWheel",async function(suite){
+
+	suite.test("same deadline order",async function(test){
+		const wheel = new Native.TimerWheelTester(10, 0);
+		for (let id = 0; id < 10; ++id)
+			wheel.Schedule(id, 100);
+		test.same(wheel.GetNextDeadline(), 100);
+		test.same(expire(wheel, 99), []);
+		test.same(expire(wheel, 100), [0,1,2,3,4,5,6,7,8,9]);
+		test.same(wheel.GetSize(), 0);
+		test.same(wheel.GetNextDeadline(), 0);
+		test.end();
+	});
+
+	suite.test("cascade",async function(test){
+		const wheel = new Native.TimerWheelTester(4, 0);
+		//On each level
+		wheel.Schedule(0, 20000);
+		wheel.Schedule(1, 300);
+		wheel.Schedule(2, 1 << 20);
+		wheel.Schedule(3, 10);
+		test.same(wheel.GetNextDeadline(), 10);
+		test.same(expire(wheel, 256), [3]);
+		test.same(wheel.GetNextDeadline(), 300);
+		test.same(expire(wheel, 299), []);
+		test.same(expire(wheel, 300), [1]);
+		test.same(wheel.GetNextDeadline(), 20000);
+		test.same(expire(wheel, 2 ** 21), [0, 2]);
+		test.same(wheel.GetCurrent(), 2 ** 21);
+		test.end();
+	});
+
+	suite.test("cancel",async function(test){
+		const wheel = new Native.TimerWheelTester(3, 0);
+		wheel.Schedule(0, 50);
+		wheel.Schedule(1, 5000);
+		wheel.Schedule(2, 50);
+		wheel.Cancel(0);
+		test.notOk(wheel.IsScheduled(0));
+		test.same(wheel.GetSize(), 2);
+		//Cancelling twice is a no-op
+		wheel.Cancel(0);
+		test.same(wheel.GetSize(), 2);
+		//Rescheduling moves it to the back
+		wheel.Schedule(1, 50);
+		wheel.Schedule(2, 50);
+		test.same(expire(wheel, 10000), [1, 2]);
+		test.end();
+	});
+
+	suite.test("due timers",async function(test){
+		const wheel = new Native.TimerWheelTester(2, 1000);
+		wheel.Schedule(0, 1000);
+		wheel.Schedule(1, 10);
+		test.same(wheel.GetNextDeadline(), 1000);
+		test.same(expire(wheel, 1000), [0, 1]);
+		test.end();
+	});
+
+	suite.test("parking beyond range",async function(test){
+		const wheel = new Native.TimerWheelTester(3, 5);
+		wheel.Schedule(0, 3 * Range);
+		wheel.Schedule(1, Range + 100);
+		test.same(wheel.GetNextDeadline(), Range + 100);
+		test.same(expire(wheel, Range), []);
+		//Newer timer on a later slot but earlier than the parked ones
+		wheel.Schedule(2, 2 * Range);
+		test.same(wheel.GetNextDeadline(), Range + 100);
+		test.same(expire(wheel, Range + 100), [1]);
+		test.same(wheel.GetNextDeadline(), 2 * Range);
+		test.same(expire(wheel, 3 * Range - 1), [2]);
+		test.same(wheel.GetNextDeadline(), 3 * Range);
+		test.same(expire(wheel, 3 * Range), [0]);
+		test.end();
+	});
+
+	suite.test("randomized against multimap",async function(test){
+		const timers = 200;
+		//Short and long timeouts, starting on and off level boundaries
+		for (const [seed, start, maxTimeout] of [[1, 0, 300], [2, 255, 20000], [3, 2 ** 26 - 3, 2 ** 27], [4, 7, 2 ** 33]])
+		{
+			const random = createRandom(seed);
+			const wheel = new Native.TimerWheelTester(timers, start);
+			const reference = new Reference();
+			let now = start;
+			let mismatches = 0;
+			let expired = 0;
+			for (let step = 0; step < 300; ++step)
+			{
+				//Schedule, reschedule, cancel and add due timers
+				for (let i = random(10); i > 0; --i)
+				{
+					const id = random(timers);
+					const op = random(10);
+					if (op < 2)
+					{
+						wheel.Cancel(id);
+						reference.cancel(id);
+					} else if (op == 2) {
+						schedule(wheel, reference, id, Math.max(now - random(5), 0));
+					} else if (op == 3) {
+						schedule(wheel, reference, id, now + random(3));
+					} else {
+						schedule(wheel, reference, id, now + random(maxTimeout));
+					}
+				}
+				if (wheel.GetNextDeadline() != reference.getNextDeadline())
+					mismatches++;
+				//Move forward, sometimes a lot
+				now += random(4) ? random(Math.floor(maxTimeout / 8) + 2) : maxTimeout;
+				//Expire, scheduling new short timers while expiring
+				for (;;)
+				{
+					const id = wheel.PopExpired(now);
+					if (id != reference.popExpired(now))
+						mismatches++;
+					if (id < 0)
+						break;
+					expired++;
+					if (!random(3))
+						schedule(wheel, reference, random(timers), wheel.GetCurrent() + random(50));
+				}
+				if (wheel.GetSize() != reference.timers.size)
+					mismatches++;
+			}
+			test.same(mismatches, 0, `seed:${seed} maxTimeout:${maxTimeout}`);
+			test.ok(expired > 0);
+		}
+		test.end();
+	});
+
+	suite.end();
+})
+]).then(()=>MediaServer.terminate ());
@@ -102,6 +102,46 @@ tap.test("Transponder::create",async function(suite){
 		}
 	});
 	
+	await suite.test("layer fanout",async function(test){
+		try {
+			//Create new local streams
+			const outgoingStream1  = transportA.createOutgoingStream({
+				video: true
+			});
+			const outgoingStream2  = transportA.createOutgoingStream({
+				video: true
+			});
+			//Set the info into B so it can receive it
+			const incomingStream = transportB.createIncomingStream(outgoingStream1.getStreamInfo());
+			//Get video track
+			const incomingVideoTrack = incomingStream.getVideoTracks()[0];
+			//Enable fanout
+			incomingVideoTrack.setLayerFanout(true);
+			//Attach both
+			const transponder1 = outgoingStream1.getVideoTracks()[0].attachTo(incomingVideoTrack);
+			const transponder2 = outgoingStream2.getVideoTracks()[0].attachTo(incomingVideoTrack);
+			//Both on same group
+			let stats = Object.values(incomingVideoTrack.getLayerFanoutStats())[0];
+			test.same(stats.groups,1);
+			//Select lower temporal layer in one of them
+			transponder2.selectLayer(0,0);
+			stats = Object.values(incomingVideoTrack.getLayerFanoutStats())[0];
+			test.same(stats.groups,2);
+			test.same(transponder2.getSelectedTemporalLayerId(),0);
+			//Disable it
+			incomingVideoTrack.setLayerFanout(false);
+			test.same(incomingVideoTrack.getLayerFanoutStats(),{});
+			test.same(transponder2.getSelectedTemporalLayerId(),0);
+			//Stop
+			transponder1.stop();
+			transponder2.stop();
+			incomingStream.stop();
+		} catch (error) {
+			//Test error
+			test.notOk(error,error.message);
+		}
+	});
+
 	//Create new remote stream
 	await suite.test("detach",async function(test){
 		try {
@@ -760,6 +800,35 @@ tap.test("Transponder::targetbitrate svc",async function(suite){
 		}
 	});
 	
+	await suite.test("native selector",async function(test){
+		try {
+			//Get selections for all traversals and some targets
+			const select = () => {
+				const selected = [];
+				for (const traversal of ["default","spatial-temporal","zig-zag-spatial-temporal","temporal-spatial","zig-zag-temporal-spatial"])
+					for (const target of [0, 50000, 100000, 300000, 700000, 1000000, 2000000])
+					{
+						const bitrate = transponder.setTargetBitrate(target,{traversal});
+						selected.push([traversal, target, parseInt(bitrate), bitrate.layerIndex, bitrate.layers.length, transponder.getSelectedSpatialLayerId(), transponder.getSelectedTemporalLayerId()]);
+					}
+				return selected;
+			};
+			//Select using the native ordering
+			const native = select();
+			//Disable native selector
+			incomingVideoTrack.getLayerSelector = () => null;
+			//Select on js
+			const js = select();
+			//Enable it again
+			delete incomingVideoTrack.getLayerSelector;
+			//Must be the same
+			test.same(native,js);
+		} catch (error) {
+			//Test error
+			test.notOk(error,error.message);
+		}
+	});
+	
 	suite.end();
 }),
 
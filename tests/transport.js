@@ -172,7 +172,75 @@ Promise.all([
 			localEndpoint.stop();
 			remoteEndpoint.stop();
 		});
-		
+
+		suite.test("raw tx stats",async function(test){
+			//create endpoints
+			const localEndpoint	= MediaServer.createEndpoint ("127.0.0.1");
+			const remoteEndpoint	= MediaServer.createEndpoint ("127.0.0.1");
+
+			//Genereate info
+			const localInfo = {
+				dtls		: new DTLSInfo(Setup.ACTIVE,"sha-256",localEndpoint.getDTLSFingerprint()),
+				ice		: ICEInfo.generate(true),
+			};
+			const remoteInfo = {
+				dtls		: new DTLSInfo(Setup.PASSIVE,"sha-256",remoteEndpoint.getDTLSFingerprint()),
+				ice		: ICEInfo.generate(true),
+			};
+
+			//Create transports
+			const sender		= localEndpoint.createTransport (localInfo,remoteInfo,{disableSTUNKeepAlive: true});
+			const receiver		= remoteEndpoint.createTransport (remoteInfo,localInfo,{disableSTUNKeepAlive: true});
+
+			//Raw tx is disabled by default
+			test.same(localEndpoint.getRawTxStats().length,1);
+			test.notOk(localEndpoint.getRawTxStats()[0].enabled);
+			test.same(localEndpoint.getRawTxStats()[0].frames,0);
+
+			//Connect them
+			const remote = remoteEndpoint.getLocalCandidates()[0];
+			sender.addRemoteCandidate(remote);
+			receiver.addRemoteCandidate(localEndpoint.getLocalCandidates()[0]);
+
+			await sleep(2000);
+
+			test.same(sender.getDTLSState(),"connected");
+
+			//Ice and dtls have been sent through the udp socket to the remote candidate
+			const stats = sender.getRawTxStats();
+			test.same(stats.length,1);
+			test.same(stats[0].ip,remote.getAddress());
+			test.same(stats[0].port,remote.getPort());
+			test.notOk(stats[0].raw);
+			test.ok(stats[0].udpPackets>0);
+			test.same(stats[0].rawPackets,0);
+			test.same(stats[0].dropped,0);
+
+			//Raw tx needs CAP_NET_RAW and a default route on the interface
+			const enabled = await localEndpoint.setRawTx({interfaceName:"lo"}).then(() => true, () => false);
+			if (enabled)
+			{
+				test.ok(localEndpoint.getRawTxStats()[0].enabled);
+				test.ok(localEndpoint.getRawTxStats()[0].frames>=256);
+				//Known candidates are sent through the default route until their own one is set
+				test.ok(sender.getRawTxStats()[0].raw);
+				await localEndpoint.setRawTx(false);
+				test.notOk(sender.getRawTxStats()[0].raw);
+			} else {
+				test.comment("raw tx not available, skipping ring checks");
+			}
+			test.notOk(localEndpoint.getRawTxStats()[0].enabled);
+
+			sender.stop();
+			receiver.stop();
+
+			//Candidates are released on stop
+			test.same(sender.getRawTxStats().length,0);
+
+			localEndpoint.stop();
+			remoteEndpoint.stop();
+		});
+
 		suite.end();
 	}),
 	tap.test("Override BWE", async function (suite)